@@ -12,6 +12,7 @@
 #include <string.h>
 
 #include "audio.h"
+#include "perf.h"
 extern "C"{
 #include "debug.h"
 }
@@ -59,6 +60,7 @@ bool cMarkAdAudio::ChannelChange(int channelsBefore, int channelsAfter) {
 
 
 sMarkAdMark *cMarkAdAudio::Process() {
+    cPerfTimer perfTimer(PERF_AUDIO);
     ResetMark();
     for (short int stream = 0; stream < MAXSTREAMS; stream++){
         if ((macontext->Audio.Info.Channels[stream] != 0) && (channels[stream] == 0)) dsyslog("cMarkAdAudio::ChannelChange(): new audio stream %d start at frame (%d)", stream, macontext->Audio.Info.channelChangeFrame);
@@ -0,0 +1,1150 @@
+/*
+ * bench.cpp: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+#include <math.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+
+#include "global.h"
+#include "decoder_new.h"
+#include "video.h"
+#include "logo.h"
+#include "index.h"
+extern "C" {
+    #include "debug.h"
+    #include <libavutil/opt.h>
+    #include <libavutil/channel_layout.h>
+}
+
+#if LIBAVCODEC_VERSION_INT < ((57<<16)+(64<<8)+101)
+    #error "markad-bench needs libavcodec 57.64.101 (FFmpeg 3.2) or newer"
+#endif
+
+
+// globals used by the markad objects, normally defined in markad-standalone.cpp
+int SysLogLevel = 1;
+bool abortNow = false;
+int logoSearchTime_ms = 0;
+int decodeTime_us = 0;
+
+
+void syslog_with_tid(int priority, const char *format, ...) {
+    va_list ap;
+    char prioText[10];
+    switch (priority) {
+        case LOG_ERR:   strcpy(prioText,"ERROR:"); break;
+        case LOG_INFO : strcpy(prioText,"INFO: "); break;
+        case LOG_DEBUG: strcpy(prioText,"DEBUG:"); break;
+        case LOG_TRACE: strcpy(prioText,"TRACE:"); break;
+        default:        strcpy(prioText,"?????:"); break;
+    }
+    char fmt[255];
+    snprintf(fmt, sizeof(fmt), "markad-bench: [%d] %s %s\n", getpid(), prioText, format);
+    va_start(ap, format);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+}
+
+
+#define BENCH_FPS           25   // frame rate of the synthetic recordings
+#define BENCH_SAMPLE_RATE   48000
+#define BENCH_OVERLAP_SECS  10   // seconds before an ad block repeated after the ad block
+#define BENCH_SEGMENTS      5
+#define BENCH_MARKS_SIZE    4096 // maximum size of the marks file read after a full pipeline run
+#define BENCH_SOBEL_PLANES  200  // random planes to compare SIMD and scalar sobel transformation
+#define BENCH_INDEX_SIZE    500000  // i-frames of the synthetic recording index
+#define BENCH_INDEX_QUERIES 1000    // random queries of each recording index function
+
+
+/**
+ * synthetic recording type
+ */
+struct sBenchCase {
+    const char *name;       //!< name of the test case
+                            //!<
+    enum AVCodecID codecID; //!< video codec
+                            //!<
+    int width;              //!< video width
+                            //!<
+    int height;             //!< video height
+                            //!<
+    AVRational sar;         //!< sample aspect ratio for a 16:9 display aspect ratio
+                            //!<
+    int gop;                //!< distance of i-frames
+                            //!<
+    int64_t bitRate;        //!< video bit rate
+                            //!<
+};
+
+static const sBenchCase benchCases[] = {
+    {"mpeg2-sd", AV_CODEC_ID_MPEG2VIDEO,  720,  576, {64, 45}, 12,  4000000},
+    {"mpeg2-hd", AV_CODEC_ID_MPEG2VIDEO, 1920, 1080, { 1,  1}, 12, 12000000},
+    {"h264-sd",  AV_CODEC_ID_H264,        720,  576, {64, 45}, 25,  2000000},
+    {"h264-hd",  AV_CODEC_ID_H264,       1920, 1080, { 1,  1}, 25,  6000000}
+};
+
+
+/**
+ * part of a synthetic recording
+ */
+struct sBenchSegment {
+    int start = 0;           //!< first frame of the segment
+                             //!<
+    int end = 0;             //!< first frame after the segment
+                             //!<
+    bool broadcast = false;  //!< <b>true:</b> broadcast with logo and 6 audio channels <br>
+                             //!< <b>false:</b> advertising without logo and 2 audio channels
+    int border = 0;          //!< 0 = no border, 1 = horizontal border, 2 = vertical border
+                             //!<
+    int contentOffset = 0;   //!< content frame of the first frame of the segment
+                             //!<
+};
+
+
+/**
+ * i-frame of the reference recording index
+ */
+struct sBenchIFrame {
+    int frameNumber = 0;     //!< frame number of the i-frame
+                             //!<
+    int timeOffset_ms = 0;   //!< time offset from start of the recording in ms
+                             //!<
+};
+
+
+/**
+ * result of one benchmark
+ */
+struct sBenchResult {
+    int frames = 0;          //!< processed frames
+                             //!<
+    int64_t ns = 0;          //!< used time in ns
+                             //!<
+};
+
+
+/**
+ * generate and benchmark synthetic VDR recordings
+ */
+class cMarkAdBench {
+    public:
+
+/**
+ * constructor of the benchmark
+ * @param benchDirParam directory to store the synthetic recordings
+ * @param lengthParam   length of each recording in seconds
+ * @param markadParam   markad binary for full pipeline benchmark, NULL to skip it
+ * @param threadsParam  decoder threads
+ */
+        cMarkAdBench(const char *benchDirParam, const int lengthParam, const char *markadParam, const int threadsParam);
+        ~cMarkAdBench();
+
+/**
+ * generate recording of one test case and run all benchmarks on it
+ * @param benchCase test case
+ * @return true if successful, false otherwise
+ */
+        bool Run(const sBenchCase *benchCase);
+
+/**
+ * compare SIMD sobel line transformations supported by the CPU with the scalar version on random planes
+ * @return true if all results are identical, false otherwise
+ */
+        static bool CheckSobelLine();
+
+/**
+ * compare results and speed of cIndex with the linear search of the recording index used before the frame to slot table
+ * @return true if all results are identical, false otherwise
+ */
+        static bool CheckIndex();
+
+    private:
+
+/**
+ * get monotonic time in ns
+ * @return time in ns
+ */
+        static int64_t Now();
+
+/**
+ * print one result line
+ * @param benchCase test case
+ * @param test      name of the test
+ * @param result    result of the test
+ */
+        static void Report(const sBenchCase *benchCase, const char *test, const sBenchResult *result);
+
+/**
+ * set segments of the recording
+ */
+        void SetSegments();
+
+/**
+ * get segment of a frame
+ * @param frameNumber frame number
+ * @return segment index
+ */
+        int GetSegment(const int frameNumber);
+
+/**
+ * draw synthetic picture of a frame
+ * @param frame       video frame
+ * @param frameNumber frame number
+ */
+        void DrawVideo(AVFrame *frame, const int frameNumber);
+
+/**
+ * fill audio frame with tone or silence
+ * @param frame       audio frame
+ * @param sample      first sample number of the frame
+ * @param frameNumber video frame number at the time of the audio frame
+ */
+        void DrawAudio(AVFrame *frame, const int64_t sample, const int frameNumber);
+
+/**
+ * encode frame and write packets to output file
+ * @param codecCtx codec context of the encoder
+ * @param stream   output stream
+ * @param frame    frame to encode, NULL to flush encoder
+ * @return true if successful, false otherwise
+ */
+        bool Encode(AVCodecContext *codecCtx, AVStream *stream, AVFrame *frame);
+
+/**
+ * write synthetic ts file and info file into a new recording directory
+ * @param benchCase test case
+ * @return true if successful, false otherwise
+ */
+        bool Generate(const sBenchCase *benchCase);
+
+/**
+ * decode recording and run the detectors on each frame
+ * @param benchCase test case
+ * @return true if successful, false otherwise
+ */
+        bool Detectors(const sBenchCase *benchCase);
+
+/**
+ * decode recording with full and with analysis decode profile
+ * @param benchCase  test case
+ * @param fullDecode true to decode all video frames, false to decode only i-frames like markad without --fulldecode
+ * @return true if successful, false otherwise
+ */
+        bool DecodeProfile(const sBenchCase *benchCase, const bool fullDecode);
+
+/**
+ * run logo search of cExtractLogo on the recording
+ * @param benchCase test case
+ * @return true if successful, false otherwise
+ */
+        bool SearchLogo(const sBenchCase *benchCase);
+
+/**
+ * run markad on the recording
+ * @param[in]  benchCase      test case
+ * @param[in]  analysisDecode true to run markad with --analysisdecode
+ * @param[out] marks          content of the marks file written by markad
+ * @param[in]  size           size of marks buffer
+ * @return true if successful, false otherwise
+ */
+        bool Pipeline(const sBenchCase *benchCase, const bool analysisDecode, char *marks, const int size);
+
+        const char *benchDir = NULL;              //!< directory of the synthetic recordings
+                                                  //!<
+        const char *markad = NULL;                //!< markad binary
+                                                  //!<
+        int length = 0;                           //!< length of the recording in seconds
+                                                  //!<
+        int threads = 1;                          //!< decoder threads
+                                                  //!<
+        int frameCount = 0;                       //!< count of video frames of the recording
+                                                  //!<
+        char *recDir = NULL;                      //!< directory of the current recording
+                                                  //!<
+        sBenchSegment segments[BENCH_SEGMENTS];   //!< parts of the recording
+                                                  //!<
+        AVFormatContext *avctxOut = NULL;         //!< output format context
+                                                  //!<
+        AVCodecContext *audioCtx[2] = {};         //!< audio encoder with 2 and 6 channels
+                                                  //!<
+        int currentAudio = 0;                     //!< index of current audio encoder
+                                                  //!<
+        sMarkAdConfig config = {};                //!< markad config for the detectors
+                                                  //!<
+        sMarkAdContext maContext = {};            //!< markad context for the detectors
+                                                  //!<
+};
+
+
+cMarkAdBench::cMarkAdBench(const char *benchDirParam, const int lengthParam, const char *markadParam, const int threadsParam) {
+    benchDir = benchDirParam;
+    length = lengthParam;
+    markad = markadParam;
+    threads = threadsParam;
+    frameCount = length * BENCH_FPS;
+    SetSegments();
+
+    config.decodeVideo = true;
+    config.decodeAudio = true;
+    config.logoExtraction = -1;
+    config.logoWidth = -1;
+    config.logoHeight = -1;
+    config.threads = threads;
+    config.autoLogo = 2;
+    strncpy(config.logoDirectory, benchDir, sizeof(config.logoDirectory) - 1);
+    maContext.Config = &config;
+}
+
+
+cMarkAdBench::~cMarkAdBench() {
+    if (recDir) {
+        FREE(strlen(recDir)+1, "recDir");
+        free(recDir);
+    }
+}
+
+
+int64_t cMarkAdBench::Now() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+
+void cMarkAdBench::Report(const sBenchCase *benchCase, const char *test, const sBenchResult *result) {
+    if ((result->frames <= 0) || (result->ns <= 0)) {
+        printf("%-10s %-26s %8d %10s %12s %12s\n", benchCase->name, test, result->frames, "-", "-", "-");
+        return;
+    }
+    printf("%-10s %-26s %8d %10.1f %12.1f %12" PRId64 "\n", benchCase->name, test, result->frames, result->ns / 1000000.0,
+                                                              result->frames * 1000000000.0 / result->ns, result->ns / result->frames);
+    fflush(stdout);
+}
+
+
+// layout of the recording:
+// advertising with vertical border, broadcast, advertising with horizontal border, broadcast, advertising
+// each part after the first starts with one second black screen, the second broadcast part starts with
+// the last BENCH_OVERLAP_SECS seconds of the first broadcast part for the overlap detection
+//
+void cMarkAdBench::SetSegments() {
+    const int bounds[BENCH_SEGMENTS + 1] = {0, frameCount / 10, frameCount * 45 / 100, frameCount * 60 / 100, frameCount * 90 / 100, frameCount};
+    for (int segment = 0; segment < BENCH_SEGMENTS; segment++) {
+        segments[segment].start = bounds[segment];
+        segments[segment].end = bounds[segment + 1];
+        segments[segment].broadcast = ((segment == 1) || (segment == 3));
+        segments[segment].border = (segment == 0) ? 2 : ((segment == 2) ? 1 : 0);
+        segments[segment].contentOffset = 1000000 * segment;
+    }
+    segments[3].contentOffset = segments[1].contentOffset + (segments[1].end - segments[1].start) - BENCH_OVERLAP_SECS * BENCH_FPS - BENCH_FPS;
+}
+
+
+int cMarkAdBench::GetSegment(const int frameNumber) {
+    for (int segment = 0; segment < BENCH_SEGMENTS; segment++) {
+        if (frameNumber < segments[segment].end) return segment;
+    }
+    return BENCH_SEGMENTS - 1;
+}
+
+
+void cMarkAdBench::DrawVideo(AVFrame *frame, const int frameNumber) {
+    const sBenchSegment *segment = &segments[GetSegment(frameNumber)];
+    const int width = frame->width;
+    const int height = frame->height;
+    bool black = (segment->start > 0) && (frameNumber < segment->start + BENCH_FPS);
+
+    // moving pattern, new scene every 4 seconds
+    int content = segment->contentOffset + frameNumber - segment->start;
+    unsigned int scene = (content / (4 * BENCH_FPS)) * 2654435761U;
+    int base = 40 + (scene >> 8) % 140;
+    int ax = 1 + (scene >> 16) % 4;
+    int ay = 1 + (scene >> 20) % 4;
+    int speed = 1 + (scene >> 24) % 5;
+    int chroma = (scene >> 12) % 64 - 32;
+
+    for (int y = 0; y < height; y++) {
+        uchar *line = frame->data[0] + y * frame->linesize[0];
+        if (black) {
+            memset(line, 16, width);
+            continue;
+        }
+        for (int x = 0; x < width; x++) line[x] = base + ((x * ax + y * ay + content * speed) & 63) - 32;
+    }
+    for (int plane = 1; plane < PLANES; plane++) {
+        for (int y = 0; y < height / 2; y++) {
+            uchar *line = frame->data[plane] + y * frame->linesize[plane];
+            if (black) {
+                memset(line, 128, width / 2);
+                continue;
+            }
+            for (int x = 0; x < width / 2; x++) line[x] = 128 + ((plane == 1) ? chroma : -chroma) + (((x + y) >> 4) & 7);
+        }
+    }
+    if (black) return;
+
+    // borders
+    if (segment->border == 1) {
+        int borderHeight = height / 8;
+        for (int y = 0; y < borderHeight; y++) {
+            memset(frame->data[0] + y * frame->linesize[0], 16, width);
+            memset(frame->data[0] + (height - 1 - y) * frame->linesize[0], 16, width);
+        }
+        for (int plane = 1; plane < PLANES; plane++) {
+            for (int y = 0; y < borderHeight / 2; y++) {
+                memset(frame->data[plane] + y * frame->linesize[plane], 128, width / 2);
+                memset(frame->data[plane] + (height / 2 - 1 - y) * frame->linesize[plane], 128, width / 2);
+            }
+        }
+    }
+    if (segment->border == 2) {
+        int borderWidth = width / 8;
+        for (int y = 0; y < height; y++) {
+            memset(frame->data[0] + y * frame->linesize[0], 16, borderWidth);
+            memset(frame->data[0] + y * frame->linesize[0] + width - borderWidth, 16, borderWidth);
+        }
+        for (int plane = 1; plane < PLANES; plane++) {
+            for (int y = 0; y < height / 2; y++) {
+                memset(frame->data[plane] + y * frame->linesize[plane], 128, borderWidth / 2);
+                memset(frame->data[plane] + y * frame->linesize[plane] + (width - borderWidth) / 2, 128, borderWidth / 2);
+            }
+        }
+    }
+
+    // logo in top right corner: a frame with two vertical bars
+    if (segment->broadcast) {
+        int logoWidth = width / 9;
+        int logoHeight = height / 12;
+        int logoX = width - width / 20 - logoWidth;
+        int logoY = height / 25;
+        int thick = (width / 240 > 2) ? width / 240 : 2;
+        for (int y = 0; y < logoHeight; y++) {
+            uchar *line = frame->data[0] + (logoY + y) * frame->linesize[0] + logoX;
+            bool edge = (y < thick) || (y >= logoHeight - thick);
+            for (int x = 0; x < logoWidth; x++) {
+                if (edge || (x < thick) || (x >= logoWidth - thick) ||
+                   ((x >= logoWidth / 3) && (x < logoWidth / 3 + thick)) || ((x >= 2 * logoWidth / 3) && (x < 2 * logoWidth / 3 + thick))) line[x] = 235;
+            }
+        }
+    }
+}
+
+
+void cMarkAdBench::DrawAudio(AVFrame *frame, const int64_t sample, const int frameNumber) {
+    const sBenchSegment *segment = &segments[GetSegment(frameNumber)];
+    bool silence = (segment->start > 0) && (frameNumber < segment->start + BENCH_FPS);
+    for (int channel = 0; channel < frame->channels; channel++) {
+        float *data = reinterpret_cast<float *>(frame->extended_data[channel]);
+        double frequency = 440.0 * (channel + 1);
+        for (int i = 0; i < frame->nb_samples; i++) {
+            data[i] = (silence) ? 0 : 0.3 * sin(2 * M_PI * frequency * (sample + i) / BENCH_SAMPLE_RATE);
+        }
+    }
+}
+
+
+bool cMarkAdBench::Encode(AVCodecContext *codecCtx, AVStream *stream, AVFrame *frame) {
+    if (avcodec_send_frame(codecCtx, frame) < 0) {
+        esyslog("cMarkAdBench::Encode(): avcodec_send_frame() failed");
+        return false;
+    }
+    AVPacket *avpkt = av_packet_alloc();
+    while (avcodec_receive_packet(codecCtx, avpkt) == 0) {
+        av_packet_rescale_ts(avpkt, codecCtx->time_base, stream->time_base);
+        avpkt->stream_index = stream->index;
+        if (av_interleaved_write_frame(avctxOut, avpkt) < 0) {
+            esyslog("cMarkAdBench::Encode(): av_interleaved_write_frame() failed");
+            av_packet_free(&avpkt);
+            return false;
+        }
+    }
+    av_packet_free(&avpkt);
+    return true;
+}
+
+
+bool cMarkAdBench::Generate(const sBenchCase *benchCase) {
+    // recording directory name like vdr, recording starts length seconds ago
+    time_t recStart = time(NULL) - length;
+    struct tm tmStart;
+    localtime_r(&recStart, &tmStart);
+    char dirName[64];
+    strftime(dirName, sizeof(dirName), "%Y-%m-%d.%H.%M.1-0.rec", &tmStart);
+    if (recDir) {
+        FREE(strlen(recDir)+1, "recDir");
+        free(recDir);
+        recDir = NULL;
+    }
+    char *channelDir = NULL;
+    if (asprintf(&channelDir, "%s/%s", benchDir, benchCase->name) == -1) return false;
+    ALLOC(strlen(channelDir)+1, "channelDir");
+    mkdir(channelDir, 0755);
+    if (asprintf(&recDir, "%s/%s", channelDir, dirName) == -1) recDir = NULL;
+    FREE(strlen(channelDir)+1, "channelDir");
+    free(channelDir);
+    if (!recDir) return false;
+    ALLOC(strlen(recDir)+1, "recDir");
+    mkdir(recDir, 0755);
+
+    const AVCodec *videoCodec = avcodec_find_encoder(benchCase->codecID);
+    const AVCodec *audioCodec = avcodec_find_encoder(AV_CODEC_ID_AC3);
+    if (!videoCodec || !audioCodec) return false;
+
+    char *fileName = NULL;
+    if (asprintf(&fileName, "%s/00001.ts", recDir) == -1) return false;
+    ALLOC(strlen(fileName)+1, "fileName");
+    avformat_alloc_output_context2(&avctxOut, NULL, "mpegts", fileName);
+    if (!avctxOut) {
+        FREE(strlen(fileName)+1, "fileName");
+        free(fileName);
+        return false;
+    }
+
+    // video encoder
+    AVCodecContext *videoCtx = avcodec_alloc_context3(videoCodec);
+    videoCtx->width = benchCase->width;
+    videoCtx->height = benchCase->height;
+    videoCtx->sample_aspect_ratio = benchCase->sar;
+    videoCtx->time_base = (AVRational) {1, BENCH_FPS};
+    videoCtx->framerate = (AVRational) {BENCH_FPS, 1};
+    videoCtx->pix_fmt = AV_PIX_FMT_YUV420P;
+    videoCtx->gop_size = benchCase->gop;
+    videoCtx->keyint_min = benchCase->gop;
+    videoCtx->max_b_frames = 2;
+    videoCtx->bit_rate = benchCase->bitRate;
+    videoCtx->thread_count = threads;
+    if (benchCase->codecID == AV_CODEC_ID_H264) {
+        av_opt_set(videoCtx->priv_data, "preset", "veryfast", 0);
+        av_opt_set(videoCtx->priv_data, "x264-params", "scenecut=0", 0);  // keep fixed i-frame distance
+    }
+    else av_opt_set_int(videoCtx, "sc_threshold", 1000000000, 0);
+    // audio encoders for 2 and 6 channels, both write to the same stream like a channel change in a vdr recording
+    const uint64_t layouts[2] = {AV_CH_LAYOUT_STEREO, AV_CH_LAYOUT_5POINT1};
+    for (int i = 0; i < 2; i++) {
+        audioCtx[i] = avcodec_alloc_context3(audioCodec);
+        audioCtx[i]->sample_fmt = AV_SAMPLE_FMT_FLTP;
+        audioCtx[i]->sample_rate = BENCH_SAMPLE_RATE;
+        audioCtx[i]->channel_layout = layouts[i];
+        audioCtx[i]->channels = av_get_channel_layout_nb_channels(layouts[i]);
+        audioCtx[i]->bit_rate = (i == 0) ? 192000 : 448000;
+        audioCtx[i]->time_base = (AVRational) {1, BENCH_SAMPLE_RATE};
+    }
+    bool ok = (avcodec_open2(videoCtx, videoCodec, NULL) >= 0) && (avcodec_open2(audioCtx[0], audioCodec, NULL) >= 0) && (avcodec_open2(audioCtx[1], audioCodec, NULL) >= 0);
+    if (!ok) esyslog("cMarkAdBench::Generate(): could not open encoder");
+
+    AVStream *videoStream = NULL;
+    AVStream *audioStream = NULL;
+    if (ok) {
+        videoStream = avformat_new_stream(avctxOut, NULL);
+        audioStream = avformat_new_stream(avctxOut, NULL);
+        ok = videoStream && audioStream;
+    }
+    if (ok) {
+        videoStream->time_base = videoCtx->time_base;
+        audioStream->time_base = audioCtx[1]->time_base;
+        ok = (avcodec_parameters_from_context(videoStream->codecpar, videoCtx) >= 0) && (avcodec_parameters_from_context(audioStream->codecpar, audioCtx[1]) >= 0);
+    }
+    if (ok) ok = (avio_open(&avctxOut->pb, fileName, AVIO_FLAG_WRITE) >= 0);
+    if (ok) ok = (avformat_write_header(avctxOut, NULL) >= 0);
+    FREE(strlen(fileName)+1, "fileName");
+    free(fileName);
+
+    AVFrame *videoFrame = av_frame_alloc();
+    AVFrame *audioFrame = av_frame_alloc();
+    if (ok) {
+        videoFrame->format = videoCtx->pix_fmt;
+        videoFrame->width = videoCtx->width;
+        videoFrame->height = videoCtx->height;
+        ok = (av_frame_get_buffer(videoFrame, 32) >= 0);
+    }
+
+    int64_t sample = 0;
+    for (int frameNumber = 0; ok && (frameNumber < frameCount); frameNumber++) {
+        ok = (av_frame_make_writable(videoFrame) >= 0);
+        if (!ok) break;
+        DrawVideo(videoFrame, frameNumber);
+        videoFrame->pts = frameNumber;
+        ok = Encode(videoCtx, videoStream, videoFrame);
+
+        // audio up to the end of the video frame, switch encoder on channel change
+        int codec = segments[GetSegment(frameNumber)].broadcast ? 1 : 0;
+        while (ok && (sample < (int64_t) (frameNumber + 1) * BENCH_SAMPLE_RATE / BENCH_FPS)) {
+            if (codec != currentAudio) {
+                ok = Encode(audioCtx[currentAudio], audioStream, NULL);
+                currentAudio = codec;
+            }
+            av_frame_unref(audioFrame);
+            audioFrame->format = audioCtx[currentAudio]->sample_fmt;
+            audioFrame->channel_layout = audioCtx[currentAudio]->channel_layout;
+            audioFrame->channels = audioCtx[currentAudio]->channels;
+            audioFrame->sample_rate = BENCH_SAMPLE_RATE;
+            audioFrame->nb_samples = audioCtx[currentAudio]->frame_size;
+            if (ok) ok = (av_frame_get_buffer(audioFrame, 0) >= 0);
+            if (!ok) break;
+            DrawAudio(audioFrame, sample, frameNumber);
+            audioFrame->pts = sample;
+            sample += audioFrame->nb_samples;
+            ok = Encode(audioCtx[currentAudio], audioStream, audioFrame);
+        }
+    }
+    if (ok) ok = Encode(videoCtx, videoStream, NULL) && Encode(audioCtx[currentAudio], audioStream, NULL);
+    if (ok) av_write_trailer(avctxOut);
+
+    av_frame_free(&videoFrame);
+    av_frame_free(&audioFrame);
+    avcodec_free_context(&videoCtx);
+    avcodec_free_context(&audioCtx[0]);
+    avcodec_free_context(&audioCtx[1]);
+    currentAudio = 0;
+    if (avctxOut->pb) avio_closep(&avctxOut->pb);
+    avformat_free_context(avctxOut);
+    avctxOut = NULL;
+    if (!ok) return false;
+
+    // vdr info file, broadcast starts with the first broadcast segment and ends with the second
+    char *infoName = NULL;
+    if (asprintf(&infoName, "%s/info", recDir) == -1) return false;
+    ALLOC(strlen(infoName)+1, "infoName");
+    FILE *info = fopen(infoName, "w");
+    if (info) {
+        bool h264 = (benchCase->codecID == AV_CODEC_ID_H264);
+        fprintf(info, "C S19.2E-1-1-1 BENCH-%s\n", benchCase->name);
+        fprintf(info, "E 1 %ld %d 4E 10\n", (long) recStart + segments[1].start / BENCH_FPS, (segments[3].end - segments[1].start) / BENCH_FPS);
+        fprintf(info, "T markad benchmark %s\n", benchCase->name);
+        if (h264) fprintf(info, "X 5 0B deu HD 16:9\n");
+        else fprintf(info, "X 1 03 deu 16:9\n");
+        fprintf(info, "X 2 05 deu Dolby Digital 5.1\n");
+        fprintf(info, "F %d\n", BENCH_FPS);
+        fprintf(info, "P 50\nL 99\n");
+        fclose(info);
+        struct utimbuf times = {recStart, recStart};  // markad gets the recording start from info file modification time
+        utime(infoName, &times);
+    }
+    FREE(strlen(infoName)+1, "infoName");
+    free(infoName);
+    return (info != NULL);
+}
+
+
+bool cMarkAdBench::Detectors(const sBenchCase *benchCase) {
+    sBenchResult decode, blackScreen, sobel, overlap;
+    cIndex *recordingIndex = new cIndex();
+    ALLOC(sizeof(*recordingIndex), "recordingIndex");
+    cDecoder *ptr_cDecoder = new cDecoder(threads, recordingIndex);
+    ALLOC(sizeof(*ptr_cDecoder), "ptr_cDecoder");
+    cMarkAdBlackScreen *ptr_BlackScreen = new cMarkAdBlackScreen(&maContext);
+    ALLOC(sizeof(*ptr_BlackScreen), "blackScreen");
+    cMarkAdOverlap *ptr_Overlap = new cMarkAdOverlap(&maContext);
+    ALLOC(sizeof(*ptr_Overlap), "overlap");
+    cMarkAdLogo *ptr_Logo[CORNERS];
+    for (int corner = 0; corner < CORNERS; corner++) {
+        ptr_Logo[corner] = new cMarkAdLogo(&maContext, recordingIndex);
+        ALLOC(sizeof(*ptr_Logo[corner]), "ptr_Logo");
+        ptr_Logo[corner]->GetArea()->corner = corner;
+    }
+
+    // overlap detection compares i-frames before the second ad block with i-frames after it
+    const int overlapFrames = 2 * BENCH_OVERLAP_SECS * BENCH_FPS;
+    const int overlapIFrames = overlapFrames / benchCase->gop + 1;
+    const int stopFrame = segments[1].end;
+    const int startFrame = segments[3].start + BENCH_FPS;
+    int overlapBefore = 0;
+    bool overlapDone = false;
+
+    int64_t start = Now();
+    while (ptr_cDecoder->DecodeDir(recDir)) {
+        if (ptr_cDecoder->GetFrameNumber() < 0) {
+            maContext.Info.vPidType = ptr_cDecoder->GetVideoType();
+            maContext.Video.Info.height = ptr_cDecoder->GetVideoHeight();
+            maContext.Video.Info.width = ptr_cDecoder->GetVideoWidth();
+            maContext.Video.Info.framesPerSecond = ptr_cDecoder->GetVideoAvgFrameRate();
+        }
+        while (ptr_cDecoder->GetNextPacket()) {
+            bool valid = ptr_cDecoder->GetFrameInfo(&maContext, true);
+            int64_t stop = Now();
+            if (!valid || !ptr_cDecoder->IsVideoPacket() || !maContext.Video.Data.valid) continue;
+            decode.frames++;
+            decode.ns += stop - start;
+            int frameNumber = ptr_cDecoder->GetFrameNumber();
+
+            start = Now();
+            ptr_BlackScreen->Process(frameNumber);
+            stop = Now();
+            blackScreen.frames++;
+            blackScreen.ns += stop - start;
+
+            start = stop;
+            for (int corner = 0; corner < CORNERS; corner++) {
+                int logoFrameNumber = -1;  // only fill area, like the logo search
+                ptr_Logo[corner]->Detect(0, frameNumber, &logoFrameNumber);
+            }
+            stop = Now();
+            sobel.frames++;
+            sobel.ns += stop - start;
+
+            if (!overlapDone && ptr_cDecoder->IsVideoIFrame()) {
+                bool before = (frameNumber >= stopFrame - overlapFrames) && (frameNumber < stopFrame) && (overlapBefore < overlapIFrames);
+                bool after = (frameNumber >= startFrame) && (frameNumber < startFrame + overlapFrames);
+                if (before || after) {
+                    start = Now();
+                    sOverlapPos *overlapPos = ptr_Overlap->Process(frameNumber, overlapIFrames, before, (maContext.Info.vPidType == MARKAD_PIDTYPE_VIDEO_H264));
+                    stop = Now();
+                    overlap.frames++;
+                    overlap.ns += stop - start;
+                    if (before) overlapBefore++;
+                    if (overlapPos) {
+                        dsyslog("cMarkAdBench::Detectors(): overlap from (%d) to (%d)", overlapPos->frameNumberBefore, overlapPos->frameNumberAfter);
+                        overlapDone = true;
+                    }
+                }
+            }
+            start = Now();
+        }
+    }
+
+    for (int corner = 0; corner < CORNERS; corner++) {
+        FREE(sizeof(*ptr_Logo[corner]), "ptr_Logo");
+        delete ptr_Logo[corner];
+    }
+    FREE(sizeof(*ptr_Overlap), "overlap");
+    delete ptr_Overlap;
+    FREE(sizeof(*ptr_BlackScreen), "blackScreen");
+    delete ptr_BlackScreen;
+    FREE(sizeof(*ptr_cDecoder), "ptr_cDecoder");
+    delete ptr_cDecoder;
+    FREE(sizeof(*recordingIndex), "recordingIndex");
+    delete recordingIndex;
+
+    Report(benchCase, "decode", &decode);
+    Report(benchCase, "cMarkAdBlackScreen", &blackScreen);
+    Report(benchCase, "SobelPlane (4 corners)", &sobel);
+    Report(benchCase, "cMarkAdOverlap", &overlap);
+    return (decode.frames > 0);
+}
+
+
+bool cMarkAdBench::DecodeProfile(const sBenchCase *benchCase, const bool fullDecode) {
+    bool ok = true;
+    for (int analysis = 0; analysis <= 1; analysis++) {
+        sBenchResult decode;
+        cIndex *recordingIndex = new cIndex();
+        ALLOC(sizeof(*recordingIndex), "recordingIndex");
+        cDecoder *ptr_cDecoder = new cDecoder(threads, recordingIndex);
+        ALLOC(sizeof(*ptr_cDecoder), "ptr_cDecoder");
+        ptr_cDecoder->SetAnalysisDecode(analysis == 1, fullDecode);
+
+        int64_t start = Now();
+        while (ptr_cDecoder->DecodeDir(recDir)) {
+            while (ptr_cDecoder->GetNextPacket()) {
+                if (ptr_cDecoder->GetFrameInfo(&maContext, fullDecode) && ptr_cDecoder->IsVideoPacket() && maContext.Video.Data.valid) decode.frames++;
+            }
+        }
+        decode.ns = Now() - start;
+
+        FREE(sizeof(*ptr_cDecoder), "ptr_cDecoder");
+        delete ptr_cDecoder;
+        FREE(sizeof(*recordingIndex), "recordingIndex");
+        delete recordingIndex;
+
+        char test[32];
+        snprintf(test, sizeof(test), "decode %s%s", (fullDecode) ? "all" : "i-frames", (analysis == 1) ? " analysis" : "");
+        Report(benchCase, test, &decode);
+        if (decode.frames == 0) ok = false;
+    }
+    return ok;
+}
+
+
+bool cMarkAdBench::SearchLogo(const sBenchCase *benchCase) {
+    sBenchResult search;
+    char channelName[64];
+    snprintf(channelName, sizeof(channelName), "BENCH-%s", benchCase->name);
+    maContext.Info.ChannelName = channelName;
+    maContext.Config->recDir = recDir;
+    sAspectRatio aspectRatio = {16, 9};
+
+    cIndex *recordingIndex = new cIndex();
+    ALLOC(sizeof(*recordingIndex), "recordingIndex");
+    cExtractLogo *ptr_cExtractLogo = new cExtractLogo(&maContext, aspectRatio, recordingIndex);
+    ALLOC(sizeof(*ptr_cExtractLogo), "ptr_cExtractLogo");
+    int64_t start = Now();
+    int result = ptr_cExtractLogo->SearchLogo(&maContext, segments[1].start);
+    search.ns = Now() - start;
+    int fileNumber = 0;
+    int lastIFrame = 0;
+    int timeOffset_ms = 0;
+    int64_t pos = 0;
+    if (!recordingIndex->GetElement(recordingIndex->Count() - 1, &fileNumber, &lastIFrame, &timeOffset_ms, &pos)) lastIFrame = 0;
+    search.frames = lastIFrame - segments[1].start;
+    FREE(sizeof(*ptr_cExtractLogo), "ptr_cExtractLogo");
+    delete ptr_cExtractLogo;
+    FREE(sizeof(*recordingIndex), "recordingIndex");
+    delete recordingIndex;
+    maContext.Info.ChannelName = NULL;
+
+    Report(benchCase, "cExtractLogo::SearchLogo", &search);
+    if (result != 0) printf("%-10s no logo found in synthetic recording\n", benchCase->name);
+    return (result == 0);
+}
+
+
+bool cMarkAdBench::Pipeline(const sBenchCase *benchCase, const bool analysisDecode, char *marks, const int size) {
+    sBenchResult pipeline;
+    char logoDir[1024];
+    char threadArg[32];
+    snprintf(logoDir, sizeof(logoDir), "--logocachedir=%s", benchDir);
+    snprintf(threadArg, sizeof(threadArg), "--threads=%d", threads);
+    const char *argv[] = {markad, logoDir, threadArg, "--autologo=2", "--loglevel=1", "-", recDir, NULL, NULL};
+    if (analysisDecode) {  // options have to be before cmd and recording directory
+        argv[7] = argv[6];
+        argv[6] = argv[5];
+        argv[5] = "--analysisdecode";
+    }
+
+    int64_t start = Now();
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        int devNull = open("/dev/null", O_WRONLY);
+        if (devNull >= 0) {
+            dup2(devNull, STDOUT_FILENO);
+            dup2(devNull, STDERR_FILENO);
+        }
+        execv(markad, const_cast<char * const *>(argv));
+        _exit(127);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    pipeline.ns = Now() - start;
+    bool ok = WIFEXITED(status) && (WEXITSTATUS(status) == 0);
+    pipeline.frames = (ok) ? frameCount : 0;
+    Report(benchCase, (analysisDecode) ? "markad --analysisdecode" : "markad full pipeline", &pipeline);
+
+    // read marks file to compare the result of different options
+    marks[0] = 0;
+    char marksFile[1024];
+    snprintf(marksFile, sizeof(marksFile), "%s/marks", recDir);
+    FILE *file = fopen(marksFile, "r");
+    if (file) {
+        size_t bytes = fread(marks, 1, size - 1, file);
+        marks[bytes] = 0;
+        fclose(file);
+    }
+    return ok;
+}
+
+
+bool cMarkAdBench::Run(const sBenchCase *benchCase) {
+    if (!avcodec_find_encoder(benchCase->codecID) || !avcodec_find_encoder(AV_CODEC_ID_AC3)) {
+        printf("%-10s skipped, no encoder available\n", benchCase->name);
+        return true;
+    }
+    sBenchResult generate;
+    int64_t start = Now();
+    if (!Generate(benchCase)) return false;
+    generate.ns = Now() - start;
+    generate.frames = frameCount;
+    Report(benchCase, "generate recording", &generate);
+
+    maContext.Config->recDir = recDir;
+    bool ok = Detectors(benchCase);
+    if (ok) ok = DecodeProfile(benchCase, false);
+    if (ok) ok = DecodeProfile(benchCase, true);
+    if (ok) ok = SearchLogo(benchCase);
+    if (markad) {
+        char marks[BENCH_MARKS_SIZE];
+        char marksAnalysis[BENCH_MARKS_SIZE];
+        ok = Pipeline(benchCase, false, marks, sizeof(marks)) && ok;
+        ok = Pipeline(benchCase, true, marksAnalysis, sizeof(marksAnalysis)) && ok;
+        if (strcmp(marks, marksAnalysis) == 0) printf("%-10s marks with --analysisdecode are identical\n", benchCase->name);
+        else {
+            printf("%-10s marks with --analysisdecode differ\n", benchCase->name);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+
+// random plane size, line start and line end to test the SIMD loops and the scalar rest of each line
+//
+bool cMarkAdBench::CheckSobelLine() {
+    const char *versionName[] = {"scalar", "SSE2", "AVX2"};
+    cMarkAdLogo *logo = new cMarkAdLogo(NULL, NULL);
+    ALLOC(sizeof(*logo), "logo");
+    bool ok = true;
+    unsigned int seed = 1;
+    for (int version = SOBEL_SSE2; version <= SOBEL_AVX2; version++) {
+        int lines = 0;
+        int diffPixel = 0;
+        bool supported = true;
+        for (int count = 0; supported && (count < BENCH_SOBEL_PLANES); count++) {
+            int width = 3 + rand_r(&seed) % 1000;
+            int height = 3 + rand_r(&seed) % 30;
+            int linesize = width + rand_r(&seed) % 64;
+            int cutval = 1 + rand_r(&seed) % 255;  // scalar version has no edge pixel with cutval > 255
+            std::vector<uchar> plane(linesize * height);
+            for (unsigned int i = 0; i < plane.size(); i++) plane[i] = rand_r(&seed);
+            std::vector<uchar> scalar(width);
+            std::vector<uchar> simd(width);
+            for (int Y = 1; Y < height - 1; Y++) {
+                const uchar *line = plane.data() + Y * linesize;
+                int xFrom = 1 + rand_r(&seed) % ((width - 1) / 2);
+                int xTo = width - 2 - rand_r(&seed) % ((width - 1) / 2);
+                if (xFrom > xTo) continue;
+                logo->SobelLineVersion(SOBEL_SCALAR, line, linesize, xFrom, xTo, cutval, scalar.data());
+                if (!logo->SobelLineVersion(version, line, linesize, xFrom, xTo, cutval, simd.data())) {
+                    supported = false;
+                    break;
+                }
+                for (int X = xFrom; X <= xTo; X++) {
+                    if (scalar[X] != simd[X]) diffPixel++;
+                }
+                lines++;
+            }
+        }
+        if (!supported) printf("%-10s %s not supported by CPU\n", "sobel", versionName[version]);
+        else if (diffPixel == 0) printf("%-10s %s identical to scalar on %d lines\n", "sobel", versionName[version], lines);
+        else {
+            printf("%-10s %s differs from scalar in %d pixel of %d lines\n", "sobel", versionName[version], diffPixel, lines);
+            ok = false;
+        }
+    }
+    fflush(stdout);
+    FREE(sizeof(*logo), "logo");
+    delete logo;
+    return ok;
+}
+
+
+// linear search of the recording index used before the frame to slot table, reference for CheckIndex()
+//
+static int LinearIFrameBefore(const std::vector<sBenchIFrame> &iFrames, const int frameNumber) {
+    int before_iFrame = 0;
+    for (std::vector<sBenchIFrame>::const_iterator iFrame = iFrames.begin(); iFrame != iFrames.end(); ++iFrame) {
+        if (iFrame->frameNumber >= frameNumber) return before_iFrame;
+        before_iFrame = iFrame->frameNumber;
+    }
+    return -2;
+}
+
+
+static int LinearIFrameAfter(const std::vector<sBenchIFrame> &iFrames, const int frameNumber) {
+    for (std::vector<sBenchIFrame>::const_iterator iFrame = iFrames.begin(); iFrame != iFrames.end(); ++iFrame) {
+        if (iFrame->frameNumber >= frameNumber) return iFrame->frameNumber;
+    }
+    return -1;
+}
+
+
+static int LinearTimeFromFrame(const std::vector<sBenchIFrame> &iFrames, const int frameNumber) {
+    int before_ms = 0;
+    int before_iFrame = 0;
+    for (std::vector<sBenchIFrame>::const_iterator iFrame = iFrames.begin(); iFrame != iFrames.end(); ++iFrame) {
+        if (iFrame->frameNumber == frameNumber) return iFrame->timeOffset_ms;
+        if (iFrame->frameNumber > frameNumber) {
+            if (abs(frameNumber - before_iFrame) < abs(frameNumber - iFrame->frameNumber)) return before_ms;
+            else return iFrame->timeOffset_ms;
+        }
+        before_iFrame = iFrame->frameNumber;
+        before_ms = iFrame->timeOffset_ms;
+    }
+    if (frameNumber > (iFrames.back().frameNumber - 30)) return iFrames.back().timeOffset_ms;
+    return -1;
+}
+
+
+static int LinearFrameFromOffset(const std::vector<sBenchIFrame> &iFrames, const int offset_ms) {
+    int iFrameBefore = 0;
+    for (std::vector<sBenchIFrame>::const_iterator iFrame = iFrames.begin(); iFrame != iFrames.end(); ++iFrame) {
+        if (iFrame->timeOffset_ms > offset_ms) return iFrameBefore;
+        iFrameBefore = iFrame->frameNumber;
+    }
+    return iFrameBefore;
+}
+
+
+static int LinearIFrameRangeCount(const std::vector<sBenchIFrame> &iFrames, const int beginFrame, const int endFrame) {
+    int counter = 0;
+    for (std::vector<sBenchIFrame>::const_iterator iFrame = iFrames.begin(); iFrame != iFrames.end(); ++iFrame) {
+        if (iFrame->frameNumber >= beginFrame) {
+            counter++;
+            if (iFrame->frameNumber >= endFrame) return counter;
+        }
+    }
+    return -1;
+}
+
+
+// index of a long recording with irregular GOP size, queries include frames and offsets before and after the recording
+//
+bool cMarkAdBench::CheckIndex() {
+    cIndex *index = new cIndex();
+    ALLOC(sizeof(*index), "index");
+    std::vector<sBenchIFrame> iFrames;
+    unsigned int seed = 1;
+    sBenchIFrame iFrame;
+    for (int i = 0; i < BENCH_INDEX_SIZE; i++) {
+        index->Add(1 + i / 20000, iFrame.frameNumber, iFrame.timeOffset_ms, static_cast<int64_t>(i) * 100000);
+        iFrames.push_back(iFrame);
+        int gop = 10 + rand_r(&seed) % 40;
+        iFrame.frameNumber += gop;
+        iFrame.timeOffset_ms += gop * 1000 / BENCH_FPS;
+    }
+    int lastFrame = iFrames.back().frameNumber;
+    int lastTime_ms = iFrames.back().timeOffset_ms;
+
+    std::vector<int> frames(BENCH_INDEX_QUERIES);
+    std::vector<int> ranges(BENCH_INDEX_QUERIES);
+    std::vector<int> offsets(BENCH_INDEX_QUERIES);
+    for (int i = 0; i < BENCH_INDEX_QUERIES; i++) {
+        frames[i] = rand_r(&seed) % (lastFrame + 200) - 100;
+        ranges[i] = rand_r(&seed) % 1000;
+        offsets[i] = rand_r(&seed) % (lastTime_ms + 2000) - 1000;
+    }
+
+    sBenchCase indexCase = {"index", AV_CODEC_ID_NONE, 0, 0, {0, 1}, 0, 0};
+    std::vector<int> linear;
+    sBenchResult linearResult;
+    int64_t start = Now();
+    for (int i = 0; i < BENCH_INDEX_QUERIES; i++) {
+        linear.push_back(LinearIFrameBefore(iFrames, frames[i]));
+        linear.push_back(LinearIFrameAfter(iFrames, frames[i]));
+        linear.push_back(LinearTimeFromFrame(iFrames, frames[i]));
+        linear.push_back(LinearFrameFromOffset(iFrames, offsets[i]));
+        linear.push_back(LinearIFrameRangeCount(iFrames, frames[i], frames[i] + ranges[i]));
+    }
+    linearResult.ns = Now() - start;
+    linearResult.frames = BENCH_INDEX_QUERIES;
+    Report(&indexCase, "linear search 5 queries", &linearResult);
+
+    std::vector<int> slot;
+    sBenchResult slotResult;
+    start = Now();
+    for (int i = 0; i < BENCH_INDEX_QUERIES; i++) {
+        slot.push_back(index->GetIFrameBefore(frames[i]));
+        slot.push_back(index->GetIFrameAfter(frames[i]));
+        slot.push_back(index->GetTimeFromFrame(frames[i]));
+        slot.push_back(index->GetFrameFromOffset(offsets[i]));
+        slot.push_back(index->GetIFrameRangeCount(frames[i], frames[i] + ranges[i]));
+    }
+    slotResult.ns = Now() - start;
+    slotResult.frames = BENCH_INDEX_QUERIES;
+    Report(&indexCase, "frame slot 5 queries", &slotResult);
+
+    int diff = 0;
+    for (unsigned int i = 0; i < linear.size(); i++) {
+        if (linear[i] != slot[i]) diff++;
+    }
+    if (diff == 0) printf("%-10s results of %d queries on %d i-frames identical\n", "index", static_cast<int>(linear.size()), BENCH_INDEX_SIZE);
+    else printf("%-10s %d of %d query results differ\n", "index", diff, static_cast<int>(linear.size()));
+    fflush(stdout);
+    FREE(sizeof(*index), "index");
+    delete index;
+    return (diff == 0);
+}
+
+
+int usage() {
+    printf("Usage: markad-bench [options]\n"
+           "generate synthetic vdr recordings and measure the speed of markad\n"
+           "options:\n"
+           "                --dir=<directory>\n"
+           "                  directory for the synthetic recordings (default /tmp/markad-bench)\n"
+           "                --length=<seconds>\n"
+           "                  length of each recording (default 600)\n"
+           "                --case=<name>\n"
+           "                  run only one test case: mpeg2-sd, mpeg2-hd, h264-sd or h264-hd\n"
+           "                --markad=<binary>\n"
+           "                  run full pipeline with this markad binary\n"
+           "                --threads=<number>\n"
+           "                  threads of the decoder (default 1)\n"
+           "                --loglevel=<level>\n"
+           "                  sets log level for the markad objects (default 1)\n"
+           "-h              --help\n"
+           "                  print this help and exit\n"
+           );
+    return EXIT_FAILURE;
+}
+
+
+int main(int argc, char *argv[]) {
+    const char *benchDir = "/tmp/markad-bench";
+    const char *markad = NULL;
+    const char *caseName = NULL;
+    int length = 600;
+    int threads = 1;
+
+    static struct option long_options[] = {
+        {"dir",      1, 0, 1},
+        {"length",   1, 0, 2},
+        {"case",     1, 0, 3},
+        {"markad",   1, 0, 4},
+        {"threads",  1, 0, 5},
+        {"loglevel", 1, 0, 6},
+        {"help",     0, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+    int option;
+    while ((option = getopt_long(argc, argv, "h", long_options, NULL)) != -1) {
+        switch (option) {
+            case 1:
+                benchDir = optarg;
+                break;
+            case 2:
+                length = atoi(optarg);
+                if (length < 60) length = 60;
+                break;
+            case 3:
+                caseName = optarg;
+                break;
+            case 4:
+                markad = optarg;
+                break;
+            case 5:
+                threads = atoi(optarg);
+                if (threads < 1) threads = 1;
+                if (threads > 16) threads = 16;
+                break;
+            case 6:
+                SysLogLevel = atoi(optarg);
+                break;
+            default:
+                return usage();
+        }
+    }
+    if (markad && (access(markad, X_OK) != 0)) {
+        fprintf(stderr, "markad binary %s not found, skip full pipeline\n", markad);
+        markad = NULL;
+    }
+    mkdir(benchDir, 0755);
+
+    printf("%-10s %-26s %8s %10s %12s %12s\n", "case", "test", "frames", "time ms", "frames/s", "ns/frame");
+    cMarkAdBench *bench = new cMarkAdBench(benchDir, length, markad, threads);
+    ALLOC(sizeof(*bench), "bench");
+    bool ok = cMarkAdBench::CheckSobelLine();
+    if (!cMarkAdBench::CheckIndex()) ok = false;
+    for (unsigned int i = 0; i < sizeof(benchCases) / sizeof(benchCases[0]); i++) {
+        if (caseName && (strcmp(caseName, benchCases[i].name) != 0)) continue;
+        if (!bench->Run(&benchCases[i])) ok = false;
+    }
+    FREE(sizeof(*bench), "bench");
+    delete bench;
+#ifdef DEBUG_MEM
+    memList();
+#endif
+    return (ok) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
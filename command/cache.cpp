@@ -0,0 +1,293 @@
+/*
+ * cache.cpp: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+extern "C" {
+    #include "debug.h"
+}
+
+
+static_assert((sizeof(sCacheHeader) % 8) == 0, "size of sCacheHeader must be a multiple of 8");
+static_assert((sizeof(sCacheIndex) % 8) == 0, "size of sCacheIndex must be a multiple of 8");
+static_assert((sizeof(sCacheMark) % 8) == 0, "size of sCacheMark must be a multiple of 8");
+
+
+cMarkAdCache::cMarkAdCache(const char *directoryParam) {
+    directory = directoryParam;
+    if (asprintf(&fileName, "%s/%s", directory, CACHE_FILENAME) == -1) fileName = NULL;
+    else {
+        ALLOC(strlen(fileName)+1, "fileName");
+    }
+}
+
+
+cMarkAdCache::~cMarkAdCache() {
+    Unload();
+    if (fileName) {
+        FREE(strlen(fileName)+1, "fileName");
+        free(fileName);
+    }
+}
+
+
+void cMarkAdCache::Unload() {
+    if (mapData) munmap(mapData, mapSize);
+    mapData = NULL;
+    mapSize = 0;
+    header = NULL;
+    indexRecords = NULL;
+    markRecords = NULL;
+}
+
+
+bool cMarkAdCache::GetRecordingSize(int32_t *tsFileCount, int64_t *recordingSize) {
+    if (!tsFileCount || !recordingSize) return false;
+    *tsFileCount = 0;
+    *recordingSize = 0;
+    for (int fileNumber = 1; ; fileNumber++) {
+        char *tsFile = NULL;
+        if (asprintf(&tsFile, "%s/%05d.ts", directory, fileNumber) == -1) return false;
+        ALLOC(strlen(tsFile)+1, "tsFile");
+        struct stat statbuf;
+        int rc = stat(tsFile, &statbuf);
+        FREE(strlen(tsFile)+1, "tsFile");
+        free(tsFile);
+        if (rc != 0) break;
+        (*tsFileCount)++;
+        *recordingSize += statbuf.st_size;
+    }
+    return (*tsFileCount > 0);
+}
+
+
+// store the logo directory as FNV-1a hash to keep the header small
+//
+void cMarkAdCache::SetOptions(const sMarkAdConfig *config, sCacheHeader *optHeader) {
+    optHeader->options = 0;
+    if (config->fullDecode)     optHeader->options |= CACHE_OPTION_FULLDECODE;
+    if (config->decodeVideo)    optHeader->options |= CACHE_OPTION_DECODEVIDEO;
+    if (config->decodeAudio)    optHeader->options |= CACHE_OPTION_DECODEAUDIO;
+    if (config->analysisDecode) optHeader->options |= CACHE_OPTION_ANALYSISDECODE;
+    optHeader->autoLogo = config->autoLogo;
+    optHeader->ignoreInfo = config->ignoreInfo;
+    optHeader->astopoffs = config->astopoffs;
+    optHeader->posttimer = config->posttimer;
+    uint32_t hash = 2166136261u;
+    for (const char *c = config->logoDirectory; *c && (c < config->logoDirectory + sizeof(config->logoDirectory)); c++) {
+        hash ^= static_cast<unsigned char>(*c);
+        hash *= 16777619u;
+    }
+    optHeader->logoDirectoryHash = hash;
+}
+
+
+// map cache file and check if it is valid for the current recording
+// all sections must be inside the file, we never read outside the mapped file
+//
+bool cMarkAdCache::Load(const sMarkAdConfig *config) {
+    Unload();
+    if (!fileName) return false;
+    if (!config) return false;
+
+    int fd = open(fileName, O_RDONLY);
+    if (fd == -1) {
+        dsyslog("cMarkAdCache::Load(): no cache file %s", fileName);
+        return false;
+    }
+    struct stat statbuf;
+    if ((fstat(fd, &statbuf) != 0) || (statbuf.st_size < static_cast<off_t>(sizeof(sCacheHeader)))) {
+        dsyslog("cMarkAdCache::Load(): cache file %s is too small", fileName);
+        close(fd);
+        return false;
+    }
+    mapSize = statbuf.st_size;
+    mapData = mmap(NULL, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapData == MAP_FAILED) {
+        dsyslog("cMarkAdCache::Load(): mmap of cache file %s failed", fileName);
+        mapData = NULL;
+        mapSize = 0;
+        return false;
+    }
+
+    const sCacheHeader *mapHeader = static_cast<const sCacheHeader *>(mapData);
+    sCacheHeader expected;
+    if ((memcmp(mapHeader->magic, expected.magic, sizeof(expected.magic)) != 0) || (mapHeader->version != CACHE_VERSION) ||
+        (mapHeader->headerSize != sizeof(sCacheHeader)) || (mapHeader->indexRecordSize != sizeof(sCacheIndex)) ||
+        (mapHeader->markRecordSize != sizeof(sCacheMark))) {
+        dsyslog("cMarkAdCache::Load(): cache file %s has an unsupported format version %u", fileName, mapHeader->version);
+        Unload();
+        return false;
+    }
+    if (((mapHeader->indexOffset % 8) != 0) || ((mapHeader->markOffset % 8) != 0) ||
+        (mapHeader->indexOffset + static_cast<uint64_t>(mapHeader->indexCount) * sizeof(sCacheIndex) > mapSize) ||
+        (mapHeader->markOffset  + static_cast<uint64_t>(mapHeader->markCount)  * sizeof(sCacheMark)  > mapSize)) {
+        esyslog("cache file %s is corrupt", fileName);
+        Unload();
+        return false;
+    }
+    int32_t tsFileCount = 0;
+    int64_t recordingSize = 0;
+    if (!GetRecordingSize(&tsFileCount, &recordingSize) || (tsFileCount != mapHeader->tsFileCount) || (recordingSize != mapHeader->recordingSize)) {
+        dsyslog("cMarkAdCache::Load(): recording has changed, cache file %s is outdated", fileName);
+        Unload();
+        return false;
+    }
+    sCacheHeader current;
+    SetOptions(config, &current);
+    if ((mapHeader->options != current.options) || (mapHeader->autoLogo != current.autoLogo) || (mapHeader->ignoreInfo != current.ignoreInfo) ||
+        (mapHeader->astopoffs != current.astopoffs) || (mapHeader->posttimer != current.posttimer) ||
+        (mapHeader->logoDirectoryHash != current.logoDirectoryHash)) {
+        isyslog("cache file %s was created with other detection options, ignore it", fileName);
+        dsyslog("cMarkAdCache::Load(): options 0x%X autologo %d ignoreinfo %d astopoffs %d posttimer %d in cache, current options 0x%X autologo %d ignoreinfo %d astopoffs %d posttimer %d", mapHeader->options, mapHeader->autoLogo, mapHeader->ignoreInfo, mapHeader->astopoffs, mapHeader->posttimer, current.options, current.autoLogo, current.ignoreInfo, current.astopoffs, current.posttimer);
+        Unload();
+        return false;
+    }
+
+    header = mapHeader;
+    indexRecords = reinterpret_cast<const sCacheIndex *>(static_cast<const char *>(mapData) + header->indexOffset);
+    markRecords  = reinterpret_cast<const sCacheMark *>(static_cast<const char *>(mapData) + header->markOffset);
+    dsyslog("cMarkAdCache::Load(): cache file %s loaded: %u i-frames, %u marks", fileName, header->indexCount, header->markCount);
+    return true;
+}
+
+
+bool cMarkAdCache::RestoreIndex(cIndex *recordingIndex) {
+    if (!recordingIndex) return false;
+    if (!header) return false;
+    for (uint32_t i = 0; i < header->indexCount; i++) {
+        recordingIndex->Add(indexRecords[i].fileNumber, indexRecords[i].frameNumber, indexRecords[i].timeOffset_ms, indexRecords[i].pos);
+    }
+    return (header->indexCount > 0);
+}
+
+
+bool cMarkAdCache::RestoreVideoInfo(sMarkAdContext *maContext) {
+    if (!maContext) return false;
+    if (!header) return false;
+    maContext->Info.vPidType = header->vPidType;
+    maContext->Info.AspectRatio.num = header->aspectRatioNum;
+    maContext->Info.AspectRatio.den = header->aspectRatioDen;
+    maContext->Video.Info.width = header->videoWidth;
+    maContext->Video.Info.height = header->videoHeight;
+    maContext->Video.Info.interlaced = (header->interlaced != 0);
+    maContext->Video.Info.framesPerSecond = header->framesPerSecond;
+    return true;
+}
+
+
+bool cMarkAdCache::RestoreMarks(cMarks *marks, cMarks *blackMarks) {
+    if (!marks || !blackMarks) return false;
+    if (!header) return false;
+    for (uint32_t i = 0; i < header->markCount; i++) {
+        char comment[sizeof(markRecords[i].comment) + 1] = {};
+        memcpy(comment, markRecords[i].comment, sizeof(markRecords[i].comment));
+        cMarks *list = (markRecords[i].list == 0) ? marks : blackMarks;
+        list->Add(markRecords[i].type, markRecords[i].position, (comment[0]) ? comment : NULL, (markRecords[i].inBroadCast != 0));
+    }
+    return (header->markCount > 0);
+}
+
+
+// write new cache file to a temporary file and rename it, so a concurrent reader never sees a partial file
+//
+bool cMarkAdCache::Save(const sMarkAdContext *maContext, cIndex *recordingIndex, cMarks *marks, cMarks *blackMarks) {
+    if (!maContext || !recordingIndex || !marks || !blackMarks) return false;
+    if (!fileName) return false;
+    if (maContext->Info.isRunningRecording) {
+        dsyslog("cMarkAdCache::Save(): recording is still running, do not write cache");
+        return false;
+    }
+
+    sCacheHeader newHeader;
+    if (!GetRecordingSize(&newHeader.tsFileCount, &newHeader.recordingSize)) return false;
+    newHeader.headerSize = sizeof(sCacheHeader);
+    newHeader.indexRecordSize = sizeof(sCacheIndex);
+    newHeader.markRecordSize = sizeof(sCacheMark);
+    newHeader.vPidType = maContext->Info.vPidType;
+    newHeader.videoWidth = maContext->Video.Info.width;
+    newHeader.videoHeight = maContext->Video.Info.height;
+    newHeader.aspectRatioNum = maContext->Info.AspectRatio.num;
+    newHeader.aspectRatioDen = maContext->Info.AspectRatio.den;
+    newHeader.interlaced = maContext->Video.Info.interlaced ? 1 : 0;
+    SetOptions(maContext->Config, &newHeader);
+    newHeader.framesPerSecond = maContext->Video.Info.framesPerSecond;
+    newHeader.indexCount = recordingIndex->Count();
+    newHeader.markCount = marks->Count() + blackMarks->Count();
+    newHeader.indexOffset = sizeof(sCacheHeader);
+    newHeader.markOffset = newHeader.indexOffset + static_cast<uint64_t>(newHeader.indexCount) * sizeof(sCacheIndex);
+
+    char *tmpFileName = NULL;
+    if (asprintf(&tmpFileName, "%s.tmp", fileName) == -1) return false;
+    ALLOC(strlen(tmpFileName)+1, "tmpFileName");
+    FILE *cacheFile = fopen(tmpFileName, "w");
+    if (!cacheFile) {
+        esyslog("failed to create cache file %s", tmpFileName);
+        FREE(strlen(tmpFileName)+1, "tmpFileName");
+        free(tmpFileName);
+        return false;
+    }
+
+    bool ok = (fwrite(&newHeader, sizeof(newHeader), 1, cacheFile) == 1);
+    for (uint32_t slot = 0; ok && (slot < newHeader.indexCount); slot++) {
+        sCacheIndex index;
+        int fileNumber = 0;
+        int frameNumber = 0;
+        int timeOffset_ms = 0;
+        ok = recordingIndex->GetElement(slot, &fileNumber, &frameNumber, &timeOffset_ms, &index.pos);
+        index.fileNumber = fileNumber;
+        index.frameNumber = frameNumber;
+        index.timeOffset_ms = timeOffset_ms;
+        if (ok) ok = (fwrite(&index, sizeof(index), 1, cacheFile) == 1);
+    }
+    for (int list = 0; list <= 1; list++) {
+        cMark *mark = (list == 0) ? marks->GetFirst() : blackMarks->GetFirst();
+        while (ok && mark) {
+            sCacheMark cacheMark;
+            cacheMark.position = mark->position;
+            cacheMark.type = mark->type;
+            cacheMark.inBroadCast = mark->inBroadCast ? 1 : 0;
+            cacheMark.list = list;
+            if (mark->comment) strncpy(cacheMark.comment, mark->comment, sizeof(cacheMark.comment) - 1);
+            ok = (fwrite(&cacheMark, sizeof(cacheMark), 1, cacheFile) == 1);
+            mark = mark->Next();
+        }
+    }
+    if (fclose(cacheFile) != 0) ok = false;
+
+    if (ok && (rename(tmpFileName, fileName) == 0)) {
+        if (getuid() == 0 || geteuid() != 0) {
+            // if we are root, set fileowner to owner of 00001.ts file
+            char *spath = NULL;
+            if (asprintf(&spath, "%s/00001.ts", directory) != -1) {
+                ALLOC(strlen(spath)+1, "spath");
+                struct stat statbuf;
+                if (!stat(spath, &statbuf)) {
+                    if (chown(fileName, statbuf.st_uid, statbuf.st_gid)) {};
+                }
+                FREE(strlen(spath)+1, "spath");
+                free(spath);
+            }
+        }
+        dsyslog("cMarkAdCache::Save(): cache file %s saved: %u i-frames, %u marks", fileName, newHeader.indexCount, newHeader.markCount);
+    }
+    else {
+        esyslog("failed to write cache file %s", fileName);
+        unlink(tmpFileName);
+        ok = false;
+    }
+    FREE(strlen(tmpFileName)+1, "tmpFileName");
+    free(tmpFileName);
+    return ok;
+}
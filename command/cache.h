@@ -0,0 +1,222 @@
+/*
+ * cache.h: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#ifndef __cache_h_
+#define __cache_h_
+
+#include <stdint.h>
+
+#include "global.h"
+#include "index.h"
+#include "marks.h"
+
+#define CACHE_FILENAME "markad.cache"  //!< name of the analysis cache file in the recording directory
+                                       //!<
+#define CACHE_VERSION  3               //!< version of the cache file format, increase on every change of the format
+                                       //!<
+
+#define CACHE_OPTION_FULLDECODE     0x01  //!< first pass decoded all frames (--fulldecode)
+                                          //!<
+#define CACHE_OPTION_DECODEVIDEO    0x02  //!< video stream was used to detect marks
+                                          //!<
+#define CACHE_OPTION_DECODEAUDIO    0x04  //!< audio streams were used to detect marks
+                                          //!<
+#define CACHE_OPTION_ANALYSISDECODE 0x08  //!< video was decoded with the analysis decode profile (--analysisdecode)
+                                          //!<
+
+
+/**
+ * header of the cache file <br>
+ * file layout: header, index records, mark records <br>
+ * all records have a fixed size and are 8 byte aligned, so the file can be used with mmap without copy
+ */
+struct sCacheHeader {
+    char magic[8] = {'M', 'A', 'R', 'K', 'A', 'D', 'C', 0}; //!< file magic "MARKADC"
+                                   //!<
+    uint32_t version = CACHE_VERSION; //!< version of the file format
+                                   //!<
+    uint32_t headerSize = 0;       //!< size of this header
+                                   //!<
+    uint32_t indexRecordSize = 0;  //!< size of a index record
+                                   //!<
+    uint32_t markRecordSize = 0;   //!< size of a mark record
+                                   //!<
+    int64_t recordingSize = 0;     //!< size of all ts files, cache is invalid if the recording changed
+                                   //!<
+    int32_t tsFileCount = 0;       //!< count of ts files of the recording
+                                   //!<
+    int32_t vPidType = 0;          //!< video packet identifier type
+                                   //!<
+    int32_t videoWidth = 0;        //!< video width
+                                   //!<
+    int32_t videoHeight = 0;       //!< video height
+                                   //!<
+    int32_t aspectRatioNum = 0;    //!< video display aspect ratio numerator
+                                   //!<
+    int32_t aspectRatioDen = 0;    //!< video display aspect ratio denominator
+                                   //!<
+    int32_t interlaced = 0;        //!< 1 if video is interlaced, 0 otherwise
+                                   //!<
+    uint32_t options = 0;          //!< CACHE_OPTION_* of the first pass
+                                   //!<
+    int32_t autoLogo = 0;          //!< --autologo of the first pass
+                                   //!<
+    int32_t ignoreInfo = 0;        //!< --ignoreinfo of the first pass
+                                   //!<
+    int32_t astopoffs = 0;         //!< --astopoffs of the first pass
+                                   //!<
+    int32_t posttimer = 0;         //!< --posttimer of the first pass
+                                   //!<
+    uint32_t logoDirectoryHash = 0; //!< hash of the logo cache directory of the first pass
+                                   //!<
+    double framesPerSecond = 0;    //!< frames per second of the recording
+                                   //!<
+    uint64_t indexOffset = 0;      //!< file offset of first index record
+                                   //!<
+    uint64_t markOffset = 0;       //!< file offset of first mark record
+                                   //!<
+    uint32_t indexCount = 0;       //!< count of index records
+                                   //!<
+    uint32_t markCount = 0;        //!< count of mark records
+                                   //!<
+};
+
+
+/**
+ * i-frame of the recording index
+ */
+struct sCacheIndex {
+    int32_t fileNumber = 0;        //!< number of ts file
+                                   //!<
+    int32_t frameNumber = 0;       //!< frame number of the i-frame
+                                   //!<
+    int32_t timeOffset_ms = 0;     //!< time offset from start of the recording in ms
+                                   //!<
+    int32_t reserved = 0;          //!< keep position 8 byte aligned
+                                   //!<
+    int64_t pos = -1;              //!< byte position of the i-frame packet in the ts file
+                                   //!<
+};
+
+
+/**
+ * mark of the first pass
+ */
+struct sCacheMark {
+    int32_t position = 0;          //!< frame number of the mark
+                                   //!<
+    int16_t type = 0;              //!< type of the mark
+                                   //!<
+    uint8_t inBroadCast = 0;       //!< 1 if mark is in broadcast, 0 otherwise
+                                   //!<
+    uint8_t list = 0;              //!< 0 for marks, 1 for blackscreen marks
+                                   //!<
+    char comment[72] = {};         //!< comment of the mark
+                                   //!<
+};
+
+
+/**
+ * persistent analysis cache of a recording <br>
+ * stores the recording index and the marks of the first pass in the recording directory,
+ * so a later run with --pass2only can use them without decoding the first pass again
+ */
+class cMarkAdCache {
+    public:
+
+/**
+ * constructor of the analysis cache
+ * @param directoryParam recording directory
+ */
+        explicit cMarkAdCache(const char *directoryParam);
+
+        ~cMarkAdCache();
+
+/**
+ * map cache file from recording directory into memory and validate it
+ * @param config markad config of this run, the cache is only valid if it was created with the same detection options
+ * @return true if cache file is valid for the current recording, false otherwise
+ */
+        bool Load(const sMarkAdConfig *config);
+
+/**
+ * check if a valid cache file is loaded
+ * @return true if a valid cache file is loaded, false otherwise
+ */
+        bool IsValid() {
+            return (header != NULL);
+        }
+
+/**
+ * add recording index from cache to recording index
+ * @param recordingIndex recording index
+ * @return true if successful, false otherwise
+ */
+        bool RestoreIndex(cIndex *recordingIndex);
+
+/**
+ * set video infos of markad context from cache
+ * @param maContext markad context
+ * @return true if successful, false otherwise
+ */
+        bool RestoreVideoInfo(sMarkAdContext *maContext);
+
+/**
+ * add marks of the first pass from cache
+ * @param marks      marks
+ * @param blackMarks blackscreen marks
+ * @return true if successful, false otherwise
+ */
+        bool RestoreMarks(cMarks *marks, cMarks *blackMarks);
+
+/**
+ * write new cache to recording directory
+ * @param maContext      markad context
+ * @param recordingIndex recording index
+ * @param marks          marks of the first pass
+ * @param blackMarks     blackscreen marks of the first pass
+ * @return true if successful, false otherwise
+ */
+        bool Save(const sMarkAdContext *maContext, cIndex *recordingIndex, cMarks *marks, cMarks *blackMarks);
+
+    private:
+/**
+ * set all detection options of a markad config which change the cached data
+ * @param[in]  config    markad config
+ * @param[out] optHeader header with options to set
+ */
+        static void SetOptions(const sMarkAdConfig *config, sCacheHeader *optHeader);
+
+/**
+ * get count and size of all ts files of the recording
+ * @param[out] tsFileCount   count of ts files
+ * @param[out] recordingSize size of all ts files
+ * @return true if successful, false otherwise
+ */
+        bool GetRecordingSize(int32_t *tsFileCount, int64_t *recordingSize);
+
+/**
+ * unmap cache file
+ */
+        void Unload();
+
+        char *fileName = NULL;                 //!< name of the cache file
+                                               //!<
+        const char *directory = NULL;          //!< recording directory
+                                               //!<
+        void *mapData = NULL;                  //!< mapped cache file
+                                               //!<
+        size_t mapSize = 0;                    //!< size of mapped cache file
+                                               //!<
+        const sCacheHeader *header = NULL;     //!< header of mapped cache file, NULL if no valid cache is loaded
+                                               //!<
+        const sCacheIndex *indexRecords = NULL; //!< index records of mapped cache file
+                                               //!<
+        const sCacheMark *markRecords = NULL;  //!< mark records of mapped cache file
+                                               //!<
+};
+#endif
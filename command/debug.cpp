@@ -18,12 +18,14 @@ extern "C"{
 
 
 int memUseSum = 0;
+int memAllocSum = 0;  // count of all allocations, shows heap usage of steady state loops
 struct memUse {
     int size = 0;
     int line = 0;
     char *file = NULL;
     char *var = NULL;
     int count = 0;
+    int allocCount = 0;
 };
 std::vector<memUse> memUseVector;
 pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -32,15 +34,17 @@ pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
 void memAlloc(int size, int line, char *file, char *var) {
     pthread_mutex_lock(&mutex);
     memUseSum += size;
+    memAllocSum++;
     tsyslog("debugmem alloc %7d bytes, file %s, line %4d, variable: %s", size, file, line, var);
     for (std::vector<memUse>::iterator memLine = memUseVector.begin(); memLine != memUseVector.end(); ++memLine) {
         if ((memLine->size == size) && (strcmp(memLine->file, file) == 0) && (strcmp(memLine->var, var) == 0)) {
             memLine->count++;
+            memLine->allocCount++;
             pthread_mutex_unlock(&mutex);
             return;
         }
     }
-    memUseVector.push_back({size, line, strdup(file), strdup(var), 1});
+    memUseVector.push_back({size, line, strdup(file), strdup(var), 1, 1});
     pthread_mutex_unlock(&mutex);
     return;
 }
@@ -74,6 +78,12 @@ void memFree(int size, int line, char *file, char *var) {
 
 void memList() {
     pthread_mutex_lock(&mutex);
+    dsyslog("debugmem alloc count start --------------------------------------------------------------------");
+    for (std::vector<memUse>::iterator memLine = memUseVector.begin(); memLine != memUseVector.end(); ++memLine) {
+        dsyslog("debugmem alloc count %8d times %7d bytes, file %s, line %4d, variable: %s", memLine->allocCount, memLine->size, memLine->file, memLine->line, memLine->var);
+    }
+    dsyslog("debugmem alloc count %8d allocations at all", memAllocSum);
+    dsyslog("debugmem alloc count end ----------------------------------------------------------------------");
     dsyslog("debugmem unmachted alloc start ----------------------------------------------------------------");
     for (std::vector<memUse>::iterator memLine = memUseVector.begin(); memLine != memUseVector.end(); ++memLine) {
         if (memLine->count > 0) {
@@ -6,15 +6,32 @@
  */
 
 #include <string>
+#include <algorithm>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <sys/time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 #include "decoder_new.h"
+#include "perf.h"
 extern "C" {
     #include "debug.h"
 }
 
 extern int decodeTime_us;
 
+#define PIPELINE_SIZE        512  // maximum packets in pipeline ring buffer
+#define PIPELINE_MAX_VIDEO    50  // maximum video packets in pipeline, keep distance to end of index of running recordings (see CheckIndexGrowing())
+#define PIPELINE_MAX_DECODED  16  // maximum decoded frames in pipeline, limit memory usage with full decode
+#define FRAME_POOL_SIZE       (PIPELINE_MAX_DECODED + 4)  // maximum empty frames in frame pool, pipeline frames + current frame + frame in decoding
+#define INPUT_BUFFER_SIZE     (188 * 1024)                // buffer size of concatenated input, multiple of ts packet size
+#define INPUT_READAHEAD_SIZE  (16 * 1024 * 1024)          // kernel read-ahead after read position of concatenated input
+#define INPUT_DROPBEHIND_SIZE (32 * 1024 * 1024)          // keep this data before read position in page cache for short seeks back
+
 
 void AVlog(__attribute__((unused)) void *ptr, int level, const char* fmt, va_list vl){
     if (level <= AVLOGLEVEL) {
@@ -46,6 +63,11 @@ void AVlog(__attribute__((unused)) void *ptr, int level, const char* fmt, va_lis
 }
 
 
+int64_t cDecoder::readLimit = 0;
+int64_t cDecoder::readLimitNext = 0;
+pthread_mutex_t cDecoder::readLimitMutex = PTHREAD_MUTEX_INITIALIZER;
+
+
 cDecoder::cDecoder(int threads, cIndex *recordingIndex) {
     av_log_set_level(AVLOGLEVEL);
     av_log_set_callback(AVlog);
@@ -62,27 +84,44 @@ cDecoder::cDecoder(int threads, cIndex *recordingIndex) {
 
 
 cDecoder::~cDecoder() {
+    PipelineStopThread();
+    SparseStop();
+    if (pipelineFrame) FramePoolPut(&pipelineFrame);
     av_packet_unref(&avpkt);
-    if (avctx && codecCtxArray) {
-        for (unsigned int streamIndex = 0; streamIndex < avctx->nb_streams; streamIndex++) {
-            if (codecCtxArray[streamIndex]) {
-                FREE(sizeof(*codecCtxArray[streamIndex]), "codecCtxArray[streamIndex]");
-                avcodec_free_context(&codecCtxArray[streamIndex]);
-            }
-        }
-        FREE(sizeof(AVCodecContext *) * avctx->nb_streams, "codecCtxArray");
-        free(codecCtxArray);
-
-        avformat_close_input(&avctx);
+    FreeCodecContext();
+    if (avctx) avformat_close_input(&avctx);
+    if (inputContext) {
+        FREE(INPUT_BUFFER_SIZE, "inputBuffer");
+        av_freep(&inputContext->buffer);
+#if LIBAVFORMAT_VERSION_INT >= ((57<<16)+(80<<8)+100)
+        avio_context_free(&inputContext);
+#else
+        av_freep(&inputContext);
+#endif
     }
+    if (inputFd >= 0) close(inputFd);
     if (recordingDir) {
         FREE(strlen(recordingDir), "recordingDir");
         free(recordingDir);
     }
-    if (avFrame) {
-        FREE(sizeof(*avFrame), "avFrame");
-        av_frame_free(&avFrame);
+    if (avFrame) FramePoolPut(&avFrame);
+    for (std::vector<AVFrame *>::iterator frame = framePool.begin(); frame != framePool.end(); ++frame) {
+        FREE(sizeof(**frame), "avFrame");
+        av_frame_free(&(*frame));
+    }
+    framePool.clear();
+#ifdef DEBUG_MEM
+    int size = levelTrack.size();
+    for (int i = 0 ; i < size; i++) {
+        FREE(sizeof(sAudioLevel), "levelTrack");
     }
+    size = videoPTSTrack.size();
+    for (int i = 0 ; i < size; i++) {
+        FREE(sizeof(int64_t), "videoPTSTrack");
+    }
+#endif
+    levelTrack.clear();
+    videoPTSTrack.clear();
 }
 
 
@@ -93,7 +132,6 @@ int cDecoder::GetErrorCount() {
 
 bool cDecoder::DecodeDir(const char *recDir) {
     if (!recDir) return false;
-    char *filename;
     if (!recordingDir) {
         if (asprintf(&recordingDir,"%s", recDir) == -1) {
             dsyslog("cDecoder::DecodeDir(): failed to allocate string, out of memory?");
@@ -101,8 +139,32 @@ bool cDecoder::DecodeDir(const char *recDir) {
         }
         ALLOC(strlen(recordingDir), "recordingDir");
     }
-    fileNumber++;
-    if (asprintf(&filename, "%s/%05i.ts", recDir, fileNumber) == -1) {
+    if (pipelineEnabled) PipelineStopThread();  // producer thread has to finish read before we change read position
+
+    // concatenated input is already open
+    if (avctx) {
+        if (fileNumber == 0) {  // restart from first file after Reset()
+            dsyslog("cDecoder::DecodeDir(): restart from first file");
+            for (unsigned int streamIndex = 0; streamIndex < codecCtxCount; streamIndex++) {
+                if (codecCtxArray[streamIndex]) avcodec_flush_buffers(codecCtxArray[streamIndex]);
+            }
+            offsetTime_ms_LastFile = 0;
+            if (av_seek_frame(avctx, -1, 0, AVSEEK_FLAG_BYTE) < 0) {
+                dsyslog("cDecoder::DecodeDir(): seek to start of first file failed");
+                return false;
+            }
+            fileNumber = 1;
+            return true;
+        }
+        // end of input reached, continue if VDR has started a new ts file meanwhile
+        if (InputGetFileStart(inputFileNumber + 1) < 0) return false;
+        dsyslog("cDecoder::DecodeDir(): ts file %d found after end of input, continue", inputFileNumber + 1);
+        avctx->pb->eof_reached = 0;
+        return true;
+    }
+
+    char *filename;
+    if (asprintf(&filename, "%s/%05i.ts", recDir, 1) == -1) {
         dsyslog("cDecoder::DecodeDir(): failed to allocate string, out of memory?");
         return false;
     }
@@ -114,6 +176,12 @@ bool cDecoder::DecodeDir(const char *recDir) {
 }
 
 
+bool cDecoder::OpenDir(const char *recDir) {
+    if (avctx) return true;
+    return DecodeDir(recDir);
+}
+
+
 int cDecoder::GetFileNumber() {
     return fileNumber;
 }
@@ -124,6 +192,7 @@ void cDecoder::Reset(){
     currFrameNumber = -1;
     msgGetFrameInfo = false;
     dtsBefore = -1;
+    sparseJumped = false;
 }
 
 
@@ -144,27 +213,36 @@ bool cDecoder::DecodeFile(const char *filename) {
 #if LIBAVCODEC_VERSION_INT < ((58<<16)+(35<<8)+100)
     av_register_all();
 #endif
-    // free codec context before alloc for new file
-    if (codecCtxArray) {
-        for (unsigned int streamIndex = 0; streamIndex < avctx->nb_streams; streamIndex++) {
-            if (codecCtxArray[streamIndex]) {
-                FREE(sizeof(*codecCtxArray[streamIndex]), "codecCtxArray[streamIndex]");
-                avcodec_free_context(&codecCtxArray[streamIndex]);
-            }
-        }
-        FREE(sizeof(AVCodecContext *) * avctx->nb_streams, "codecCtxArray");
-        free(codecCtxArray);
-        codecCtxArray = NULL;
-    }
+    if (avctx || !recordingDir) return false;
 
-    // open first/next file
-    if (avformat_open_input(&avctxNextFile, filename, NULL, NULL) == 0) {
+    // all ts files of the recording are read as one continuous input
+    if (!InputOpenFile(1)) {
+        dsyslog("cDecoder::DecodeFile(): Could not open source file %s", filename);
+        return false;
+    }
+    inputFileStart.clear();
+    inputFileStart.push_back(0);
+    inputPos = 0;
+    unsigned char *inputBuffer = static_cast<unsigned char *>(av_malloc(INPUT_BUFFER_SIZE));
+    if (!inputBuffer) return false;
+    ALLOC(INPUT_BUFFER_SIZE, "inputBuffer");
+    inputContext = avio_alloc_context(inputBuffer, INPUT_BUFFER_SIZE, 0, this, InputRead, NULL, InputSeek);
+    if (!inputContext) {
+        FREE(INPUT_BUFFER_SIZE, "inputBuffer");
+        av_free(inputBuffer);
+        return false;
+    }
+    avctxNextFile = avformat_alloc_context();
+    if (!avctxNextFile) return false;
+    avctxNextFile->pb = inputContext;
+    avctxNextFile->flags |= AVFMT_FLAG_CUSTOM_IO;
+    if (avformat_open_input(&avctxNextFile, filename, NULL, NULL) == 0) {  // frees avctxNextFile on error
         dsyslog("cDecoder::DecodeFile(): opened file %s", filename);
-        if (avctx) avformat_close_input(&avctx);
         avctx = avctxNextFile;
+        fileNumber = 1;
     }
     else {
-        if (fileNumber <= 1) dsyslog("cDecoder::DecodeFile(): Could not open source file %s", filename);
+        dsyslog("cDecoder::DecodeFile(): Could not open source file %s", filename);
         return false;
     }
     if (avformat_find_stream_info(avctx, NULL) < 0) {
@@ -172,11 +250,13 @@ bool cDecoder::DecodeFile(const char *filename) {
         return false;
     }
 
-    codecCtxArray = (AVCodecContext **) malloc(sizeof(AVCodecContext *) * avctx->nb_streams);
-    ALLOC(sizeof(AVCodecContext *) * avctx->nb_streams, "codecCtxArray");
-    memset(codecCtxArray, 0, sizeof(AVCodecContext *) * avctx->nb_streams);
+    codecCtxCount = avctx->nb_streams;  // demuxer can add streams later, we have no codec context for them
+    codecCtxArray = (AVCodecContext **) malloc(sizeof(AVCodecContext *) * codecCtxCount);
+    ALLOC(sizeof(AVCodecContext *) * codecCtxCount, "codecCtxArray");
+    memset(codecCtxArray, 0, sizeof(AVCodecContext *) * codecCtxCount);
+    StoreStreamInfo();
 
-    for (unsigned int streamIndex = 0; streamIndex < avctx->nb_streams; streamIndex++) {
+    for (unsigned int streamIndex = 0; streamIndex < codecCtxCount; streamIndex++) {
 #if LIBAVCODEC_VERSION_INT >= ((57<<16)+(64<<8)+101)
         AVCodecID codec_id = avctx->streams[streamIndex]->codecpar->codec_id;
         codec = avcodec_find_decoder(codec_id);
@@ -221,17 +301,310 @@ bool cDecoder::DecodeFile(const char *filename) {
             dsyslog("cDecoder::DecodeFile(): real    framerate %d/%d", avctx->streams[streamIndex]->r_frame_rate.num, avctx->streams[streamIndex]->r_frame_rate.den);
         }
     }
-    if (fileNumber <= 1) offsetTime_ms_LastFile = 0;
+    offsetTime_ms_LastFile = 0;  // time offset of packets is from start of first file
+    ApplyStreamSelection();
+    ApplyDecodeProfile();
+    return true;
+}
+
+
+// store stream infos after probe, the demuxer can add or reallocate streams while the pipeline thread reads packets
+//
+void cDecoder::StoreStreamInfo() {
+    streamInfo.clear();
+    streamInfo.resize(codecCtxCount);
+    for (unsigned int streamIndex = 0; streamIndex < codecCtxCount; streamIndex++) {
+        AVStream *stream = avctx->streams[streamIndex];
+        sStreamInfo *info = &streamInfo[streamIndex];
+#if LIBAVCODEC_VERSION_INT >= ((57<<16)+(64<<8)+101)
+        info->codecType = stream->codecpar->codec_type;
+        info->codecId   = stream->codecpar->codec_id;
+        info->channels  = stream->codecpar->channels;
+        info->width     = stream->codecpar->width;
+        info->height    = stream->codecpar->height;
+#else
+        info->codecType = stream->codec->codec_type;
+        info->codecId   = stream->codec->codec_id;
+        info->channels  = stream->codec->channels;
+        info->width     = stream->codec->width;
+        info->height    = stream->codec->height;
+#endif
+#define AUDIOFORMATAC3 8
+#if LIBAVCODEC_VERSION_INT >= ((58<<16)+(35<<8)+100)
+        info->isAC3 = (stream->codecpar->codec_id == AV_CODEC_ID_AC3);
+#elif LIBAVCODEC_VERSION_INT >= ((57<<16)+(64<<8)+101)
+        info->isAC3 = (stream->codecpar->format == AUDIOFORMATAC3);
+#else
+        info->isAC3 = (stream->codec->sample_fmt == AUDIOFORMATAC3);
+#endif
+        info->timeBase  = stream->time_base;
+        info->startTime = stream->start_time;
+        if (info->codecType != AVMEDIA_TYPE_VIDEO) continue;
+
+        info->avgFrameRate = av_q2d(stream->avg_frame_rate);
+#if LIBAVCODEC_VERSION_INT >= ((58<<16)+(35<<8)+100)
+        info->realFrameRate = av_q2d(stream->r_frame_rate);
+#else
+    #if LIBAVCODEC_VERSION_INT <= ((56<<16)+(1<<8)+0)    // Rasbian Jessie
+        AVRational r_frame_rate;
+        if ( stream->codec->time_base.den * (int64_t) stream->time_base.num <= stream->codec->time_base.num * stream->codec->ticks_per_frame * (int64_t) stream->time_base.den) {
+            r_frame_rate.num = stream->codec->time_base.den;
+            r_frame_rate.den = stream->codec->time_base.num * stream->codec->ticks_per_frame;
+        }
+        else {
+            r_frame_rate.num = stream->time_base.den;
+            r_frame_rate.den = stream->time_base.num;
+        }
+        info->realFrameRate = av_q2d(r_frame_rate);
+    #else
+        info->realFrameRate = av_q2d(av_stream_get_r_frame_rate(stream));
+    #endif
+#endif
+    }
+}
+
+
+void cDecoder::SelectStreams(const int streams) {
+    if (streams == streamSelection) return;
+    streamSelection = streams;
+    ApplyStreamSelection();
+}
+
+
+void cDecoder::SetAnalysisDecode(const bool enable, const bool fullDecode) {
+    if ((enable == analysisDecode) && (fullDecode == analysisFullDecode)) return;
+    analysisDecode = enable;
+    analysisFullDecode = fullDecode;
+    ApplyDecodeProfile();
+}
+
+
+// set skip flags of video decoder, skipped parts do not change luma statistics and edges much
+//
+void cDecoder::ApplyDecodeProfile() {
+    if (!codecCtxArray || pipelineThreadRunning) return;  // apply at next start of pipeline thread
+    for (unsigned int streamIndex = 0; streamIndex < codecCtxCount; streamIndex++) {
+        if (!codecCtxArray[streamIndex] || !IsVideoStream(streamIndex)) continue;
+        AVDiscard skipLoopFilter = AVDISCARD_DEFAULT;
+        AVDiscard skipIDCT       = AVDISCARD_DEFAULT;
+        AVDiscard skipFrame      = AVDISCARD_DEFAULT;
+        if (analysisDecode) {
+            switch (codecCtxArray[streamIndex]->codec_id) {
+                case AV_CODEC_ID_MPEG2VIDEO:  // no loop filter, i-frames have to be complete for logo detection
+                    skipIDCT = AVDISCARD_NONKEY;
+                    break;
+                case AV_CODEC_ID_H264:        // deblocking filter is a big part of decoding time
+                    skipLoopFilter = AVDISCARD_ALL;
+                    break;
+                case AV_CODEC_ID_H265:        // deblocking filter and SAO
+                    skipLoopFilter = AVDISCARD_ALL;
+                    break;
+                default:
+                    break;
+            }
+            if (analysisFullDecode) skipFrame = AVDISCARD_NONREF;  // b-frames are not needed to decode other frames
+        }
+        if ((codecCtxArray[streamIndex]->skip_loop_filter != skipLoopFilter) || (codecCtxArray[streamIndex]->skip_idct != skipIDCT) ||
+            (codecCtxArray[streamIndex]->skip_frame != skipFrame)) {
+            dsyslog("cDecoder::ApplyDecodeProfile(): stream %d: %s decode profile, skip loop filter %d, skip IDCT %d, skip frame %d", streamIndex,
+                                                                (analysisDecode) ? "analysis" : "full", skipLoopFilter, skipIDCT, skipFrame);
+            codecCtxArray[streamIndex]->skip_loop_filter = skipLoopFilter;
+            codecCtxArray[streamIndex]->skip_idct        = skipIDCT;
+            codecCtxArray[streamIndex]->skip_frame       = skipFrame;
+        }
+    }
+}
+
+
+void cDecoder::ApplyStreamSelection() {
+    if (!avctx || pipelineThreadRunning) return;  // apply at next start of pipeline thread
+    int firstMP2 = GetFirstMP2AudioStream();
+    for (unsigned int streamIndex = 0; streamIndex < avctx->nb_streams; streamIndex++) {
+        bool used = false;
+        if (streamIndex < codecCtxCount) {  // no codec context for streams added after probe
+            if (IsVideoStream(streamIndex)) used = true;
+            else if (IsAudioStream(streamIndex)) {
+                if (streamSelection & STREAMS_AUDIO_ALL) used = true;
+                else if ((streamSelection & STREAMS_AUDIO_AC3) && IsAudioAC3Stream(streamIndex)) used = true;
+                else if ((streamSelection & STREAMS_AUDIO_MP2) && (static_cast<int>(streamIndex) == firstMP2)) used = true;
+            }
+        }
+        AVDiscard discard = (used) ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+        if (avctx->streams[streamIndex]->discard != discard) {
+            dsyslog("cDecoder::ApplyStreamSelection(): stream %d %s", streamIndex, (used) ? "read" : "discarded");
+            avctx->streams[streamIndex]->discard = discard;
+        }
+    }
+}
+
+
+void cDecoder::FreeCodecContext() {
+    if (!codecCtxArray) return;
+    for (unsigned int streamIndex = 0; streamIndex < codecCtxCount; streamIndex++) {
+        if (codecCtxArray[streamIndex]) {
+            FREE(sizeof(*codecCtxArray[streamIndex]), "codecCtxArray[streamIndex]");
+            avcodec_free_context(&codecCtxArray[streamIndex]);
+        }
+    }
+    FREE(sizeof(AVCodecContext *) * codecCtxCount, "codecCtxArray");
+    free(codecCtxArray);
+    codecCtxArray = NULL;
+    codecCtxCount = 0;
+}
+
+
+bool cDecoder::InputOpenFile(const int number) {
+    if (!recordingDir) return false;
+    char *filename = NULL;
+    if (asprintf(&filename, "%s/%05i.ts", recordingDir, number) == -1) return false;
+    ALLOC(strlen(filename)+1, "filename");
+    int fd = open(filename, O_RDONLY);
+    FREE(strlen(filename)+1, "filename");
+    free(filename);
+    if (fd < 0) return false;
+    if (inputFd >= 0) {
+        posix_fadvise(inputFd, 0, 0, POSIX_FADV_DONTNEED);  // leave page cache to VDR
+        close(inputFd);
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    inputFd = fd;
+    inputFileNumber = number;
+    inputReadAheadPos = 0;
+    inputDropPos = 0;
     return true;
 }
 
 
+// request kernel read-ahead in large blocks and drop data already read from page cache,
+// VDR writes recordings to the same disk and should keep its page cache
+//
+void cDecoder::InputAdvise() {
+    if ((inputFd < 0) || (static_cast<int>(inputFileStart.size()) < inputFileNumber)) return;
+    int64_t pos = inputPos - inputFileStart[inputFileNumber - 1];  // position in current ts file
+
+    if (pos < inputReadAheadPos - INPUT_READAHEAD_SIZE) inputReadAheadPos = pos;  // after seek back
+    if (pos + INPUT_READAHEAD_SIZE / 2 > inputReadAheadPos) {
+        if (inputReadAheadPos < pos) inputReadAheadPos = pos;  // after seek forward
+        posix_fadvise(inputFd, inputReadAheadPos, pos + INPUT_READAHEAD_SIZE - inputReadAheadPos, POSIX_FADV_WILLNEED);
+        inputReadAheadPos = pos + INPUT_READAHEAD_SIZE;
+    }
+
+    if (pos - INPUT_DROPBEHIND_SIZE < inputDropPos) inputDropPos = std::max(pos - INPUT_DROPBEHIND_SIZE, static_cast<int64_t>(0));  // after seek back
+    if (pos - INPUT_DROPBEHIND_SIZE - inputDropPos >= INPUT_READAHEAD_SIZE) {
+        posix_fadvise(inputFd, inputDropPos, pos - INPUT_DROPBEHIND_SIZE - inputDropPos, POSIX_FADV_DONTNEED);
+        inputDropPos = pos - INPUT_DROPBEHIND_SIZE;
+    }
+}
+
+
+void cDecoder::SetReadLimit(const int mbPerSecond) {
+    pthread_mutex_lock(&readLimitMutex);
+    readLimit = static_cast<int64_t>(mbPerSecond) * 1024 * 1024;
+    readLimitNext = 0;
+    pthread_mutex_unlock(&readLimitMutex);
+    if (mbPerSecond > 0) dsyslog("cDecoder::SetReadLimit(): read bandwidth limited to %dMB/s", mbPerSecond);
+}
+
+
+// pace reads to the read limit, time not used for reading gives no credit for later bursts
+//
+void cDecoder::InputLimit(const int bytes) {
+    pthread_mutex_lock(&readLimitMutex);
+    if (readLimit <= 0) {
+        pthread_mutex_unlock(&readLimitMutex);
+        return;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t now_us = static_cast<int64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+    if (readLimitNext < now_us) readLimitNext = now_us;
+    int64_t wait_us = readLimitNext - now_us;
+    readLimitNext += static_cast<int64_t>(bytes) * 1000000 / readLimit;
+    pthread_mutex_unlock(&readLimitMutex);
+    if (wait_us > 0) usleep(wait_us);
+}
+
+
+int64_t cDecoder::InputGetFileStart(const int number) {
+    if (number < 1) return -1;
+    while (static_cast<int>(inputFileStart.size()) < number) {  // all previous files are complete if next file exists
+        int previous = inputFileStart.size();
+        char *filename = NULL;
+        if (asprintf(&filename, "%s/%05i.ts", recordingDir, previous + 1) == -1) return -1;
+        ALLOC(strlen(filename)+1, "filename");
+        struct stat statNext;
+        bool nextExists = (stat(filename, &statNext) == 0);
+        FREE(strlen(filename)+1, "filename");
+        free(filename);
+        if (!nextExists) return -1;
+
+        if (asprintf(&filename, "%s/%05i.ts", recordingDir, previous) == -1) return -1;
+        ALLOC(strlen(filename)+1, "filename");
+        struct stat statPrevious;
+        bool previousExists = (stat(filename, &statPrevious) == 0);
+        FREE(strlen(filename)+1, "filename");
+        free(filename);
+        if (!previousExists) return -1;
+        inputFileStart.push_back(inputFileStart.back() + statPrevious.st_size);
+    }
+    return inputFileStart[number - 1];
+}
+
+
+int cDecoder::InputRead(void *decoder, uint8_t *buffer, int size) {
+    cDecoder *ptr_cDecoder = static_cast<cDecoder *>(decoder);
+    while (true) {
+        if (ptr_cDecoder->inputFd < 0) return AVERROR_EOF;
+        ssize_t bytes = read(ptr_cDecoder->inputFd, buffer, size);
+        if (bytes > 0) {
+            InputLimit(bytes);
+            ptr_cDecoder->inputPos += bytes;
+            ptr_cDecoder->InputAdvise();
+            return bytes;
+        }
+        if (bytes < 0) return AVERROR(errno);
+
+        // end of current file, continue with next file
+        int64_t nextStart = ptr_cDecoder->InputGetFileStart(ptr_cDecoder->inputFileNumber + 1);
+        if (nextStart < 0) return AVERROR_EOF;
+        if (nextStart != ptr_cDecoder->inputPos) {
+            dsyslog("cDecoder::InputRead(): end of file %d at position %" PRId64 " does not match file size, start of next file %" PRId64, ptr_cDecoder->inputFileNumber, ptr_cDecoder->inputPos, nextStart);
+            ptr_cDecoder->inputPos = nextStart;
+        }
+        if (!ptr_cDecoder->InputOpenFile(ptr_cDecoder->inputFileNumber + 1)) return AVERROR_EOF;
+        dsyslog("cDecoder::InputRead(): continue with file %d at position %" PRId64, ptr_cDecoder->inputFileNumber, nextStart);
+    }
+}
+
+
+int64_t cDecoder::InputSeek(void *decoder, int64_t offset, int whence) {
+    cDecoder *ptr_cDecoder = static_cast<cDecoder *>(decoder);
+    if (whence & AVSEEK_SIZE) return -1;  // size of a growing recording is unknown
+    whence &= ~AVSEEK_FORCE;
+    if (whence == SEEK_CUR) offset += ptr_cDecoder->inputPos;
+    else if (whence != SEEK_SET) return -1;
+    if (offset < 0) return -1;
+
+    // find ts file of the position
+    int number = 1;
+    while (true) {
+        int64_t nextStart = ptr_cDecoder->InputGetFileStart(number + 1);
+        if ((nextStart < 0) || (nextStart > offset)) break;
+        number++;
+    }
+    if ((number != ptr_cDecoder->inputFileNumber) && !ptr_cDecoder->InputOpenFile(number)) return -1;
+    if (lseek(ptr_cDecoder->inputFd, offset - ptr_cDecoder->inputFileStart[number - 1], SEEK_SET) < 0) return -1;
+    ptr_cDecoder->inputPos = offset;
+    ptr_cDecoder->InputAdvise();
+    return offset;
+}
+
+
 int cDecoder::GetVideoType() {
     if (!avctx) return 0;
-    for (unsigned int i = 0; i < avctx->nb_streams; i++) {
-#if LIBAVCODEC_VERSION_INT >= ((57<<16)+(64<<8)+101)
-        if (avctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-            switch (avctx->streams[i]->codecpar->codec_id) {
+    for (unsigned int i = 0; i < streamInfo.size(); i++) {
+        if (streamInfo[i].codecType == AVMEDIA_TYPE_VIDEO) {
+            switch (streamInfo[i].codecId) {
                 case AV_CODEC_ID_MPEG2VIDEO:
                     dsyslog("cDecoder::GetVideoType(): video coding format: H.262");
                     return MARKAD_PIDTYPE_VIDEO_H262;
@@ -240,29 +613,17 @@ int cDecoder::GetVideoType() {
                     dsyslog("cDecoder::GetVideoType(): video coding format: H.264");
                     return MARKAD_PIDTYPE_VIDEO_H264;
                     break;
+#if LIBAVCODEC_VERSION_INT >= ((57<<16)+(64<<8)+101)
                 case AV_CODEC_ID_H265:
                     dsyslog("cDecoder::GetVideoType(): video coding format: H.265");
                     return MARKAD_PIDTYPE_VIDEO_H265;
                     break;
+#endif
                 default:
-                    dsyslog("cDecoder::GetVideoType(): video coding format unknown, coded id: %i", avctx->streams[i]->codecpar->codec_id);
+                    dsyslog("cDecoder::GetVideoType(): video coding format unknown, coded id: %i", streamInfo[i].codecId);
                     return 0;
             }
         }
-#else
-        if (avctx->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO) {
-            if (avctx->streams[i]->codec->codec_id == AV_CODEC_ID_MPEG2VIDEO) {
-                dsyslog("cDecoder::GetVideoType(): found H.262 Video");
-                return MARKAD_PIDTYPE_VIDEO_H262;
-            }
-            if (avctx->streams[i]->codec->codec_id == AV_CODEC_ID_H264) {
-                dsyslog("cDecoder::GetVideoType(): found H.264 Video");
-                return MARKAD_PIDTYPE_VIDEO_H264;
-            }
-           dsyslog("cDecoder::GetVideoType(): unknown coded id %i", avctx->streams[i]->codec->codec_id);
-           return 0;
-        }
-#endif
     }
     dsyslog("cDecoder::GetVideoType(): failed");
     return 0;
@@ -271,15 +632,8 @@ int cDecoder::GetVideoType() {
 
 int cDecoder::GetVideoHeight() {
     if (!avctx) return 0;
-    for (unsigned int i=0; i<avctx->nb_streams; i++) {
-#if LIBAVCODEC_VERSION_INT >= ((57<<16)+(64<<8)+101)
-        if (avctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-            return avctx->streams[i]->codecpar->height;
-#else
-        if (avctx->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO) {
-            return avctx->streams[i]->codec->height;
-#endif
-        }
+    for (unsigned int i = 0; i < streamInfo.size(); i++) {
+        if (streamInfo[i].codecType == AVMEDIA_TYPE_VIDEO) return streamInfo[i].height;
     }
     dsyslog("cDecoder::GetVideoHeight(): failed");
     return 0;
@@ -288,15 +642,8 @@ int cDecoder::GetVideoHeight() {
 
 int cDecoder::GetVideoWidth() {
     if (!avctx) return 0;
-    for (unsigned int i=0; i<avctx->nb_streams; i++) {
-#if LIBAVCODEC_VERSION_INT >= ((57<<16)+(64<<8)+101)
-        if (avctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-            return avctx->streams[i]->codecpar->width;
-#else
-        if (avctx->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO) {
-            return avctx->streams[i]->codec->width;
-#endif
-        }
+    for (unsigned int i = 0; i < streamInfo.size(); i++) {
+        if (streamInfo[i].codecType == AVMEDIA_TYPE_VIDEO) return streamInfo[i].width;
     }
     dsyslog("cDecoder::GetVideoWidth(): failed");
     return 0;
@@ -305,14 +652,8 @@ int cDecoder::GetVideoWidth() {
 
 int cDecoder::GetVideoAvgFrameRate() {
     if (!avctx) return 0;
-    for (unsigned int i=0; i<avctx->nb_streams; i++) {
-#if LIBAVCODEC_VERSION_INT >= ((57<<16)+(64<<8)+101)
-        if (avctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-#else
-        if (avctx->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO) {
-#endif
-            return av_q2d(avctx->streams[i]->avg_frame_rate);
-        }
+    for (unsigned int i = 0; i < streamInfo.size(); i++) {
+        if (streamInfo[i].codecType == AVMEDIA_TYPE_VIDEO) return streamInfo[i].avgFrameRate;
     }
     dsyslog("cDecoder::GetVideoAvgFrameRate(): could not find average frame rate");
     return 0;
@@ -320,37 +661,9 @@ int cDecoder::GetVideoAvgFrameRate() {
 
 
 int cDecoder::GetVideoRealFrameRate() {
-    if (videoRealFrameRate > 0) return videoRealFrameRate;
     if (!avctx) return 0;
-    for (unsigned int i=0; i<avctx->nb_streams; i++) {
-#if LIBAVCODEC_VERSION_INT >= ((57<<16)+(64<<8)+101)
-        if (avctx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-#else
-        if (avctx->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO) {
-#endif
-#if LIBAVCODEC_VERSION_INT >= ((58<<16)+(35<<8)+100)
-            videoRealFrameRate = av_q2d(avctx->streams[i]->r_frame_rate);
-            return videoRealFrameRate;
-#else
-    #if LIBAVCODEC_VERSION_INT <= ((56<<16)+(1<<8)+0)    // Rasbian Jessie
-            AVStream *st = avctx->streams[i];
-            AVRational r_frame_rate;
-            if ( st->codec->time_base.den * (int64_t) st->time_base.num <= st->codec->time_base.num * st->codec->ticks_per_frame * (int64_t) st->time_base.den) {
-                r_frame_rate.num = st->codec->time_base.den;
-                r_frame_rate.den = st->codec->time_base.num * st->codec->ticks_per_frame;
-            }
-            else {
-                r_frame_rate.num = st->time_base.den;
-                r_frame_rate.den = st->time_base.num;
-            }
-            videoRealFrameRate = av_q2d(r_frame_rate);
-            return videoRealFrameRate;
-    #else
-            videoRealFrameRate = av_q2d(av_stream_get_r_frame_rate(avctx->streams[i]));
-            return videoRealFrameRate;
-    #endif
-#endif
-        }
+    for (unsigned int i = 0; i < streamInfo.size(); i++) {
+        if (streamInfo[i].codecType == AVMEDIA_TYPE_VIDEO) return streamInfo[i].realFrameRate;
     }
     dsyslog("cDecoder::GetVideoRealFrameRate(): could not find real frame rate");
     return 0;
@@ -361,18 +674,24 @@ bool cDecoder::GetNextPacket() {
     if (!avctx) return false;
     FrameData.Valid = false;
     av_packet_unref(&avpkt);
-    if (av_read_frame(avctx, &avpkt) == 0 ) {
-#if LIBAVCODEC_VERSION_INT >= ((57<<16)+(64<<8)+101)
-        if (avctx->streams[avpkt.stream_index]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
-#else
-        if (avctx->streams[avpkt.stream_index]->codec->codec_type == AVMEDIA_TYPE_VIDEO)
-#endif
-        {
+    bool readOK;
+    if (pipelineEnabled) readOK = PipelineGetPacket();
+    else {
+        int frameNumber = currFrameNumber;
+        readOK = ReadPacket(&avpkt, &packetInfo, &frameNumber, stateEAGAIN);
+    }
+    if (readOK) {
+        fileNumber = packetInfo.fileNumber;
+        if (packetInfo.skippedFrames > 0) {  // sparse read jumped to next i-frame
+            currFrameNumber += packetInfo.skippedFrames;
+            dtsBefore = -1;
+        }
+        if (packetInfo.codecType == AVMEDIA_TYPE_VIDEO) {
             currFrameNumber++;
 
             // check DTS continuity
             if (dtsBefore != -1) {
-                int dtsDiff = 1000 * (avpkt.dts - dtsBefore) * avctx->streams[avpkt.stream_index]->time_base.num / avctx->streams[avpkt.stream_index]->time_base.den;
+                int dtsDiff = 1000 * (avpkt.dts - dtsBefore) * packetInfo.timeBase.num / packetInfo.timeBase.den;
                 int     dtsStep = 1000 / GetVideoRealFrameRate();
                 if (dtsDiff > dtsStep) {  // some interlaced H.264 streams have some frames with half DTS
                     if (currFrameNumber > decodeErrorFrame) {  // only count new frames
@@ -393,27 +712,23 @@ bool cDecoder::GetNextPacket() {
 
             // store frame number and pts in a ring buffer
             recordingIndexDecoder->AddPTS(currFrameNumber, avpkt.pts);
-            int64_t offsetTime_ms = -1;
-            if (avpkt.pts != AV_NOPTS_VALUE) {
-                int64_t tmp_pts = avpkt.pts - avctx->streams[avpkt.stream_index]->start_time;
-                if ( tmp_pts < 0 ) { tmp_pts += 0x200000000; }   // libavodec restart at 0 if pts greater than 0x200000000
-                offsetTime_ms = 1000 * tmp_pts * av_q2d(avctx->streams[avpkt.stream_index]->time_base);
-                offsetTime_ms_LastRead = offsetTime_ms_LastFile + offsetTime_ms;
-            }
+            if (levelTrackEnabled) AddLevelTrack();
+            int64_t offsetTime_ms = GetPacketTimeOffset_ms();
+            if (offsetTime_ms >= 0) offsetTime_ms_LastRead = offsetTime_ms_LastFile + offsetTime_ms;
             if (IsVideoIFrame()) {
                 iFrameCount++;
                 // store a iframe number pts offset in ms index
                 if (offsetTime_ms >= 0) {
-                    recordingIndexDecoder->Add(fileNumber, currFrameNumber, offsetTime_ms_LastFile + offsetTime_ms);
+                    recordingIndexDecoder->Add(fileNumber, currFrameNumber, offsetTime_ms_LastFile + offsetTime_ms, avpkt.pos);
                 }
                 else dsyslog("cDecoder::GetNextPacket(): failed to get pts for frame %d", currFrameNumber);
             }
         }
+        else if (levelTrackEnabled) AddLevelTrack();
         return true;
     }
-    // end of file reached
-    offsetTime_ms_LastFile = offsetTime_ms_LastRead;
-    dsyslog("cDecoder::GetNextPacket(): last frame of filenumber %d is (%d), end time %" PRId64 "ms (%3d:%02dmin)", fileNumber, currFrameNumber, offsetTime_ms_LastFile, static_cast<int> (offsetTime_ms_LastFile / 1000 / 60), static_cast<int> (offsetTime_ms_LastFile / 1000) % 60);
+    // end of input reached, timestamps of all ts files are continuous, no offset to add
+    dsyslog("cDecoder::GetNextPacket(): last frame of filenumber %d is (%d), end time %" PRId64 "ms (%3d:%02dmin)", fileNumber, currFrameNumber, offsetTime_ms_LastRead, static_cast<int> (offsetTime_ms_LastRead / 1000 / 60), static_cast<int> (offsetTime_ms_LastRead / 1000) % 60);
     if (decodeErrorFrame == currFrameNumber) decodeErrorCount--; // ignore malformed last frame of a file
     return false;
 }
@@ -424,14 +739,345 @@ AVPacket *cDecoder::GetPacket() {
 }
 
 
+// get offset of current packet from start of current ts file
+// return: offset in ms, -1 if packet has no PTS
+//
+int64_t cDecoder::GetPacketTimeOffset_ms() {
+    if (avpkt.pts == AV_NOPTS_VALUE) return -1;
+    int64_t tmp_pts = avpkt.pts - packetInfo.startTime;
+    if ( tmp_pts < 0 ) { tmp_pts += 0x200000000; }   // libavodec restart at 0 if pts greater than 0x200000000
+    return 1000 * tmp_pts * av_q2d(packetInfo.timeBase);
+}
+
+
+// store stream infos of a packet at read time, we need them after the demuxer has read further packets in pipeline mode
+//
+void cDecoder::GetPacketInfo(const AVPacket *packet, sPacketInfo *info) {
+    info->codecType = AVMEDIA_TYPE_UNKNOWN;
+    info->isAC3 = false;
+    info->channels = 0;
+    if ((packet->stream_index < 0) || (static_cast<unsigned int>(packet->stream_index) >= streamInfo.size())) return;
+    const sStreamInfo *stream = &streamInfo[packet->stream_index];
+    if (stream->codecType == AVMEDIA_TYPE_VIDEO) info->codecType = AVMEDIA_TYPE_VIDEO;
+    else if (stream->codecType == AVMEDIA_TYPE_AUDIO) {
+        info->codecType = AVMEDIA_TYPE_AUDIO;
+        info->isAC3 = stream->isAC3;
+        info->channels = stream->channels;
+    }
+    info->timeBase = stream->timeBase;
+    info->startTime = stream->startTime;
+}
+
+
+bool cDecoder::ReadPacket(AVPacket *packet, sPacketInfo *info, int *frameNumber, const bool eagain) {
+    int skippedFrames = 0;
+    while (true) {
+        {
+            cPerfTimer perfTimer(PERF_DEMUX);
+            if (av_read_frame(avctx, packet) != 0) return false;
+        }
+        if ((packet->stream_index < 0) || (static_cast<unsigned int>(packet->stream_index) >= codecCtxCount)) {  // stream added after probe
+            if (!inputNewStreamLogged) {
+                dsyslog("cDecoder::ReadPacket(): ignore packets of stream %d, stream is not in the first ts file", packet->stream_index);
+                inputNewStreamLogged = true;
+            }
+            if (packet->stream_index >= 0) avctx->streams[packet->stream_index]->discard = AVDISCARD_ALL;
+            av_packet_unref(packet);
+            continue;
+        }
+        // map position in concatenated input to ts file and position in this file
+        info->fileNumber = inputFileNumber;
+        if (packet->pos >= 0) {
+            std::vector<int64_t>::iterator fileStart = std::upper_bound(inputFileStart.begin(), inputFileStart.end(), packet->pos);
+            info->fileNumber = fileStart - inputFileStart.begin();
+            packet->pos -= inputFileStart[info->fileNumber - 1];
+        }
+        GetPacketInfo(packet, info);
+        info->skippedFrames = skippedFrames;
+        if (info->codecType != AVMEDIA_TYPE_VIDEO) return true;
+        (*frameNumber)++;
+        if (!vdrIndex) return true;
+
+        bool isIFrame = ((packet->flags & AV_PKT_FLAG_KEY) != 0);
+        if (sparseJumped) {  // first video packet after jump has to be the i-frame
+            sparseJumped = false;
+            if (!isIFrame) {
+                esyslog("sparse read: frame (%d) after jump is no i-frame, read all frames", *frameNumber);
+                SparseStop();
+                return true;
+            }
+        }
+        if (isIFrame) {
+            SparseCheckIFrame(*frameNumber, info->fileNumber, packet->pos);
+            return true;
+        }
+        if (!sparseActive || eagain) return true;  // decoder needs this frame to output the i-frame
+
+        // jump to next i-frame, read sequential if next i-frame is not yet in the index
+        int iFrameNumber = -1;
+        int iFileNumber = -1;
+        int64_t iFramePos = -1;
+        if (!vdrIndex->GetIFrameAfter(*frameNumber, &iFrameNumber, &iFileNumber, &iFramePos)) return true;
+        int64_t iFileStart = InputGetFileStart(iFileNumber);
+        if (iFileStart < 0) return true;  // next ts file not yet found
+        if (av_seek_frame(avctx, -1, iFileStart + iFramePos, AVSEEK_FLAG_BYTE) < 0) {
+            dsyslog("cDecoder::ReadPacket(): seek to i-frame (%d) at position %" PRId64 " failed, stop sparse read", iFrameNumber, iFramePos);
+            SparseStop();
+            return true;
+        }
+        av_packet_unref(packet);
+        skippedFrames += iFrameNumber - *frameNumber;  // current frame up to frame before i-frame
+        sparseSkippedFrames += iFrameNumber - *frameNumber;
+        *frameNumber = iFrameNumber - 1;
+        sparseJumped = true;
+    }
+}
+
+
+void cDecoder::SparseCheckIFrame(const int frameNumber, const int iFileNumber, const int64_t pos) {
+    if (!vdrIndex) return;
+    if (vdrIndex->IsIFrame(frameNumber, iFileNumber, pos)) {
+        if (!sparseActive) {
+            sparseCheckCount++;
+            if (sparseCheckCount >= SPARSE_CHECK_IFRAMES) {
+                dsyslog("cDecoder::SparseCheckIFrame(): %d i-frames match VDR index, start sparse read at frame (%d)", sparseCheckCount, frameNumber);
+                sparseActive = true;
+            }
+        }
+        return;
+    }
+    dsyslog("cDecoder::SparseCheckIFrame(): i-frame (%d) in file %d at position %" PRId64 " does not match VDR index, stop sparse read", frameNumber, iFileNumber, pos);
+    SparseStop();
+}
+
+
+void cDecoder::SparseStop() {
+    if (!vdrIndex) return;
+    dsyslog("cDecoder::SparseStop(): sparse read stopped, %d frames skipped", sparseSkippedFrames);
+    FREE(sizeof(*vdrIndex), "vdrIndex");
+    delete vdrIndex;
+    vdrIndex = NULL;
+    sparseActive = false;
+    sparseJumped = false;
+}
+
+
+void cDecoder::EnableSparseRead(const char *recDir) {
+    SparseStop();
+    if (!recDir) return;
+    vdrIndex = new cVDRIndex(recDir);
+    ALLOC(sizeof(*vdrIndex), "vdrIndex");
+    if (!vdrIndex->IsOpen()) {
+        SparseStop();
+        return;
+    }
+    sparseCheckCount = 0;
+    sparseSkippedFrames = 0;
+    dsyslog("cDecoder::EnableSparseRead(): read only i-frames after %d i-frames match the VDR index", SPARSE_CHECK_IFRAMES);
+}
+
+
+void cDecoder::EnablePipeline(const bool full) {
+    if (pipelineEnabled) return;
+    dsyslog("cDecoder::EnablePipeline(): decode %s in separate thread", (full) ? "all frames" : "i-frames");
+    pipelineFullDecode = full;
+    pipelineEAGAIN = stateEAGAIN;
+    pipelineRing.resize(PIPELINE_SIZE);
+    pipelineEnabled = true;
+}
+
+
+void cDecoder::DisablePipeline() {
+    if (!pipelineEnabled) return;
+    bool dropped = PipelineStopThread();
+    pipelineEnabled = false;
+    stateEAGAIN = false;
+    if (pipelineFrame) FramePoolPut(&pipelineFrame);
+    if (dropped) {  // demuxer has read ahead of the current packet, position is no longer valid
+        dsyslog("cDecoder::DisablePipeline(): pipeline was not empty at frame (%d), reset decoder", currFrameNumber);
+        Reset();
+        if (recordingDir) DecodeDir(recordingDir);
+    }
+    dsyslog("cDecoder::DisablePipeline(): pipeline disabled");
+}
+
+
+bool cDecoder::PipelineStartThread() {
+    pipelineHead = 0;
+    pipelineCount = 0;
+    pipelineVideoCount = 0;
+    pipelineDecodedCount = 0;
+    pipelineStop = false;
+    pipelineReadFrameNumber = currFrameNumber;
+    ApplyStreamSelection();  // selection can have changed while pipeline thread was running
+    ApplyDecodeProfile();
+    if (pthread_create(&pipelineThread, NULL, (void *(*) (void *))&PipelineRead, (void *) this) != 0) {
+        esyslog("cDecoder::PipelineStartThread(): failed to start decoder thread");
+        return false;
+    }
+    pipelineThreadRunning = true;
+    return true;
+}
+
+
+bool cDecoder::PipelineStopThread() {
+    if (!pipelineThreadRunning) return false;
+    pthread_mutex_lock(&pipelineMutex);
+    pipelineStop = true;
+    pthread_cond_broadcast(&pipelineCondWrite);
+    pthread_mutex_unlock(&pipelineMutex);
+    pthread_join(pipelineThread, NULL);
+    pipelineThreadRunning = false;
+
+    // free all packets and frames we have not used
+    bool dropped = pipelineDropped;
+    while (pipelineCount > 0) {
+        sPipelineElement *element = &pipelineRing[pipelineHead];
+        if (!element->eof) dropped = true;
+        av_packet_unref(&element->avpkt);
+        if (element->avFrame) FramePoolPut(&element->avFrame);
+        pipelineHead = (pipelineHead + 1) % PIPELINE_SIZE;
+        pipelineCount--;
+    }
+    pipelineDropped = false;
+    return dropped;
+}
+
+
+// producer thread: read and decode packets from current file and store them in the pipeline ring buffer
+//
+void *cDecoder::PipelineRead(void *decoder) {
+    cDecoder *ptr_cDecoder = static_cast<cDecoder *>(decoder);
+    int frameNumber = ptr_cDecoder->pipelineReadFrameNumber;
+    bool eagain = ptr_cDecoder->pipelineEAGAIN;
+    while (true) {
+        sPipelineElement element;
+        if (!ptr_cDecoder->ReadPacket(&element.avpkt, &element.info, &frameNumber, eagain)) element.eof = true;
+        else {
+            if (element.info.codecType == AVMEDIA_TYPE_VIDEO) {
+                // same decision as in GetFrameInfo()
+                if (ptr_cDecoder->pipelineFullDecode || ((element.avpkt.flags & AV_PKT_FLAG_KEY) != 0) || eagain) {
+                    element.decoded = true;
+                    element.avFrame = ptr_cDecoder->DecodePacketFrame(&element.avpkt, frameNumber, &eagain);
+                    if (element.avFrame) eagain = false;
+                }
+            }
+        }
+
+        pthread_mutex_lock(&ptr_cDecoder->pipelineMutex);
+        while (!ptr_cDecoder->pipelineStop && ((ptr_cDecoder->pipelineCount >= PIPELINE_SIZE) ||
+                                               (ptr_cDecoder->pipelineVideoCount >= PIPELINE_MAX_VIDEO) ||
+                                               (ptr_cDecoder->pipelineDecodedCount >= PIPELINE_MAX_DECODED))) {
+            pthread_cond_wait(&ptr_cDecoder->pipelineCondWrite, &ptr_cDecoder->pipelineMutex);
+        }
+        if (ptr_cDecoder->pipelineStop) {
+            if (!element.eof) ptr_cDecoder->pipelineDropped = true;
+            pthread_mutex_unlock(&ptr_cDecoder->pipelineMutex);
+            av_packet_unref(&element.avpkt);
+            if (element.avFrame) ptr_cDecoder->FramePoolPut(&element.avFrame);
+            break;
+        }
+        int tail = (ptr_cDecoder->pipelineHead + ptr_cDecoder->pipelineCount) % PIPELINE_SIZE;
+        ptr_cDecoder->pipelineRing[tail] = element;  // ring buffer takes ownership of packet and frame
+        ptr_cDecoder->pipelineCount++;
+        if (element.info.codecType == AVMEDIA_TYPE_VIDEO) ptr_cDecoder->pipelineVideoCount++;
+        if (element.avFrame) ptr_cDecoder->pipelineDecodedCount++;
+        pthread_cond_signal(&ptr_cDecoder->pipelineCondRead);
+        pthread_mutex_unlock(&ptr_cDecoder->pipelineMutex);
+        if (element.eof) break;
+    }
+    ptr_cDecoder->pipelineEAGAIN = eagain;
+    return NULL;
+}
+
+
+// consumer: get next packet from pipeline ring buffer, start producer thread if not running
+// return: true if we got a packet, false on end of file
+//
+bool cDecoder::PipelineGetPacket() {
+    if (!pipelineThreadRunning) {
+        if (!PipelineStartThread()) {  // fallback to read without pipeline
+            DisablePipeline();
+            int frameNumber = currFrameNumber;
+            return ReadPacket(&avpkt, &packetInfo, &frameNumber, stateEAGAIN);
+        }
+    }
+    pthread_mutex_lock(&pipelineMutex);
+    while (pipelineCount == 0) pthread_cond_wait(&pipelineCondRead, &pipelineMutex);
+    sPipelineElement element = pipelineRing[pipelineHead];
+    pipelineRing[pipelineHead] = sPipelineElement();
+    pipelineHead = (pipelineHead + 1) % PIPELINE_SIZE;
+    pipelineCount--;
+    if (element.info.codecType == AVMEDIA_TYPE_VIDEO) pipelineVideoCount--;
+    if (element.avFrame) pipelineDecodedCount--;
+    pthread_cond_signal(&pipelineCondWrite);
+    pthread_mutex_unlock(&pipelineMutex);
+
+    // decoded frame of previous packet was not used
+    if (pipelineFrame) FramePoolPut(&pipelineFrame);
+    if (element.eof) {
+        PipelineStopThread();  // producer thread ends after end of file
+        return false;
+    }
+    avpkt = element.avpkt;  // take ownership of packet
+    packetInfo = element.info;
+    pipelineDecoded = element.decoded;
+    pipelineFrame = element.avFrame;
+    return true;
+}
+
+
+// seek read position direct to the packet of an iFrame from the recording index, works forward and backward
+// if seek failed after read position was changed, decoder is reset to the start of the first file
+// return: true if current packet is the iFrame, false otherwise
+//
+bool cDecoder::SeekToIFrame(const int iFrameNumber) {
+    int iFrameFileNumber = 0;
+    int64_t iFramePos = -1;
+    int iFrameOffset_ms = 0;
+    if (!recordingIndexDecoder->GetIFramePosition(iFrameNumber, &iFrameFileNumber, &iFramePos, &iFrameOffset_ms)) {
+        dsyslog("cDecoder::SeekToIFrame(): iFrame (%d) position not in index", iFrameNumber);
+        return false;
+    }
+
+    // set read position to the iFrame packet in concatenated input
+    int64_t fileStart = InputGetFileStart(iFrameFileNumber);
+    bool seekOK = (fileStart >= 0);
+    if (seekOK && (av_seek_frame(avctx, -1, fileStart + iFramePos, AVSEEK_FLAG_BYTE) < 0)) seekOK = false;
+    if (seekOK) {
+        currFrameNumber = iFrameNumber - 1;
+        dtsBefore = -1;
+        stateEAGAIN = false;
+        while ((seekOK = GetNextPacket())) {
+            if (IsVideoPacket()) break;
+        }
+    }
+    // first video packet after seek have to be the iFrame
+    if (seekOK && ((avpkt.pos != iFramePos) || !IsVideoIFrame())) {
+        dsyslog("cDecoder::SeekToIFrame(): got packet at position %" PRId64 " expected iFrame (%d) at position %" PRId64, avpkt.pos, iFrameNumber, iFramePos);
+        seekOK = false;
+    }
+    if (!seekOK) {
+        dsyslog("cDecoder::SeekToIFrame(): seek to iFrame (%d) in file %d failed, restart from first file", iFrameNumber, iFrameFileNumber);
+        Reset();
+        DecodeDir(recordingDir);
+        return false;
+    }
+
+    // correct time offset, position can be reached without reading previous files
+    int64_t offsetTime_ms = GetPacketTimeOffset_ms();
+    if (offsetTime_ms >= 0) offsetTime_ms_LastFile = iFrameOffset_ms - offsetTime_ms;
+    offsetTime_ms_LastRead = iFrameOffset_ms;
+    dsyslog("cDecoder::SeekToIFrame(): seek to iFrame (%d) in file %d at position %" PRId64 " successful", iFrameNumber, fileNumber, iFramePos);
+    return true;
+}
+
+
 bool cDecoder::SeekToFrame(sMarkAdContext *maContext, int frameNumber) {
     dsyslog("cDecoder::SeekToFrame(): (%d)", frameNumber);
     if (!avctx) return false;
     if (!maContext) return false;
-    if (currFrameNumber > frameNumber) {
-        dsyslog("cDecoder::SeekToFrame(): current frame position (%d), could not seek backward to frame (%d)", currFrameNumber, frameNumber);
-        return false;
-    }
+    DisablePipeline();  // we can not seek with read ahead
 
     int iFrameBefore = recordingIndexDecoder->GetIFrameBefore(frameNumber);
     if (iFrameBefore == -1) {
@@ -445,7 +1091,7 @@ bool cDecoder::SeekToFrame(sMarkAdContext *maContext, int frameNumber) {
 
     // flush decoder buffer
     if (codecCtxArray) {
-        for (unsigned int streamIndex = 0; streamIndex < avctx->nb_streams; streamIndex++) {
+        for (unsigned int streamIndex = 0; streamIndex < codecCtxCount; streamIndex++) {
             if (codecCtxArray[streamIndex]) {
                 avcodec_flush_buffers(codecCtxArray[streamIndex]);
             }
@@ -456,6 +1102,19 @@ bool cDecoder::SeekToFrame(sMarkAdContext *maContext, int frameNumber) {
         return false;
     }
 
+    // jump direct to iFrame before if we have to seek backward or if we would skip at least one iFrame
+    if ((currFrameNumber > frameNumber) || (currFrameNumber < iFrameBefore)) {
+        if (SeekToIFrame(iFrameBefore)) GetFrameInfo(maContext, false);  // preload decoder buffer
+        else {
+            if (currFrameNumber > frameNumber) {  // no position of iFrame in index, restart from first file
+                dsyslog("cDecoder::SeekToFrame(): current frame position (%d), could not seek backward to frame (%d), restart from first file", currFrameNumber, frameNumber);
+                Reset();
+                if (!DecodeDir(recordingDir)) return false;
+            }
+            dsyslog("cDecoder::SeekToFrame(): read from frame (%d) to frame (%d)", currFrameNumber, frameNumber);
+        }
+    }
+
     while (currFrameNumber < frameNumber) {
         if (!this->GetNextPacket()) {
             if (!this->DecodeDir(recordingDir)) {
@@ -471,174 +1130,144 @@ bool cDecoder::SeekToFrame(sMarkAdContext *maContext, int frameNumber) {
 }
 
 
-AVFrame *cDecoder::DecodePacket(AVPacket *avpkt) {
+// get an empty frame from frame pool, only allocate a new frame if pool is empty
+// frame pool is used by calling thread and by pipeline thread
+//
+AVFrame *cDecoder::FramePoolGet() {
+    AVFrame *frame = NULL;
+    pthread_mutex_lock(&framePoolMutex);
+    if (!framePool.empty()) {
+        frame = framePool.back();
+        framePool.pop_back();
+    }
+    pthread_mutex_unlock(&framePoolMutex);
+    if (frame) return frame;
+
+    frame = av_frame_alloc();
+    if (frame) {
+        ALLOC(sizeof(*frame), "avFrame");
+    }
+    return frame;
+}
+
+
+// release frame buffers and give frame back to frame pool, free frame if pool is full
+//
+void cDecoder::FramePoolPut(AVFrame **frame) {
+    if (!frame || !*frame) return;
+    av_frame_unref(*frame);
+    pthread_mutex_lock(&framePoolMutex);
+    if (framePool.size() < FRAME_POOL_SIZE) {
+        framePool.push_back(*frame);
+        *frame = NULL;
+    }
+    pthread_mutex_unlock(&framePoolMutex);
+    if (*frame) {
+        FREE(sizeof(**frame), "avFrame");
+        av_frame_free(frame);
+    }
+}
+
+
+// decode a packet to a new allocated frame, do not change decoder state, we need this for the pipeline producer thread
+// frameNumber: only used for log messages
+// eagain:      set to true if decoder needs more packets
+// return: decoded frame, NULL on error or if decoder needs more packets
+//
+AVFrame *cDecoder::DecodePacketFrame(AVPacket *avpkt, const int frameNumber, bool *eagain) {
     if (!avctx) return NULL;
     if (!avpkt) return NULL;
 
+    cPerfTimer perfTimer(PERF_DECODE);
     struct timeval startDecode = {};
     gettimeofday(&startDecode, NULL);
 
-    if (avFrame) {  // reset avFrame structure
-        FREE(sizeof(*avFrame), "avFrame");
-        av_frame_free(&avFrame);
-    }
-    avFrame = av_frame_alloc();
-    if (!avFrame) {
-        dsyslog("cDecoder::DecodePacket(): av_frame_alloc failed");
+    if (!IsVideoStream(avpkt->stream_index) && !IsAudioStream(avpkt->stream_index)) {
+        dsyslog("cDecoder::DecodePacketFrame(): stream %d type not supported", avpkt->stream_index);
         return NULL;
     }
-    ALLOC(sizeof(*avFrame), "avFrame");
-
-    if (IsVideoPacket()) {
-#if LIBAVCODEC_VERSION_INT >= ((57<<16)+(64<<8)+101)
-        avFrame->height = avctx->streams[avpkt->stream_index]->codecpar->height;
-        avFrame->width = avctx->streams[avpkt->stream_index]->codecpar->width;
-        avFrame->format = codecCtxArray[avpkt->stream_index]->pix_fmt;
-#else
-        avFrame->height = avctx->streams[avpkt->stream_index]->codec->height;
-        avFrame->width = avctx->streams[avpkt->stream_index]->codec->width;
-        avFrame->format = codecCtxArray[avpkt->stream_index]->pix_fmt;
-#endif
-    }
-    else if (IsAudioPacket()) {
-#if LIBAVCODEC_VERSION_INT >= ((57<<16)+(64<<8)+101)
-        avFrame->nb_samples = av_get_channel_layout_nb_channels(avctx->streams[avpkt->stream_index]->codecpar->channel_layout);
-        avFrame->channel_layout = avctx->streams[avpkt->stream_index]->codecpar->channel_layout;
-        avFrame->format = avctx->streams[avpkt->stream_index]->codecpar->format;
-        avFrame->sample_rate = avctx->streams[avpkt->stream_index]->codecpar->sample_rate;
-#elif LIBAVCODEC_VERSION_INT >= ((56<<16)+(26<<8)+100)
-        avFrame->nb_samples = av_get_channel_layout_nb_channels(avctx->streams[avpkt->stream_index]->codec->channel_layout);
-        avFrame->channel_layout = avctx->streams[avpkt->stream_index]->codec->channel_layout;
-        avFrame->format = codecCtxArray[avpkt->stream_index]->sample_fmt;
-        avFrame->sample_rate = avctx->streams[avpkt->stream_index]->codec->sample_rate;
-#else  // Raspbian Jessie
-        avFrame->nb_samples = av_popcount64(avctx->streams[avpkt->stream_index]->codec->channel_layout);
-        avFrame->channel_layout = avctx->streams[avpkt->stream_index]->codec->channel_layout;
-        avFrame->format = codecCtxArray[avpkt->stream_index]->sample_fmt;
-        avFrame->sample_rate = avctx->streams[avpkt->stream_index]->codec->sample_rate;
-#endif
-    }
-    else {
-        dsyslog("cDecoder::DecodePacket(): stream %d type not supported", avpkt->stream_index);
-        FREE(sizeof(*avFrame), "avFrame");   // test if avFrame not NULL above
-        av_frame_free(&avFrame);
-        return NULL;
-    }
-    int rc = av_frame_get_buffer(avFrame, 32);
-    if (rc != 0) {
-        dsyslog("cDecoder::DecodePacket(): av_frame_get_buffer failed rc=%i", rc);
-        if (avFrame) {
-            FREE(sizeof(*avFrame), "avFrame");
-            av_frame_free(&avFrame);
-        }
+    // the decoder unrefs the frame and gets its buffers from its own buffer pool, so we need only an empty frame
+    AVFrame *frame = FramePoolGet();
+    if (!frame) {
+        dsyslog("cDecoder::DecodePacketFrame(): av_frame_alloc failed");
         return NULL;
     }
+    int rc = 0;
 
 #if LIBAVCODEC_VERSION_INT >= ((57<<16)+(64<<8)+101)
     rc=avcodec_send_packet(codecCtxArray[avpkt->stream_index],avpkt);
     if (rc  < 0) {
         switch (rc) {
             case AVERROR(EAGAIN):
-                dsyslog("cDecoder::DecodePacket(): avcodec_send_packet error EAGAIN at frame %d", currFrameNumber);
+                dsyslog("cDecoder::DecodePacketFrame(): avcodec_send_packet error EAGAIN at frame %d", frameNumber);
                 break;
             case AVERROR(ENOMEM):
-                dsyslog("cDecoder::DecodePacket(): avcodec_send_packet error ENOMEM at frame %d", currFrameNumber);
+                dsyslog("cDecoder::DecodePacketFrame(): avcodec_send_packet error ENOMEM at frame %d", frameNumber);
                 break;
             case AVERROR(EINVAL):
-                dsyslog("cDecoder::DecodePacket(): avcodec_send_packet error EINVAL at frame %d", currFrameNumber);
+                dsyslog("cDecoder::DecodePacketFrame(): avcodec_send_packet error EINVAL at frame %d", frameNumber);
                 break;
             case AVERROR_INVALIDDATA:
-                dsyslog("cDecoder::DecodePacket:(): avcodec_send_packet error AVERROR_INVALIDDATA at frame %d", currFrameNumber);
+                dsyslog("cDecoder::DecodePacketFrame(): avcodec_send_packet error AVERROR_INVALIDDATA at frame %d", frameNumber);
                 break;
 #if LIBAVCODEC_VERSION_INT >= ((58<<16)+(35<<8)+100)
             case AAC_AC3_PARSE_ERROR_SYNC:
-                dsyslog("cDecoder::DecodePacket:(): avcodec_send_packet error AAC_AC3_PARSE_ERROR_SYNC at frame %d", currFrameNumber);
+                dsyslog("cDecoder::DecodePacketFrame(): avcodec_send_packet error AAC_AC3_PARSE_ERROR_SYNC at frame %d", frameNumber);
                 break;
 #endif
             default:
-                dsyslog("cDecoder::DecodePacket(): avcodec_send_packet failed with rc=%d at frame %d",rc,currFrameNumber);
+                dsyslog("cDecoder::DecodePacketFrame(): avcodec_send_packet failed with rc=%d at frame %d",rc,frameNumber);
                 break;
             }
-        if (avFrame) {
-            FREE(sizeof(*avFrame), "avFrame");
-            av_frame_free(&avFrame);
-        }
+        if (frame) FramePoolPut(&frame);
         return NULL;
     }
-    rc = avcodec_receive_frame(codecCtxArray[avpkt->stream_index],avFrame);
+    rc = avcodec_receive_frame(codecCtxArray[avpkt->stream_index],frame);
     if (rc < 0) {
         switch (rc) {
             case AVERROR(EAGAIN):  // no error
-//                dsyslog("cDecoder::DecodePacket(): avcodec_receive_frame error EAGAIN at frame %d", currFrameNumber);
-                stateEAGAIN=true;
+//                dsyslog("cDecoder::DecodePacketFrame(): avcodec_receive_frame error EAGAIN at frame %d", frameNumber);
+                *eagain = true;
                 break;
             case AVERROR(EINVAL):
-                dsyslog("cDecoder::DecodePacket(): avcodec_receive_frame error EINVAL at frame %d", currFrameNumber);
+                dsyslog("cDecoder::DecodePacketFrame(): avcodec_receive_frame error EINVAL at frame %d", frameNumber);
                 break;
             default:
-                dsyslog("cDecoder::DecodePacket(): avcodec_receive_frame: decode of frame (%d) failed with return code %i", currFrameNumber, rc);
+                dsyslog("cDecoder::DecodePacketFrame(): avcodec_receive_frame: decode of frame (%d) failed with return code %i", frameNumber, rc);
                 break;
         }
-        if (avFrame) {
-            FREE(sizeof(*avFrame), "avFrame");
-            av_frame_free(&avFrame);
-            avFrame = NULL;
-        }
+        if (frame) FramePoolPut(&frame);
     }
 #else
     int frame_ready = 0;
-    if (IsVideoPacket()) {
-        rc = avcodec_decode_video2(codecCtxArray[avpkt->stream_index], avFrame, &frame_ready, avpkt);
+    if (IsVideoStream(avpkt->stream_index)) {
+        rc = avcodec_decode_video2(codecCtxArray[avpkt->stream_index], frame, &frame_ready, avpkt);
         if (rc < 0) {
-            dsyslog("cDecoder::DecodePacket(): avcodec_decode_video2 decode of frame (%d) from stream %i failed with return code %i", currFrameNumber, avpkt->stream_index, rc);
-            if (avFrame) {
-                FREE(sizeof(*avFrame), "avFrame");
-                av_frame_free(&avFrame);
-            }
+            dsyslog("cDecoder::DecodePacketFrame(): avcodec_decode_video2 decode of frame (%d) from stream %i failed with return code %i", frameNumber, avpkt->stream_index, rc);
+            if (frame) FramePoolPut(&frame);
             return NULL;
         }
     }
-    else if (IsAudioPacket()) {
-        rc = avcodec_decode_audio4(codecCtxArray[avpkt->stream_index], avFrame, &frame_ready, avpkt);
+    else if (IsAudioStream(avpkt->stream_index)) {
+        rc = avcodec_decode_audio4(codecCtxArray[avpkt->stream_index], frame, &frame_ready, avpkt);
         if (rc < 0) {
-            dsyslog("cDecoder::DecodePacket(): avcodec_decode_audio4 of frame (%d) from stream %i failed with return code %i", currFrameNumber, avpkt->stream_index, rc);
-            if (avFrame) {
-                FREE(sizeof(*avFrame), "avFrame");
-                av_frame_free(&avFrame);
-            }
+            dsyslog("cDecoder::DecodePacketFrame(): avcodec_decode_audio4 of frame (%d) from stream %i failed with return code %i", frameNumber, avpkt->stream_index, rc);
+            if (frame) FramePoolPut(&frame);
             return NULL;
         }
     }
 
     else {
-       dsyslog("cDecoder::DecodePacket(): packet type of stream %i not supported", avpkt->stream_index);
-       if (avFrame) {
-            FREE(sizeof(*avFrame), "avFrame");
-            av_frame_free(&avFrame);
-        }
+       dsyslog("cDecoder::DecodePacketFrame(): packet type of stream %i not supported", avpkt->stream_index);
+       if (frame) FramePoolPut(&frame);
        return NULL;
     }
     if ( !frame_ready ) {
-        stateEAGAIN=true;
-        if (avFrame) {
-            FREE(sizeof(*avFrame), "avFrame");
-            av_frame_free(&avFrame);
-        }
+        *eagain = true;
+        if (frame) FramePoolPut(&frame);
         return NULL;
     }
 #endif
-    // check decoding error
-    if (avFrame && (avFrame->decode_error_flags != 0)) {
-        if (currFrameNumber > decodeErrorFrame) {  // only count new frames
-            decodeErrorFrame = currFrameNumber;
-            decodeErrorCount++;
-        }
-        dsyslog("cDecoder::DecodePacket(): decoding of frame (%d) from stream %i failed: decode_error_flags %d, decoding errors %d", currFrameNumber, avpkt->stream_index, avFrame->decode_error_flags, decodeErrorCount);
-        FREE(sizeof(*avFrame), "avFrame");
-        av_frame_free(&avFrame);
-        avFrame = NULL;
-    }
-
     struct timeval endDecode = {};
     gettimeofday(&endDecode, NULL);
     time_t sec = endDecode.tv_sec - startDecode.tv_sec;
@@ -647,12 +1276,38 @@ AVFrame *cDecoder::DecodePacket(AVPacket *avpkt) {
         usec += 1000000;
         sec--;
     }
-    decodeTime_us += sec * 1000000 + usec;
+    __sync_fetch_and_add(&decodeTime_us, sec * 1000000 + usec);  // decoder of pipeline and logo search can run in parallel
+
+    return frame;
+}
+
+
+AVFrame *cDecoder::DecodePacket(AVPacket *avpkt) {
+    if (!avctx) return NULL;
+    if (!avpkt) return NULL;
 
+    if (avFrame) FramePoolPut(&avFrame);  // give frame of previous packet back to frame pool
+    avFrame = DecodePacketFrame(avpkt, currFrameNumber, &stateEAGAIN);
+    CheckDecodeError(avpkt->stream_index);
     return avFrame;
 }
 
 
+// check avFrame for decoding errors, count errors and free frame with errors
+//
+void cDecoder::CheckDecodeError(const int streamIndex) {
+    if (avFrame && (avFrame->decode_error_flags != 0)) {
+        if (currFrameNumber > decodeErrorFrame) {  // only count new frames
+            decodeErrorFrame = currFrameNumber;
+            decodeErrorCount++;
+        }
+        dsyslog("cDecoder::DecodePacket(): decoding of frame (%d) from stream %i failed: decode_error_flags %d, decoding errors %d", currFrameNumber, streamIndex, avFrame->decode_error_flags, decodeErrorCount);
+        FramePoolPut(&avFrame);
+    }
+
+}
+
+
 bool cDecoder::GetFrameInfo(sMarkAdContext *maContext, const bool full) {
     if (!maContext) return false;
     if (!avctx) return false;
@@ -661,8 +1316,17 @@ bool cDecoder::GetFrameInfo(sMarkAdContext *maContext, const bool full) {
 
     FrameData.Valid = false;
     if (IsVideoPacket()) {
-        if (full || IsVideoIFrame() || stateEAGAIN) {
-            avFrameRef = DecodePacket(&avpkt);  // free in DecodePacket
+        bool decode = full || IsVideoIFrame() || stateEAGAIN;
+        if (pipelineEnabled) decode = pipelineDecoded;  // packet is already decoded by pipeline thread
+        if (decode) {
+            if (pipelineEnabled) {
+                if (avFrame) FramePoolPut(&avFrame);  // release frame of previous decoded packet
+                avFrame = pipelineFrame;  // take ownership of decoded frame
+                pipelineFrame = NULL;
+                CheckDecodeError(avpkt.stream_index);
+                avFrameRef = avFrame;
+            }
+            else avFrameRef = DecodePacket(&avpkt);  // free in DecodePacket
             if (avFrameRef) {
                 stateEAGAIN=false;
                 if (avFrameRef->interlaced_frame != interlaced_frame) {
@@ -755,21 +1419,12 @@ bool cDecoder::GetFrameInfo(sMarkAdContext *maContext, const bool full) {
                 dsyslog("cDecoder::GetFrameInfo(): to much streams %i", avpkt.stream_index);
                 return false;
             }
-#if LIBAVCODEC_VERSION_INT >= ((57<<16)+(64<<8)+101)
-            if (maContext->Audio.Info.Channels[avpkt.stream_index] != avctx->streams[avpkt.stream_index]->codecpar->channels) {
-                dsyslog("cDecoder::GetFrameInfo(): audio channels of stream %d changed from %d to %d at frame (%d) PTS %" PRId64, avpkt.stream_index,
-                                                                                                        maContext->Audio.Info.Channels[avpkt.stream_index],
-                                                                                                        avctx->streams[avpkt.stream_index]->codecpar->channels,
-                                                                                                        currFrameNumber, avpkt.pts);
-                maContext->Audio.Info.Channels[avpkt.stream_index] = avctx->streams[avpkt.stream_index]->codecpar->channels;
-#else
-            if (maContext->Audio.Info.Channels[avpkt.stream_index] != avctx->streams[avpkt.stream_index]->codec->channels) {
+            if (maContext->Audio.Info.Channels[avpkt.stream_index] != packetInfo.channels) {
                 dsyslog("cDecoder::GetFrameInfo(): audio channels of stream %d changed from %d to %d at frame (%d) PTS %" PRId64, avpkt.stream_index,
                                                                                                         maContext->Audio.Info.Channels[avpkt.stream_index],
-                                                                                                        avctx->streams[avpkt.stream_index]->codec->channels,
+                                                                                                        packetInfo.channels,
                                                                                                         currFrameNumber, avpkt.pts);
-                maContext->Audio.Info.Channels[avpkt.stream_index] = avctx->streams[avpkt.stream_index]->codec->channels;
-#endif
+                maContext->Audio.Info.Channels[avpkt.stream_index] = packetInfo.channels;
                 maContext->Audio.Info.channelChangeFrame = currFrameNumber;
                 maContext->Audio.Info.channelChangePTS   = avpkt.pts;
             }
@@ -782,86 +1437,52 @@ bool cDecoder::GetFrameInfo(sMarkAdContext *maContext, const bool full) {
 
 bool cDecoder::IsVideoStream(const unsigned int streamIndex) {
     if (!avctx) return false;
-    if (streamIndex >= avctx->nb_streams) {
+    if (streamIndex >= streamInfo.size()) {
         dsyslog("cDecoder::IsVideoStream(): streamindex %d out of range", streamIndex);
         return false;
     }
-
-#if LIBAVCODEC_VERSION_INT >= ((57<<16)+(64<<8)+101)
-    if (avctx->streams[streamIndex]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) return true;
-#else
-    if (avctx->streams[streamIndex]->codec->codec_type == AVMEDIA_TYPE_VIDEO) return true;
-#endif
+    if (streamInfo[streamIndex].codecType == AVMEDIA_TYPE_VIDEO) return true;
     return false;
 }
 
 
 bool cDecoder::IsVideoPacket() {
     if (!avctx) return false;
-#if LIBAVCODEC_VERSION_INT >= ((57<<16)+(64<<8)+101)
-    if (avctx->streams[avpkt.stream_index]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) return true;
-#else
-    if (avctx->streams[avpkt.stream_index]->codec->codec_type == AVMEDIA_TYPE_VIDEO) return true;
-#endif
+    if (packetInfo.codecType == AVMEDIA_TYPE_VIDEO) return true;
     return false;
 }
 
 
 bool cDecoder::IsAudioStream(const unsigned int streamIndex) {
     if (!avctx) return false;
-    if (streamIndex >= avctx->nb_streams) {
+    if (streamIndex >= streamInfo.size()) {
         dsyslog("cDecoder::IsAudioStream(): streamindex %d out of range", streamIndex);
         return false;
     }
-
-#if LIBAVCODEC_VERSION_INT >= ((57<<16)+(64<<8)+101)
-    if (avctx->streams[streamIndex]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) return true;
-#else
-    if (avctx->streams[streamIndex]->codec->codec_type == AVMEDIA_TYPE_AUDIO) return true;
-#endif
+    if (streamInfo[streamIndex].codecType == AVMEDIA_TYPE_AUDIO) return true;
     return false;
 }
 
 
 bool cDecoder::IsAudioPacket() {
     if (!avctx) return false;
-#if LIBAVCODEC_VERSION_INT >= ((57<<16)+(64<<8)+101)
-    if (avctx->streams[avpkt.stream_index]->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) return true;
-#else
-    if (avctx->streams[avpkt.stream_index]->codec->codec_type == AVMEDIA_TYPE_AUDIO) return true;
-#endif
+    if (packetInfo.codecType == AVMEDIA_TYPE_AUDIO) return true;
     return false;
 }
 
 bool cDecoder::IsAudioAC3Stream(const unsigned int streamIndex) {
     if (!avctx) return false;
-    if (streamIndex >= avctx->nb_streams) {
+    if (streamIndex >= streamInfo.size()) {
         dsyslog("cDecoder::IsAudioAC3Stream(): streamindex %d out of range", streamIndex);
         return false;
     }
-#define AUDIOFORMATAC3 8
-#if LIBAVCODEC_VERSION_INT >= ((58<<16)+(35<<8)+100)
-    if (avctx->streams[streamIndex]->codecpar->codec_id == AV_CODEC_ID_AC3 ) return true;
-#elif LIBAVCODEC_VERSION_INT >= ((57<<16)+(64<<8)+101)
-    if (avctx->streams[streamIndex]->codecpar->format == AUDIOFORMATAC3) return true;
-#else
-    if (avctx->streams[streamIndex]->codec->sample_fmt == AUDIOFORMATAC3) return true;
-#endif
-    return false;
+    return streamInfo[streamIndex].isAC3;
 }
 
 
 bool cDecoder::IsAudioAC3Packet() {
     if (!avctx) return false;
-#define AUDIOFORMATAC3 8
-#if LIBAVCODEC_VERSION_INT >= ((58<<16)+(35<<8)+100)
-    if (avctx->streams[avpkt.stream_index]->codecpar->codec_id == AV_CODEC_ID_AC3 ) return true;
-#elif LIBAVCODEC_VERSION_INT >= ((57<<16)+(64<<8)+101)
-    if (avctx->streams[avpkt.stream_index]->codecpar->format == AUDIOFORMATAC3) return true;
-#else
-    if (avctx->streams[avpkt.stream_index]->codec->sample_fmt == AUDIOFORMATAC3) return true;
-#endif
-    return false;
+    return packetInfo.isAC3;
 }
 
 
@@ -890,25 +1511,107 @@ bool cDecoder::IsInterlacedVideo(){
 
 
 int cDecoder::GetFirstMP2AudioStream() {
-    for (unsigned int streamIndex = 0; streamIndex < avctx->nb_streams; streamIndex++) {
-#if LIBAVCODEC_VERSION_INT >= ((57<<16)+(64<<8)+101)
-        AVCodecID codec_id = avctx->streams[streamIndex]->codecpar->codec_id;
-#else
-        AVCodecID codec_id = avctx->streams[streamIndex]->codec->codec_id;
-#endif
-        if (codec_id == AV_CODEC_ID_MP2) return streamIndex;
+    for (unsigned int streamIndex = 0; streamIndex < streamInfo.size(); streamIndex++) {
+        if (streamInfo[streamIndex].codecId == AV_CODEC_ID_MP2) return streamIndex;
     }
     return -1;
 }
 
 
-// get next silence part
+// get average absolute sample value of all channels, use SSE2 to add 8 samples at once
+// return: level, -1 if sample format is not supported or frame has no samples
+//
+int cDecoder::GetAudioLevel(const AVFrame *audioFrame) {
+    if (!audioFrame) return -1;
+    if (audioFrame->format != AV_SAMPLE_FMT_S16P) return -1;
+    if ((audioFrame->nb_samples <= 0) || (audioFrame->channels <= 0)) return -1;
+    int64_t level = 0;
+    for (int channel = 0; channel < audioFrame->channels; channel++) {
+        const int16_t *samples = reinterpret_cast<const int16_t*>(audioFrame->data[channel]);
+        int sample = 0;
+#if defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        __m128i sum = _mm_setzero_si128();
+        for (; sample + 8 <= audioFrame->nb_samples; sample += 8) {
+            __m128i samples8 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + sample));
+            __m128i sign = _mm_srai_epi16(samples8, 15);
+            __m128i abs8 = _mm_sub_epi16(_mm_xor_si128(samples8, sign), sign);  // unsigned, abs(-32768) = 32768
+            sum = _mm_add_epi32(sum, _mm_unpacklo_epi16(abs8, zero));
+            sum = _mm_add_epi32(sum, _mm_unpackhi_epi16(abs8, zero));
+        }
+        uint32_t sum4[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(sum4), sum);
+        level += static_cast<int64_t>(sum4[0]) + sum4[1] + sum4[2] + sum4[3];
+#endif
+        for (; sample < audioFrame->nb_samples; sample++) {
+            level += abs(samples[sample]);
+        }
+    }
+    return level / audioFrame->nb_samples / audioFrame->channels;
+}
+
+
+void cDecoder::EnableLevelTrack(const bool enable) {
+    if (levelTrackEnabled == enable) return;
+    levelTrackEnabled = enable;
+    if (enable) dsyslog("cDecoder::EnableLevelTrack(): record audio level track");
+    else dsyslog("cDecoder::EnableLevelTrack(): audio level track of %d audio frames and %d video frames recorded", static_cast<int> (levelTrack.size()), static_cast<int> (videoPTSTrack.size()));
+}
+
+
+// add PTS of current video packet or audio level of current MP2 audio packet to level track
+// packets read again after a seek or reset are ignored
+//
+void cDecoder::AddLevelTrack() {
+    if (IsVideoPacket()) {
+        if (currFrameNumber < static_cast<int>(videoPTSTrack.size())) return;
+        while (static_cast<int>(videoPTSTrack.size()) < currFrameNumber) {  // frames without stored PTS
+            videoPTSTrack.push_back(-1);
+            ALLOC(sizeof(int64_t), "videoPTSTrack");
+        }
+        videoPTSTrack.push_back(avpkt.pts);
+        ALLOC(sizeof(int64_t), "videoPTSTrack");
+        return;
+    }
+    if (currFrameNumber < 0) return;
+    if (!levelTrack.empty() && (currFrameNumber < levelTrack.back().frameNumber)) return;
+    if (avpkt.stream_index != GetFirstMP2AudioStream()) return;
+
+    bool eagain = false;  // decode in a separate frame, do not change decoder state of current packet
+    AVFrame *audioFrame = DecodePacketFrame(&avpkt, currFrameNumber, &eagain);
+    if (!audioFrame) return;
+    if (audioFrame->format != AV_SAMPLE_FMT_S16P) {
+        dsyslog("cDecoder::AddLevelTrack(): sample format %s not supported, stop recording level track", av_get_sample_fmt_name((enum AVSampleFormat) audioFrame->format));
+        FramePoolPut(&audioFrame);
+#ifdef DEBUG_MEM
+        int size = levelTrack.size();
+        for (int i = 0 ; i < size; i++) {
+            FREE(sizeof(sAudioLevel), "levelTrack");
+        }
+#endif
+        levelTrack.clear();
+        levelTrackEnabled = false;
+        return;
+    }
+    int level = GetAudioLevel(audioFrame);
+    FramePoolPut(&audioFrame);
+    if (level < 0) return;
+    sAudioLevel audioLevel;
+    audioLevel.pts = avpkt.pts;
+    audioLevel.frameNumber = currFrameNumber;
+    audioLevel.level = level;
+    levelTrack.push_back(audioLevel);
+    ALLOC(sizeof(sAudioLevel), "levelTrack");
+}
+
+
+// find silence part in audio levels
 // return:
 // if <before> we are called at range before mark and return next iFrame after last silence part frame
 // if not <before> we are called direct after mark position and return iFrame before first silence part
 // -1 if no silence part were found
 //
-int cDecoder::GetNextSilence(sMarkAdContext *maContext, const int stopFrame, const bool isBeforeMark, const bool isStartMark) {
+int cDecoder::FindSilence(sMarkAdContext *maContext, const std::vector<sAudioLevel> &levels, const std::vector<sVideoPTS> &videoFrames, const bool isBeforeMark, const bool isStartMark) {
 #define SILENCE_LEVEL 25  // changed from 10 to 27 to 25
 #define SILENCE_COUNT 5   // low level counts twice
     struct silenceType {
@@ -924,16 +1627,136 @@ int cDecoder::GetNextSilence(sMarkAdContext *maContext, const int stopFrame, con
         int     count       =  0;
     } silence;
 
+    int lastVideoFrame = INT_MAX;  // video frames read after first silence part are not used if we are called after the mark
+    for (std::vector<sAudioLevel>::const_iterator audioLevel = levels.begin(); audioLevel != levels.end(); ++audioLevel) {
+#ifdef DEBUG_SILENCE
+        dsyslog("cDecoder::FindSilence(): frame (%5d) level %d", audioLevel->frameNumber, audioLevel->level);
+#endif
+        if (audioLevel->level <= SILENCE_LEVEL) {
+            silence.countTmp++;
+            if (audioLevel->level <= 7) silence.countTmp++;
+            if (silence.startTmp == -1) {
+                silence.startTmp = audioLevel->frameNumber;
+                silence.startTmpPTS = audioLevel->pts;
+            }
+            silence.endTmp = audioLevel->frameNumber;
+            silence.endTmpPTS = audioLevel->pts;
+            dsyslog("cDecoder::FindSilence(): frame (%5d) level %2d silenceCount %2d, pts %" PRId64, audioLevel->frameNumber, audioLevel->level, silence.countTmp, silence.endTmpPTS);
+        }
+        else {
+            if (silence.countTmp >= SILENCE_COUNT) { // min count reached, this part is valid
+                if (silence.startTmp >= 0) {  // end of silence part reached
+                    if (!isBeforeMark) {  // we are called after the mark, take first valid silence part
+                        lastVideoFrame = audioLevel->frameNumber;
+                        break;
+                    }
+                    if (silence.startFrame <= silence.startTmp) { // later result found
+                        silence.count      = silence.countTmp;
+                        silence.startFrame = silence.startTmp;
+                        silence.startPTS   = silence.startTmpPTS;
+                        silence.endFrame   = silence.endTmp;
+                        silence.endPTS     = silence.endTmpPTS;
+                    }
+                }
+            }
+            silence.countTmp    =  0;
+            silence.startTmp    = -1;
+            silence.startTmpPTS = -1;
+            silence.endTmp      = -1;
+            silence.endTmpPTS   = -1;
+        }
+    }
+    if (silence.startFrame <= silence.startTmp) { // later result found
+        silence.count      = silence.countTmp;
+        silence.startFrame = silence.startTmp;
+        silence.startPTS   = silence.startTmpPTS;
+        silence.endFrame   = silence.endTmp;
+        silence.endPTS     = silence.endTmpPTS;
+    }
+    if (silence.count < SILENCE_COUNT) return -1;
+
+    sVideoPTS videoFrame;
+    sVideoPTS audioFrame;
+    if (isStartMark) {
+        audioFrame.frameNumber = silence.endFrame; // for start marks we use end of silence part
+        audioFrame.pts         = silence.endPTS;
+
+        videoFrame.pts = INT64_MAX;
+        for (std::vector<sVideoPTS>::const_iterator frame = videoFrames.begin(); frame != videoFrames.end(); ++frame) {  // search video frame with pts after audio frame
+            if (frame->frameNumber > lastVideoFrame) break;
+            if ((frame->pts > audioFrame.pts) && (frame->pts < videoFrame.pts)) videoFrame = *frame;
+        }
+        if (videoFrame.frameNumber == -1) {
+            dsyslog("cDecoder::FindSilence(): video frame with pts after not in range, set to audio frame");
+            videoFrame.frameNumber = silence.endFrame;
+        }
+    }
+    else {
+        audioFrame.frameNumber = silence.startFrame;  // for stop mark we use start of silence part
+        audioFrame.pts         = silence.startPTS;
+
+        for (std::vector<sVideoPTS>::const_iterator frame = videoFrames.begin(); frame != videoFrames.end(); ++frame) {  // search video frame with pts before audio frame
+            if (frame->frameNumber > lastVideoFrame) break;
+            if ((frame->pts < audioFrame.pts) && (frame->pts > videoFrame.pts)) videoFrame = *frame;
+        }
+        if (videoFrame.frameNumber == -1) {
+            dsyslog("cDecoder::FindSilence(): video frame with pts before not in range, set to audio frame");
+            videoFrame.frameNumber = silence.startFrame;
+        }
+    }
+    int silenceFrame = -1;
+    if (!maContext->Config->fullDecode) {
+        if (isBeforeMark) silenceFrame = recordingIndexDecoder->GetIFrameBefore(videoFrame.frameNumber);
+        else              silenceFrame = recordingIndexDecoder->GetIFrameAfter(videoFrame.frameNumber);
+    }
+    else silenceFrame = videoFrame.frameNumber;
+    dsyslog("cDecoder::FindSilence(): found silence part between audio frame (%d) and (%d)", silence.startFrame, silence.endFrame);
+    dsyslog("cDecoder::FindSilence(): use audio frame (%d) PTS %" PRId64 ", video frame (%d) PTS %" PRId64 ", return frame (%d)", audioFrame.frameNumber, audioFrame.pts, videoFrame.frameNumber, videoFrame.pts, silenceFrame);
+    return silenceFrame;
+}
+
+
+bool cDecoder::LevelFrameLess(const sAudioLevel &level1, const sAudioLevel &level2) {
+    return level1.frameNumber < level2.frameNumber;
+}
+
+
+// get next silence part from level track of first pass or decode audio from startFrame to stopFrame
+// return: frame number of silence part, -1 if no silence part were found
+//
+int cDecoder::GetNextSilence(sMarkAdContext *maContext, const int startFrame, const int stopFrame, const bool isBeforeMark, const bool isStartMark) {
+    std::vector<sAudioLevel> levels;
+    std::vector<sVideoPTS> videoFrames;
+    sVideoPTS videoFrame;
+
+    if (!levelTrack.empty() && (startFrame >= levelTrack.front().frameNumber) && (stopFrame < static_cast<int>(videoPTSTrack.size()))) {
+        dsyslog("cDecoder::GetNextSilence(): use level track from frame (%d) to frame (%d)", startFrame, stopFrame);
+        sAudioLevel searchLevel;
+        searchLevel.frameNumber = startFrame;
+        std::vector<sAudioLevel>::const_iterator audioLevel = std::lower_bound(levelTrack.begin(), levelTrack.end(), searchLevel, LevelFrameLess);
+        for (; (audioLevel != levelTrack.end()) && (audioLevel->frameNumber < stopFrame); ++audioLevel) levels.push_back(*audioLevel);
+        for (int frameNumber = startFrame + 1; frameNumber <= stopFrame; frameNumber++) {
+            if (videoPTSTrack[frameNumber] == -1) continue;
+            videoFrame.frameNumber = frameNumber;
+            videoFrame.pts = videoPTSTrack[frameNumber];
+            videoFrames.push_back(videoFrame);
+        }
+        return FindSilence(maContext, levels, videoFrames, isBeforeMark, isStartMark);
+    }
+
+    // no level track for this range, decode audio
     int streamIndex = GetFirstMP2AudioStream();
     if (streamIndex < 0) {
         dsyslog("cDecoder::GetNextSilence(): could not get stream index of MP2 audio stream");
         return -1;
     }
-    struct sVideoFrame {
-        int frameNumber = -1;
-        int64_t pts = -1;
-    } videoFrame;
-    std::vector<sVideoFrame> videoFrameVector;
+    int streamSelectionBefore = streamSelection;
+    SelectStreams(streamSelection | STREAMS_AUDIO_MP2);
+    if (!SeekToFrame(maContext, startFrame)) {
+        esyslog("could not seek to frame (%i)", startFrame);
+        SelectStreams(streamSelectionBefore);
+        return -1;
+    }
 
     dsyslog("cDecoder::GetNextSilence(): using stream index %i from frame (%d) to frame (%d)", streamIndex, GetFrameNumber(), stopFrame);
     while (GetFrameNumber() < stopFrame) {
@@ -946,139 +1769,27 @@ int cDecoder::GetNextSilence(sMarkAdContext *maContext, const int stopFrame, con
 #endif
             videoFrame.frameNumber = GetFrameNumber();
             videoFrame.pts = avpkt.pts;
-            videoFrameVector.push_back(videoFrame);
-            ALLOC(sizeof(videoFrame), "videoFrameVector");
+            videoFrames.push_back(videoFrame);
             continue;
         }
         if (avpkt.stream_index != streamIndex) continue;
         if (IsAudioPacket()) {
             AVFrame *audioFrame = DecodePacket(&avpkt);
             if (audioFrame) {
-                if (audioFrame->format == AV_SAMPLE_FMT_S16P) {
-                    int level = 0;
-                    for (int channel = 0; channel < audioFrame->channels; channel++) {
-                        int16_t *samples = reinterpret_cast<int16_t*>(audioFrame->data[channel]);
-                        for (int sample = 0; sample < audioFrame->nb_samples; sample++) {
-                            level += abs(samples[sample]);
-                        }
-                    }
-                    int normLevel =  level / audioFrame->nb_samples / audioFrame->channels;
-#ifdef DEBUG_SILENCE
-                    dsyslog("cDecoder::GetNextSilence(): frame (%5d) level %d", GetFrameNumber(), normLevel);
-#endif
-                    if (normLevel <= SILENCE_LEVEL) {
-                        silence.countTmp++;
-                        if (normLevel <= 7) silence.countTmp++;
-                        int frameNumber = GetFrameNumber();
-                        if (silence.startTmp == -1) {
-                            silence.startTmp = frameNumber;
-                            silence.startTmpPTS = avpkt.pts;
-                        }
-                        silence.endTmp = frameNumber;
-                        silence.endTmpPTS = avpkt.pts;
-                        dsyslog("cDecoder::GetNextSilence(): stream %d frame (%5d) level %2d silenceCount %2d, pts %" PRId64, avpkt.stream_index, frameNumber, normLevel, silence.countTmp, silence.endTmpPTS);
-
-                    }
-                    else {
-                        if (silence.countTmp >= SILENCE_COUNT) { // min count reached, this part is valid
-                            if (silence.startTmp >= 0) {  // end of silence part reached
-                                if (!isBeforeMark) break;  // we are called after the mark, take first valid silence part
-                                if (silence.startFrame <= silence.startTmp) { // later result found
-                                    silence.count      = silence.countTmp;
-                                    silence.startFrame = silence.startTmp;
-                                    silence.startPTS   = silence.startTmpPTS;
-                                    silence.endFrame   = silence.endTmp;
-                                    silence.endPTS     = silence.endTmpPTS;
-                                }
-                            }
-                        }
-                        silence.countTmp    =  0;
-                        silence.startTmp    = -1;
-                        silence.startTmpPTS = -1;
-                        silence.endTmp      = -1;
-                        silence.endTmpPTS   = -1;
-                    }
-                }
-                else {
+                if (audioFrame->format != AV_SAMPLE_FMT_S16P) {
                     dsyslog("cDecoder::GetNextSilence(): stream %i frame %i sample format not supported %s", avpkt.stream_index, GetFrameNumber(), av_get_sample_fmt_name((enum AVSampleFormat) audioFrame->format));
+                    SelectStreams(streamSelectionBefore);
                     return -1;
                 }
+                sAudioLevel audioLevel;
+                audioLevel.level = GetAudioLevel(audioFrame);
+                if (audioLevel.level < 0) continue;
+                audioLevel.frameNumber = GetFrameNumber();
+                audioLevel.pts = avpkt.pts;
+                levels.push_back(audioLevel);
             }
         }
-
-    }
-    if (silence.startFrame <= silence.startTmp) { // later result found
-        silence.count      = silence.countTmp;
-        silence.startFrame = silence.startTmp;
-        silence.startPTS   = silence.startTmpPTS;
-        silence.endFrame   = silence.endTmp;
-        silence.endPTS     = silence.endTmpPTS;
-    }
-    videoFrame.frameNumber = -1;
-    videoFrame.pts = -1;
-    int silenceFrame = -1;
-
-    if (silence.count >= SILENCE_COUNT) {
-        struct sAudioFrame {
-            int frameNumber = -1;
-            int64_t pts = -1;
-        } audioFrame;
-        if (isStartMark) {
-            audioFrame.frameNumber = silence.endFrame; // for start marks we use end of silence part
-            audioFrame.pts         = silence.endPTS;
-
-            videoFrame.pts = INT64_MAX;
-            while (!videoFrameVector.empty()) {  // search video frame with pts after audio frame
-                if ((videoFrameVector.back().pts > audioFrame.pts) && (videoFrameVector.back().pts < videoFrame.pts)) {
-                    videoFrame.frameNumber =  videoFrameVector.back().frameNumber;
-                    videoFrame.pts =  videoFrameVector.back().pts;
-                }
-                videoFrameVector.pop_back();
-                FREE(sizeof(videoFrame), "videoFrameVector");
-            }
-            if (videoFrame.frameNumber == -1) {
-                dsyslog("cDecoder::GetNextSilence(): video frame with pts after not in range, set to audio frame");
-                videoFrame.frameNumber = silence.endFrame;
-            }
-        }
-        else {
-            audioFrame.frameNumber = silence.startFrame;  // for stop mark we use start of silence part
-            audioFrame.pts         = silence.startPTS;
-
-            while (!videoFrameVector.empty()) {  // search video frame with pts before audio frame
-                if ((videoFrameVector.back().pts < audioFrame.pts) && (videoFrameVector.back().pts > videoFrame.pts)) {
-                    videoFrame.frameNumber =  videoFrameVector.back().frameNumber;
-                    videoFrame.pts =  videoFrameVector.back().pts;
-                }
-                videoFrameVector.pop_back();
-                FREE(sizeof(videoFrame), "videoFrameVector");
-            }
-            if (videoFrame.frameNumber == -1) {
-                dsyslog("cDecoder::GetNextSilence(): video frame with pts before not in range, set to audio frame");
-                videoFrame.frameNumber = silence.startFrame;
-            }
-
-
-
-
-
-        }
-        if (!maContext->Config->fullDecode) {
-            if (isBeforeMark) silenceFrame = recordingIndexDecoder->GetIFrameBefore(videoFrame.frameNumber);
-            else              silenceFrame = recordingIndexDecoder->GetIFrameAfter(videoFrame.frameNumber);
-        }
-        else silenceFrame = videoFrame.frameNumber;
-        dsyslog("cDecoder::GetNextSilence(): found silence part in stream %d between audio frame (%d) and (%d)", streamIndex, silence.startFrame, silence.endFrame);
-        dsyslog("cDecoder::GetNextSilence(): use audio frame (%d) PTS %" PRId64 ", video frame (%d) PTS %" PRId64 ", return frame (%d)", audioFrame.frameNumber, audioFrame.pts, videoFrame.frameNumber, videoFrame.pts, silenceFrame);
     }
-    else {
-#ifdef DEBUG_MEM
-        int size = videoFrameVector.size();
-        for (int i = 0 ; i < size; i++) {
-            FREE(sizeof(videoFrame), "videoFrameVector");
-        }
-#endif
-        videoFrameVector.clear();
-    }
-    return silenceFrame;
+    SelectStreams(streamSelectionBefore);
+    return FindSilence(maContext, levels, videoFrames, isBeforeMark, isStartMark);
 }
@@ -9,6 +9,7 @@
 #define __decoder_new_h_
 
 #include <vector>
+#include <pthread.h>
 #include "global.h"
 #include "index.h"
 
@@ -26,6 +27,18 @@ extern "C"{
 
 #define AVLOGLEVEL AV_LOG_ERROR
 
+#define SPARSE_CHECK_IFRAMES 10  //!< i-frames read by the demuxer which have to match the VDR index before sparse read starts
+                                 //!<
+
+#define STREAMS_VIDEO      0x00  //!< only video stream, video is always read because frame numbers are counted from video packets
+                                 //!<
+#define STREAMS_AUDIO_AC3  0x01  //!< AC3 audio streams, used for audio channel detection
+                                 //!<
+#define STREAMS_AUDIO_MP2  0x02  //!< first MP2 audio stream, used for silence detection
+                                 //!<
+#define STREAMS_AUDIO_ALL  0x04  //!< all audio streams, used for cut
+                                 //!<
+
 #if LIBAVCODEC_VERSION_INT >= ((58<<16)+(35<<8)+100)   // error codes from AC3 parser
     #define AAC_AC3_PARSE_ERROR_SYNC         -0x1030c0a
     #define AAC_AC3_PARSE_ERROR_BSID         -0x2030c0a
@@ -72,15 +85,24 @@ class cDecoder {
         int GetErrorCount();
 
 /**
- * set decoder to first/next file of the directory
+ * open all ts files of the directory as one continuous input, or continue after end of input if VDR has started a new ts file <br>
+ * after Reset() the input is set back to the start of the first file
  * @param recDir name of the recording directory
- * @return true if first/next ts file found, false otherweise
+ * @return true if input can be read, false at end of recording
  */
         bool DecodeDir(const char *recDir);
 
 /**
- * setup decoder codec context for current file
- * @param filename file name
+ * open all ts files of the directory as one continuous input if it is not yet open, keep the read position otherwise <br>
+ * used by the later passes, they position the decoder with SeekToFrame() and the byte positions of the recording index
+ * @param recDir name of the recording directory
+ * @return true if input is open, false otherwise
+ */
+        bool OpenDir(const char *recDir);
+
+/**
+ * open concatenated input of all ts files, probe stream infos and setup decoder codec context once for the whole recording
+ * @param filename file name of the first ts file
  * @return true if setup was succesful, false otherwiese
  */
         bool DecodeFile(const char * filename);
@@ -126,13 +148,13 @@ class cDecoder {
         int GetVideoWidth();
 
 /**
- * get average video frame rate taken from avctx->streams[i]->avg_frame_rate
+ * get average video frame rate taken from avg_frame_rate of video stream after probe
  * @return average video frame rate (avg_frame_rate)
  */
         int GetVideoAvgFrameRate();
 
 /**
- * get real video frame rate taken from avctx->streams[i]->r_frame_rate
+ * get real video frame rate taken from r_frame_rate of video stream after probe
  * @return real video frame rate (r_frame_rate)
  */
         int GetVideoRealFrameRate();
@@ -155,14 +177,43 @@ class cDecoder {
 
 /// seek decoder read position
 /**
- * only seek forward <br>
- * seek to i-frame before and start decode to fill decoder buffer
+ * seek forward or backward <br>
+ * jump to i-frame before with byte position from recording index and start decode to fill decoder buffer <br>
+ * if i-frame position is not yet in the index, read forward from current position
  * @param maContext   markad context
  * @param frameNumber frame number to seek
  * @return true if successful, false otherwise
  */
         bool SeekToFrame(sMarkAdContext *maContext, int frameNumber);
 
+/**
+ * read and decode packets in a separate thread, used for sequential read of the recording <br>
+ * packet read, frame numbers and recording index are processed in the calling thread as without pipeline
+ * @param full true if we do full decoding of all video frames, false if we decode only i-frames
+ */
+        void EnablePipeline(const bool full);
+
+/**
+ * stop pipeline thread and read packets in calling thread <br>
+ * if pipeline had already read packets, decoder is reset to start of first file
+ */
+        void DisablePipeline();
+
+/**
+ * read only i-frames and the audio packets after them, skip all other video frames <br>
+ * byte positions of the i-frames are taken from the VDR index file <br>
+ * sparse read starts after #SPARSE_CHECK_IFRAMES i-frames read by the demuxer matched the VDR index,
+ * it stops if the VDR index does not match the ts files
+ * @param recDir recording directory with the VDR index file, NULL to stop sparse read
+ */
+        void EnableSparseRead(const char *recDir);
+
+/**
+ * limit read bandwidth of all decoders of this process, markad should not slow down running recordings
+ * @param mbPerSecond maximum read rate in MB/s, 0 for no limit
+ */
+        static void SetReadLimit(const int mbPerSecond);
+
 /**
  * decode audio or packet
  * @param avpkt packet to decode
@@ -247,14 +298,43 @@ class cDecoder {
         int GetIFrameRangeCount(int beginFrame, int endFrame);
 
 /**
- * get next silent audio part from current frame position to stopFrame
+ * record audio level of the first MP2 audio stream and PTS of each video frame while reading packets <br>
+ * used in the first pass, so the silence detection of the later passes needs no decoding
+ * @param enable true to start recording, false to stop recording
+ */
+        void EnableLevelTrack(const bool enable);
+
+/**
+ * select streams read by the demuxer, packets of all other streams are discarded by the demuxer <br>
+ * streams without video or audio (teletext, subtitles, data) are always discarded <br>
+ * selection is kept for all ts files and after Reset(), default is #STREAMS_AUDIO_ALL
+ * @param streams #STREAMS_VIDEO or a combination of #STREAMS_AUDIO_AC3, #STREAMS_AUDIO_MP2 and #STREAMS_AUDIO_ALL
+ */
+        void SelectStreams(const int streams);
+
+/**
+ * set analysis decode profile of the video decoder <br>
+ * the detectors need only luma statistics and edges, so the decoder can skip work that gives a better picture: <br>
+ * H.264/H.265: skip deblocking filter (and SAO for H.265) <br>
+ * H.262: skip IDCT of non key frames <br>
+ * all codecs with full decode: skip non reference frames <br>
+ * do not use it if decoded frames are encoded
+ * @param enable     true to use analysis decode profile, false for full picture quality
+ * @param fullDecode true if all video frames are decoded, false if only i-frames are decoded
+ */
+        void SetAnalysisDecode(const bool enable, const bool fullDecode);
+
+/**
+ * get next silent audio part from startFrame to stopFrame <br>
+ * use level track of the first pass if it contains this range, otherwise seek to startFrame and decode audio
  * @param maContext    markad context
+ * @param startFrame   start search at this frame
  * @param stopFrame    stop search at this frame
  * @param isBeforeMark true if search is from current frame to mark position, false if search is from mark position to stopFrame
  * @param isStartMark  true if we check for a start mark, false if we check for a stop mark
  * @return frame number of silence part, -1 if no silence part was found
  */
-        int GetNextSilence(sMarkAdContext *maContext, const int stopFrame, const bool isBeforeMark, const bool isStartMark);
+        int GetNextSilence(sMarkAdContext *maContext, const int startFrame, const int stopFrame, const bool isBeforeMark, const bool isStartMark);
 
     private:
 /**
@@ -263,6 +343,283 @@ class cDecoder {
  */
         int GetFirstMP2AudioStream();
 
+/**
+ * audio level of a decoded audio frame
+ */
+        struct sAudioLevel {
+            int64_t pts = -1;          //!< presentation timestamp of the audio packet
+                                       //!<
+            int frameNumber = -1;      //!< video frame number at read time of the audio packet
+                                       //!<
+            int level = 0;             //!< average absolute sample value of all channels
+                                       //!<
+        };
+
+/**
+ * video frame number and presentation timestamp
+ */
+        struct sVideoPTS {
+            int frameNumber = -1;      //!< video frame number
+                                       //!<
+            int64_t pts = -1;          //!< presentation timestamp of the video packet
+                                       //!<
+        };
+
+/**
+ * get audio level of a decoded audio frame
+ * @param audioFrame decoded audio frame
+ * @return average absolute sample value of all channels, -1 if sample format is not supported or frame has no samples
+ */
+        static int GetAudioLevel(const AVFrame *audioFrame);
+
+/**
+ * compare audio levels by frame number, used to search in level track
+ * @param level1 first audio level
+ * @param level2 second audio level
+ * @return true if frame number of level1 is less than frame number of level2
+ */
+        static bool LevelFrameLess(const sAudioLevel &level1, const sAudioLevel &level2);
+
+/**
+ * add current packet to level track, decode packet if it is from the first MP2 audio stream
+ */
+        void AddLevelTrack();
+
+/**
+ * find silence part in audio levels and the video frame next to it
+ * @param maContext    markad context
+ * @param levels       audio levels of search range
+ * @param videoFrames  video frames of search range
+ * @param isBeforeMark true if search is from current frame to mark position, false if search is from mark position to stopFrame
+ * @param isStartMark  true if we check for a start mark, false if we check for a stop mark
+ * @return frame number of silence part, -1 if no silence part was found
+ */
+        int FindSilence(sMarkAdContext *maContext, const std::vector<sAudioLevel> &levels, const std::vector<sVideoPTS> &videoFrames, const bool isBeforeMark, const bool isStartMark);
+
+/**
+ * get offset of current packet from start of current ts file
+ * @return offset in ms, -1 if packet has no presentation timestamp
+ */
+        int64_t GetPacketTimeOffset_ms();
+
+/**
+ * seek read position direct to an i-frame with byte position from recording index, forward and backward <br>
+ * if seek failed after read position was changed, decoder is reset to start of first file
+ * @param iFrameNumber frame number of i-frame
+ * @return true if current packet is the i-frame, false otherwise
+ */
+        bool SeekToIFrame(const int iFrameNumber);
+
+/**
+ * stream infos of a packet, stored at read time
+ */
+        struct sPacketInfo {
+            AVMediaType codecType = AVMEDIA_TYPE_UNKNOWN; //!< media type of packet stream
+                                                          //!<
+            bool isAC3 = false;                           //!< true if packet stream is AC3, false otherwise
+                                                          //!<
+            int channels = 0;                             //!< audio channels of packet stream
+                                                          //!<
+            AVRational timeBase = {0, 1};                 //!< time base of packet stream
+                                                          //!<
+            int64_t startTime = 0;                        //!< start time of packet stream
+                                                          //!<
+            int skippedFrames = 0;                        //!< video frames skipped by sparse read before this packet
+                                                          //!<
+            int fileNumber = 0;                           //!< number of ts file of packet, packet position is relative to start of this file
+                                                          //!<
+        };
+
+/**
+ * stream infos taken after probe, before a pipeline thread starts <br>
+ * the demuxer can add or reallocate streams of avctx while it reads packets, so only the reading thread may access them
+ */
+        struct sStreamInfo {
+            AVMediaType codecType = AVMEDIA_TYPE_UNKNOWN; //!< media type of stream
+                                                          //!<
+            AVCodecID codecId = AV_CODEC_ID_NONE;         //!< codec id of stream
+                                                          //!<
+            bool isAC3 = false;                           //!< true if stream is AC3, false otherwise
+                                                          //!<
+            int channels = 0;                             //!< audio channels of stream
+                                                          //!<
+            int width = 0;                                //!< video width in pixel
+                                                          //!<
+            int height = 0;                               //!< video height in pixel
+                                                          //!<
+            int avgFrameRate = 0;                         //!< average video frame rate (avg_frame_rate)
+                                                          //!<
+            int realFrameRate = 0;                        //!< real video frame rate (r_frame_rate)
+                                                          //!<
+            AVRational timeBase = {0, 1};                 //!< time base of stream
+                                                          //!<
+            int64_t startTime = 0;                        //!< start time of stream
+                                                          //!<
+        };
+
+/**
+ * store stream infos of all streams with codec context
+ */
+        void StoreStreamInfo();
+
+/**
+ * element of pipeline ring buffer
+ */
+        struct sPipelineElement {
+            AVPacket avpkt = {};               //!< read packet
+                                               //!<
+            AVFrame *avFrame = NULL;           //!< decoded frame, NULL if not decoded or decoding failed
+                                               //!<
+            bool decoded = false;              //!< true if packet was sent to decoder, false otherwise
+                                               //!<
+            bool eof = false;                  //!< true if end of file reached, element has no packet
+                                               //!<
+            sPacketInfo info;                  //!< stream infos of packet
+                                               //!<
+        };
+
+/**
+ * get stream infos of a packet
+ * @param[in]  packet packet
+ * @param[out] info   stream infos of packet
+ */
+        void GetPacketInfo(const AVPacket *packet, sPacketInfo *info);
+
+/**
+ * read callback of concatenated input, continue with next ts file at end of current ts file
+ * @param decoder pointer to decoder class
+ * @param buffer  read buffer
+ * @param size    size of read buffer
+ * @return number of bytes read, AVERROR_EOF at end of last ts file
+ */
+        static int InputRead(void *decoder, uint8_t *buffer, int size);
+
+/**
+ * seek callback of concatenated input
+ * @param decoder pointer to decoder class
+ * @param offset  position in concatenated input
+ * @param whence  SEEK_SET, SEEK_CUR or AVSEEK_SIZE
+ * @return new position, negativ on error
+ */
+        static int64_t InputSeek(void *decoder, int64_t offset, int whence);
+
+/**
+ * open a ts file of the recording as current file of concatenated input
+ * @param number number of ts file
+ * @return true if successful, false otherwise
+ */
+        bool InputOpenFile(const int number);
+
+/**
+ * get start position of a ts file in concatenated input, sizes of all previous ts files are used
+ * @param number number of ts file
+ * @return start position, -1 if ts file or a previous ts file does not exist
+ */
+        int64_t InputGetFileStart(const int number);
+
+/**
+ * set discard flag of all streams from stream selection, do nothing while pipeline thread is reading
+ */
+        void ApplyStreamSelection();
+
+/**
+ * set skip flags of the video codec context from analysis decode profile, do nothing while pipeline thread is decoding
+ */
+        void ApplyDecodeProfile();
+
+/**
+ * free codec context of all streams
+ */
+        void FreeCodecContext();
+
+/**
+ * page cache control of current ts file of concatenated input <br>
+ * request kernel read-ahead of #INPUT_READAHEAD_SIZE bytes after read position and
+ * drop data more than #INPUT_DROPBEHIND_SIZE bytes before read position from page cache
+ */
+        void InputAdvise();
+
+/**
+ * wait until read bandwidth limit allows to read more data
+ * @param bytes number of bytes read
+ */
+        static void InputLimit(const int bytes);
+
+/**
+ * read next packet from concatenated input, convert position to number of ts file and position in this file <br>
+ * in sparse read mode skip video frames from a non i-frame to next i-frame of VDR index
+ * @param[out]    packet      read packet
+ * @param[out]    info        stream infos of read packet
+ * @param[in,out] frameNumber frame number of last read video packet
+ * @param[in]     eagain      true if decoder needs more packets, sparse read does not skip frames in this case
+ * @return true if successful, false on end of file
+ */
+        bool ReadPacket(AVPacket *packet, sPacketInfo *info, int *frameNumber, const bool eagain);
+
+/**
+ * compare an i-frame read by the demuxer with the VDR index, start sparse read after #SPARSE_CHECK_IFRAMES matching i-frames
+ * @param frameNumber frame number of the i-frame
+ * @param iFileNumber number of the ts file of the i-frame
+ * @param pos         byte position of the i-frame packet in the ts file
+ */
+        void SparseCheckIFrame(const int frameNumber, const int iFileNumber, const int64_t pos);
+
+/**
+ * stop sparse read and free VDR index
+ */
+        void SparseStop();
+
+/**
+ * decode a packet to a frame from frame pool, decoder state of current packet is not changed
+ * @param[in]  avpkt       packet to decode
+ * @param[in]  frameNumber frame number of packet, used for log messages
+ * @param[out] eagain      set to true if decoder needs more packets
+ * @return decoded frame, NULL on error or if decoder needs more packets
+ */
+        AVFrame *DecodePacketFrame(AVPacket *avpkt, const int frameNumber, bool *eagain);
+
+/**
+ * check current decoded frame for decoding errors, frame with errors is freed
+ * @param streamIndex stream index of frame
+ */
+        void CheckDecodeError(const int streamIndex);
+
+/**
+ * start pipeline thread
+ * @return true if thread is started, false otherwise
+ */
+        bool PipelineStartThread();
+
+/**
+ * stop pipeline thread and free unprocessed packets
+ * @return true if unprocessed packets were dropped, false otherwise
+ */
+        bool PipelineStopThread();
+
+/**
+ * pipeline thread, read and decode packets of current file
+ * @param decoder pointer to decoder class
+ */
+        static void *PipelineRead(void *decoder);
+
+/**
+ * get next packet from pipeline, start pipeline thread if not running
+ * @return true if we got a packet, false on end of file
+ */
+        bool PipelineGetPacket();
+
+/**
+ * get an empty frame from frame pool, allocate a new frame if pool is empty
+ * @return empty frame, NULL if allocation failed
+ */
+        AVFrame *FramePoolGet();
+
+/**
+ * unref frame buffers and give frame back to frame pool, frame is freed if pool is full
+ * @param[in,out] frame frame to release, set to NULL
+ */
+        void FramePoolPut(AVFrame **frame);
+
         cIndex *recordingIndexDecoder = NULL;  //!< recording index
                                                //!<
         char *recordingDir = NULL;             //!< name of recording directory
@@ -286,6 +643,32 @@ class cDecoder {
 #endif
         AVCodecContext **codecCtxArray = NULL; //!< codec context per stream
                                                //!<
+        unsigned int codecCtxCount = 0;        //!< number of streams with codec context, packets of streams added later are ignored
+                                               //!<
+        std::vector<sStreamInfo> streamInfo;   //!< stream infos per stream with codec context, taken after probe
+                                               //!<
+        AVIOContext *inputContext = NULL;      //!< concatenated input of all ts files of the recording
+                                               //!<
+        int inputFd = -1;                      //!< file descriptor of current ts file of concatenated input
+                                               //!<
+        int inputFileNumber = 0;               //!< number of current ts file of concatenated input
+                                               //!<
+        int64_t inputPos = 0;                  //!< read position in concatenated input
+                                               //!<
+        std::vector<int64_t> inputFileStart;   //!< start position of each ts file in concatenated input, index is file number - 1
+                                               //!<
+        bool inputNewStreamLogged = false;     //!< true if packets of a stream added after probe are already logged
+                                               //!<
+        int64_t inputReadAheadPos = 0;         //!< position in current ts file up to which kernel read-ahead is requested
+                                               //!<
+        int64_t inputDropPos = 0;              //!< position in current ts file up to which data are dropped from page cache
+                                               //!<
+        static int64_t readLimit;              //!< maximum read rate of all decoders in bytes/s, 0 for no limit
+                                               //!<
+        static int64_t readLimitNext;          //!< time in us when next read is allowed by read limit
+                                               //!<
+        static pthread_mutex_t readLimitMutex; //!< mutex for read limit, decoders can read from different threads
+                                               //!<
         int currFrameNumber = -1;              //!< current decoded frame number
                                                //!<
         int iFrameCount = 0;                   //!< count of decoed i-frames
@@ -313,13 +696,75 @@ class cDecoder {
                                                //!<
         bool stateEAGAIN = false;              //!< true if decoder needs more frames, false otherwise
                                                //!<
-        int videoRealFrameRate = 0;            //!< video stream real frame rate
-                                               //!<
         int64_t dtsBefore = -1;                //!< DTS of frame before
                                                //!<
         int decodeErrorCount = 0;              //!< number of decoding errors
                                                //!<
         int decodeErrorFrame = -1;             //!< frame number of last decoding error
                                                //!<
+        sPacketInfo packetInfo;                //!< stream infos of current packet
+                                               //!<
+        bool pipelineEnabled = false;          //!< true if packets are read and decoded by pipeline thread
+                                               //!<
+        bool pipelineFullDecode = false;       //!< true if pipeline thread decodes all video frames, false if only i-frames
+                                               //!<
+        bool pipelineEAGAIN = false;           //!< decoder state EAGAIN of pipeline thread at end of last file
+                                               //!<
+        bool pipelineThreadRunning = false;    //!< true if pipeline thread is running
+                                               //!<
+        bool pipelineStop = false;             //!< true if pipeline thread should stop
+                                               //!<
+        bool pipelineDropped = false;          //!< true if pipeline thread stopped with unprocessed packet
+                                               //!<
+        bool pipelineDecoded = false;          //!< true if current packet was sent to decoder by pipeline thread
+                                               //!<
+        pthread_t pipelineThread;              //!< pipeline thread
+                                               //!<
+        pthread_mutex_t pipelineMutex = PTHREAD_MUTEX_INITIALIZER;  //!< mutex for pipeline ring buffer
+                                                                    //!<
+        pthread_cond_t pipelineCondRead = PTHREAD_COND_INITIALIZER;  //!< signal new element in pipeline ring buffer
+                                                                     //!<
+        pthread_cond_t pipelineCondWrite = PTHREAD_COND_INITIALIZER; //!< signal free space in pipeline ring buffer
+                                                                     //!<
+        std::vector<sPipelineElement> pipelineRing; //!< pipeline ring buffer
+                                                    //!<
+        int pipelineHead = 0;                  //!< index of first element in pipeline ring buffer
+                                               //!<
+        int pipelineCount = 0;                 //!< number of elements in pipeline ring buffer
+                                               //!<
+        int pipelineVideoCount = 0;            //!< number of video packets in pipeline ring buffer
+                                               //!<
+        int pipelineDecodedCount = 0;          //!< number of decoded frames in pipeline ring buffer
+                                               //!<
+        int pipelineReadFrameNumber = -1;      //!< frame number of last packet before pipeline thread start
+                                               //!<
+        AVFrame *pipelineFrame = NULL;         //!< decoded frame of current packet from pipeline thread
+                                               //!<
+        cVDRIndex *vdrIndex = NULL;            //!< VDR index for sparse read, NULL if sparse read is not enabled
+                                               //!<
+        int sparseCheckCount = 0;              //!< count of i-frames matching the VDR index
+                                               //!<
+        bool sparseActive = false;             //!< true if sparse read skips video frames
+                                               //!<
+        bool sparseJumped = false;             //!< true if sparse read jumped to an i-frame and next video packet has to be this i-frame
+                                               //!<
+        int sparseSkippedFrames = 0;           //!< count of video frames skipped by sparse read
+                                               //!<
+        int streamSelection = STREAMS_AUDIO_ALL;  //!< streams read by the demuxer, see SelectStreams()
+                                                  //!<
+        bool analysisDecode = false;           //!< true if analysis decode profile is used, see SetAnalysisDecode()
+                                               //!<
+        bool analysisFullDecode = false;       //!< true if analysis decode profile is used with full decode
+                                               //!<
+        bool levelTrackEnabled = false;        //!< true if level track is recorded while reading packets
+                                               //!<
+        std::vector<sAudioLevel> levelTrack;   //!< audio levels of first MP2 audio stream from first pass
+                                               //!<
+        std::vector<int64_t> videoPTSTrack;    //!< PTS of each video frame from first pass, index is frame number, -1 if not read
+                                               //!<
+        std::vector<AVFrame *> framePool;      //!< empty frames for reuse, decoder allocates frame buffers from its own buffer pool
+                                               //!<
+        pthread_mutex_t framePoolMutex = PTHREAD_MUTEX_INITIALIZER;  //!< mutex for frame pool, frames are released by pipeline thread too
+                                                                     //!<
 };
 #endif
@@ -7,6 +7,7 @@
 
 #include "decoder_new.h"
 #include "encoder_new.h"
+#include "perf.h"
 
 
 cAC3VolumeFilter::cAC3VolumeFilter() {
@@ -149,8 +150,9 @@ bool cAC3VolumeFilter::GetFrame(AVFrame *avFrame) {
 
 
 
-cEncoder::cEncoder(sMarkAdContext *macontext) {
+cEncoder::cEncoder(sMarkAdContext *macontext, const int segmentParam) {
     maContext = macontext;
+    segment = segmentParam;
     threadCount = maContext->Config->threads;
     if (threadCount < 1) threadCount = 1;
     if (threadCount > 16) threadCount = 16;
@@ -229,44 +231,53 @@ bool cEncoder::OpenFile(const char *directory, cDecoder *ptr_cDecoder) {
     ALLOC(sizeof(int) * avctxIn->nb_streams, "streamMap");
     memset(streamMap, -1, sizeof(int) * avctxIn->nb_streams);
 
-    if (asprintf(&buffCutName,"%s", directory)==-1) {
-        dsyslog("cEncoder::OpenFile(): failed to allocate string, out of memory?");
-        return false;
+    if (segment >= 0) {  // segment of parallel encoding, concatenated to the cut file later
+        if (asprintf(&filename, "%s/" CUT_SEGMENT_FILE, directory, segment) == -1) {
+            dsyslog("cEncoder::OpenFile(): failed to allocate string, out of memory?");
+            return false;
+        }
+        ALLOC(strlen(filename)+1, "filename");
     }
+    else {
+        if (asprintf(&buffCutName,"%s", directory)==-1) {
+            dsyslog("cEncoder::OpenFile(): failed to allocate string, out of memory?");
+            return false;
+        }
 #ifdef DEBUG_MEM
-    ALLOC(strlen(buffCutName)+1, "buffCutName");
-    int memsize_buffCutName = strlen(buffCutName)+1;
+        ALLOC(strlen(buffCutName)+1, "buffCutName");
+        int memsize_buffCutName = strlen(buffCutName)+1;
 #endif
 
-    char *datePart = strrchr(buffCutName, '/');
-    if (!datePart) {
-        dsyslog("cEncoder::OpenFile(): faild to find last '/'");
-        FREE(strlen(buffCutName)+1, "buffCutName");
-        free(buffCutName);
-        return false;
-    }
-    *datePart = 0;    // cut off date part
+        char *datePart = strrchr(buffCutName, '/');
+        if (!datePart) {
+            dsyslog("cEncoder::OpenFile(): faild to find last '/'");
+            FREE(strlen(buffCutName)+1, "buffCutName");
+            free(buffCutName);
+            return false;
+        }
+        *datePart = 0;    // cut off date part
 
-    char *cutName = strrchr(buffCutName, '/');
-    if (!cutName) {
-        dsyslog("cEncoder::OpenFile(): faild to find last '/'");
-        FREE(strlen(buffCutName)+1, "buffCutName");
-        free(buffCutName);
-        return false;
-    }
-    cutName++;   // ignore first char = /
-    dsyslog("cEncoder::OpenFile(): cutName '%s'",cutName);
+        char *cutName = strrchr(buffCutName, '/');
+        if (!cutName) {
+            dsyslog("cEncoder::OpenFile(): faild to find last '/'");
+            FREE(strlen(buffCutName)+1, "buffCutName");
+            free(buffCutName);
+            return false;
+        }
+        cutName++;   // ignore first char = /
+        dsyslog("cEncoder::OpenFile(): cutName '%s'",cutName);
 
-    if (asprintf(&filename,"%s/%s.ts", directory, cutName)==-1) {
-        dsyslog("cEncoder::OpenFile(): failed to allocate string, out of memory?");
-        return false;
-    }
-    ALLOC(strlen(filename)+1, "filename");
+        if (asprintf(&filename,"%s/%s.ts", directory, cutName)==-1) {
+            dsyslog("cEncoder::OpenFile(): failed to allocate string, out of memory?");
+            return false;
+        }
+        ALLOC(strlen(filename)+1, "filename");
 #ifdef DEBUG_MEM
-    FREE(memsize_buffCutName, "buffCutName");
+        FREE(memsize_buffCutName, "buffCutName");
 #endif
-    free(buffCutName);
-    datePart = NULL;
+        free(buffCutName);
+        datePart = NULL;
+    }
     dsyslog("cEncoder::OpenFile(): write to '%s'", filename);
 
 #if LIBAVCODEC_VERSION_INT >= ((56<<16)+(26<<8)+100)
@@ -600,7 +611,10 @@ bool cEncoder::InitEncoderCodec(cDecoder *ptr_cDecoder, const char *directory, c
             av_opt_set(codecCtxArrayOut[streamIndexOut]->priv_data, "x264opts", "force-cfr", 0);  // constand frame rate
             // set pass stats file
             char *passlogfile;
-            if (asprintf(&passlogfile,"%s/encoder", directory) == -1) {
+            int passlogRet = 0;
+            if (segment >= 0) passlogRet = asprintf(&passlogfile, "%s/" CUT_SEGMENT_PASSLOG, directory, segment);  // each segment has its own statistic
+            else passlogRet = asprintf(&passlogfile,"%s/encoder", directory);
+            if (passlogRet == -1) {
                 dsyslog("cEncoder::InitEncoderCodec(): failed to allocate string, out of memory?");
                  return false;
             }
@@ -1066,6 +1080,7 @@ bool cEncoder::WritePacket(AVPacket *avpktIn, cDecoder *ptr_cDecoder) {
 
 
 bool cEncoder::EncodeFrame(cDecoder *ptr_cDecoder, AVCodecContext *avCodecCtx, AVFrame *avFrame, AVPacket *avpkt) {
+    cPerfTimer perfTimer(PERF_ENCODE);
     if (!ptr_cDecoder) return false;
     if (!avCodecCtx) {
         dsyslog("cEncoder::EncodeFrame(): codec context not set");
@@ -21,6 +21,9 @@ extern "C" {
 
 #define VOLUME 3dB
 
+#define CUT_SEGMENT_FILE "markad.cut.%03d.ts"  /* temporary output file of a segment encoded in parallel */
+#define CUT_SEGMENT_PASSLOG "encoder.%03d"      /* 2 pass statistic file of a segment encoded in parallel */
+
 /**
  * libav volume filter class
  */
@@ -69,9 +72,10 @@ class cEncoder {
 
 /**
  * contructor
- * @param macontext markad context
+ * @param macontext    markad context
+ * @param segmentParam number of the segment for parallel encoding, writes to #CUT_SEGMENT_FILE instead of the cut file, -1 for the whole cut
  */
-        explicit cEncoder(sMarkAdContext *macontext);
+        explicit cEncoder(sMarkAdContext *macontext, const int segmentParam = -1);
 
         ~cEncoder();
 
@@ -208,6 +212,8 @@ class cEncoder {
                                                      //!<
         int pass = 0;                                //!< encoding pass
                                                      //!<
+        int segment = -1;                            //!< number of the segment for parallel encoding, -1 for the whole cut
+                                                     //!<
 /**
  * structure for statistic data for 2 pass encoding
  */
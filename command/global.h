@@ -187,10 +187,39 @@ typedef struct sMarkAdConfig {
                                //!< <b>false:</b> copy frames without re-encode, cut on iframe position
                                //!<
 
+    int cutJobs = 1;           //!< number of segments encoded in parallel with --fullencode
+                               //!<
+
     bool bestEncode = true;  //!< <b>true:</b> encode all video and audio streams <br>
                              //!< <b>false:</b> encode all video and audio streams
                              //!<
 
+    bool useCache = false;  //!< <b>true:</b> store analysis results in markad.cache and use them in later runs <br>
+                            //!< <b>false:</b> do not use analysis cache
+                            //!<
+
+    bool fastOverlap = false;  //!< <b>true:</b> overlap detection uses histograms from every second line and column <br>
+                               //!< <b>false:</b> overlap detection uses histograms from all pixel
+                               //!<
+
+    bool sparseRead = false;   //!< <b>true:</b> first pass reads only i-frames with byte positions from the VDR index <br>
+                               //!< <b>false:</b> first pass reads all packets
+                               //!<
+
+    bool analysisDecode = false;  //!< <b>true:</b> video decoder skips deblocking, IDCT of non key frames or non reference frames, depends on codec <br>
+                                  //!< <b>false:</b> video decoder decodes full picture quality
+                                  //!<
+
+    int readLimit = 0;         //!< maximum read rate from the ts files in MB/s, 0 for no limit
+                               //!<
+
+    bool perfReport = false;   //!< <b>true:</b> measure time of all processing stages and write timing report <br>
+                               //!< <b>false:</b> no time measurement of processing stages
+                               //!<
+
+    char perfReportFile[1024] = "";  //!< file name of the timing report, empty for markad.perf.json in the recording directory
+                                     //!<
+
 } sMarkAdConfig;
 
 
@@ -5,6 +5,12 @@
  *
  */
 
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
 #include "index.h"
 extern "C" {
     #include "debug.h"
@@ -21,12 +27,17 @@ cIndex::~cIndex() {
     for (int i = 0 ; i < size; i++) {
         FREE(sizeof(sIndexElement), "indexVector");
     }
+    size = frameSlot.size();
+    for (int i = 0 ; i < size; i++) {
+        FREE(sizeof(int), "frameSlot");
+    }
     size = ptsRing.size();
     for (int i = 0 ; i < size; i++) {
         FREE(sizeof(sPTS_RingbufferElement), "ptsRing");
     }
 #endif
     indexVector.clear();
+    frameSlot.clear();
     ptsRing.clear();
 }
 
@@ -38,19 +49,37 @@ int cIndex::GetLastFrameNumber() {
 
 
 // add a new entry to the list of frame timestamps
-void cIndex::Add(int fileNumber, int frameNumber, int timeOffset_ms) {
+void cIndex::Add(int fileNumber, int frameNumber, int timeOffset_ms, int64_t pos) {
      if (GetLastFrameNumber() < frameNumber) {
         // add new frame timestamp to vector
          sIndexElement newIndex;
          newIndex.fileNumber = fileNumber;
          newIndex.frameNumber = frameNumber;
          newIndex.timeOffset_ms = timeOffset_ms;
+         newIndex.pos = pos;
          indexVector.push_back(newIndex);
          ALLOC(sizeof(sIndexElement), "indexVector");
+
+         // all frames from last i-frame + 1 to new i-frame have the new i-frame as first i-frame at or after
+         int slot = indexVector.size() - 1;
+         for (int frame = frameSlot.size(); frame <= frameNumber; frame++) {
+             frameSlot.push_back(slot);
+             ALLOC(sizeof(int), "frameSlot");
+         }
      }
 }
 
 
+// get slot of the first iFrame in index with frame number >= given frame number
+// return: slot in indexVector, indexVector.size() if frame is after last iFrame in index
+//
+int cIndex::GetSlotAfter(const int frameNumber) {
+    if (frameNumber < 0) return 0;
+    if (frameNumber < static_cast<int>(frameSlot.size())) return frameSlot[frameNumber];
+    return indexVector.size();
+}
+
+
 // get nearest iFrame to given frame
 // if frame is a iFrame, frame will be returned
 // return: iFrame number
@@ -89,12 +118,10 @@ int cIndex::GetIFrameBefore(int frameNumber) {
         dsyslog("cIndex::GetIFrameBefore(): frame index not initialized");
         return -1;
     }
-    int before_iFrame = 0;
-    for (std::vector<sIndexElement>::iterator frameIterator = indexVector.begin(); frameIterator != indexVector.end(); ++frameIterator) {
-        if (frameIterator->frameNumber >= frameNumber) {
-            return before_iFrame;
-        }
-        else before_iFrame = frameIterator->frameNumber;
+    int slot = GetSlotAfter(frameNumber);
+    if (slot < static_cast<int>(indexVector.size())) {
+        if (slot == 0) return 0;
+        return indexVector[slot - 1].frameNumber;
     }
     dsyslog("cIndex::GetIFrameBefore(): failed for frame (%d), index: first frame (%d) last frame (%d)", frameNumber, indexVector.front().frameNumber, indexVector.back().frameNumber);
     return -2; // frame not yet in index
@@ -110,40 +137,51 @@ int cIndex::GetIFrameAfter(int frameNumber) {
         dsyslog("cIndex::GetIFrameAfter(): frame index not initialized");
         return -1;
     }
-    for (std::vector<sIndexElement>::iterator frameIterator = indexVector.begin(); frameIterator != indexVector.end(); ++frameIterator) {
-        if (frameIterator->frameNumber >= frameNumber) {
-            return frameIterator->frameNumber;
-        }
-    }
+    int slot = GetSlotAfter(frameNumber);
+    if (slot < static_cast<int>(indexVector.size())) return indexVector[slot].frameNumber;
     dsyslog("cIndex::GetIFrameAfter(): failed for frame (%d)", frameNumber);
     return -1;
 }
 
 
+// get file number and byte position of given iFrame
+// return: true if iFrame is in index with valid position, false otherwise
+//
+bool cIndex::GetIFramePosition(const int iFrameNumber, int *fileNumber, int64_t *pos, int *timeOffset_ms) {
+    if (!fileNumber || !pos || !timeOffset_ms) return false;
+    int slot = GetSlotAfter(iFrameNumber);
+    if (slot >= static_cast<int>(indexVector.size())) return false;
+    if (indexVector[slot].frameNumber != iFrameNumber) return false;
+    if (indexVector[slot].pos < 0) return false;
+    *fileNumber = indexVector[slot].fileNumber;
+    *pos = indexVector[slot].pos;
+    *timeOffset_ms = indexVector[slot].timeOffset_ms;
+    return true;
+}
+
+
 int cIndex::GetTimeFromFrame(int frameNumber) {
     if (indexVector.empty()) {
         dsyslog("cIndex::GetTimeFromFrame(): frame index not initialized");
         return -1;
     }
-    int before_ms = 0;
-    int before_iFrame = 0;
-
-    for (std::vector<sIndexElement>::iterator frameIterator = indexVector.begin(); frameIterator != indexVector.end(); ++frameIterator) {
-        if (frameIterator->frameNumber == frameNumber) {
-            tsyslog("cIndex::GetTimeFromFrame(): frame (%d) time is %dms", frameNumber, frameIterator->timeOffset_ms);
-            return frameIterator->timeOffset_ms;
+    int slot = GetSlotAfter(frameNumber);
+    if (slot < static_cast<int>(indexVector.size())) {
+        if (indexVector[slot].frameNumber == frameNumber) {
+            tsyslog("cIndex::GetTimeFromFrame(): frame (%d) time is %dms", frameNumber, indexVector[slot].timeOffset_ms);
+            return indexVector[slot].timeOffset_ms;
         }
-        if (frameIterator->frameNumber > frameNumber) {
-            if (abs(frameNumber - before_iFrame) < abs(frameNumber - frameIterator->frameNumber)) {
-                return before_ms;
-            }
-            else {
-                return frameIterator->timeOffset_ms;
-            }
+        int before_ms = 0;
+        int before_iFrame = 0;
+        if (slot > 0) {
+            before_iFrame = indexVector[slot - 1].frameNumber;
+            before_ms = indexVector[slot - 1].timeOffset_ms;
+        }
+        if (abs(frameNumber - before_iFrame) < abs(frameNumber - indexVector[slot].frameNumber)) {
+            return before_ms;
         }
         else {
-            before_iFrame = frameIterator->frameNumber;
-            before_ms = frameIterator->timeOffset_ms;
+            return indexVector[slot].timeOffset_ms;
         }
     }
     if (frameNumber > (indexVector.back().frameNumber - 30)) {  // we are after last iFrame but before next iFrame, possible not read jet, use last iFrame
@@ -154,16 +192,20 @@ int cIndex::GetTimeFromFrame(int frameNumber) {
 }
 
 
+bool cIndex::CompareTimeOffset(const int offset_ms, const sIndexElement &element) {
+    return offset_ms < element.timeOffset_ms;
+}
+
+
 int cIndex::GetFrameFromOffset(int offset_ms) {
     if (indexVector.empty()) {
         dsyslog("cIndex::GetFrameFromOffset: frame index not initialized");
         return -1;
     }
+    // index is sorted by time offset, search first iFrame after offset
+    std::vector<sIndexElement>::iterator after = std::upper_bound(indexVector.begin(), indexVector.end(), offset_ms, CompareTimeOffset);
     int iFrameBefore = 0;
-    for (std::vector<sIndexElement>::iterator frameIterator = indexVector.begin(); frameIterator != indexVector.end(); ++frameIterator) {
-        if (frameIterator->timeOffset_ms > offset_ms) return iFrameBefore;
-        iFrameBefore = frameIterator->frameNumber;
-    }
+    if (after != indexVector.begin()) iFrameBefore = (after - 1)->frameNumber;
     return iFrameBefore;  // return last frame if offset is not in recording, needed for VPS stopped recordings
 }
 
@@ -173,14 +215,9 @@ int cIndex::GetIFrameRangeCount(int beginFrame, int endFrame) {
         dsyslog("cIndex::GetIFrameRangeCount(): frame index not initialized");
         return -1;
     }
-    int counter=0;
-
-    for (std::vector<sIndexElement>::iterator frameIterator = indexVector.begin(); frameIterator != indexVector.end(); ++frameIterator) {
-        if (frameIterator->frameNumber >= beginFrame) {
-            counter++;
-            if (frameIterator->frameNumber >= endFrame) return counter;
-        }
-    }
+    int beginSlot = GetSlotAfter(beginFrame);
+    int endSlot = std::max(GetSlotAfter(endFrame), beginSlot);  // first iFrame >= beginFrame is counted even if it is after endFrame
+    if (endSlot < static_cast<int>(indexVector.size())) return endSlot - beginSlot + 1;
     dsyslog("cIndex::GetIFrameRangeCount(): failed beginFrame (%d) endFrame (%d) last frame in index list (%d)", beginFrame, endFrame, indexVector.back().frameNumber);
     return -1;
 }
@@ -224,3 +261,113 @@ int cIndex::GetFirstVideoFrameAfterPTS(const int64_t pts) {
     dsyslog("cIndex::GetFirstVideoFrameAfterPTS(): found video frame (%d) PTS %" PRId64 " after PTS %" PRId64, after.frameNumber, after.pts, pts);
     return after.frameNumber;
 }
+
+
+int cIndex::Count() {
+    return indexVector.size();
+}
+
+
+bool cIndex::GetElement(const int slot, int *fileNumber, int *frameNumber, int *timeOffset_ms, int64_t *pos) {
+    if ((slot < 0) || (slot >= static_cast<int>(indexVector.size()))) return false;
+    if (!fileNumber || !frameNumber || !timeOffset_ms || !pos) return false;
+    *fileNumber = indexVector[slot].fileNumber;
+    *frameNumber = indexVector[slot].frameNumber;
+    *timeOffset_ms = indexVector[slot].timeOffset_ms;
+    *pos = indexVector[slot].pos;
+    return true;
+}
+
+
+#define VDRINDEX_READ_ENTRIES 4096  // index entries read at once
+
+// entry of the VDR index file, same layout as tIndexTs of VDR
+struct sVDRIndexEntry {
+    uint64_t offset:40;
+    int reserved:7;
+    int independent:1;
+    uint16_t number:16;
+};
+static_assert(sizeof(sVDRIndexEntry) == 8, "size of sVDRIndexEntry must be 8");
+
+
+cVDRIndex::cVDRIndex(const char *recDir) {
+    if (!recDir) return;
+    if (asprintf(&indexFile, "%s/index", recDir) == -1) {
+        indexFile = NULL;
+        return;
+    }
+    ALLOC(strlen(indexFile)+1, "indexFile");
+    fd = open(indexFile, O_RDONLY);
+    if (fd < 0) dsyslog("cVDRIndex::cVDRIndex(): failed to open %s", indexFile);
+    else ReadEntries();
+}
+
+
+cVDRIndex::~cVDRIndex() {
+    if (fd >= 0) close(fd);
+    if (indexFile) {
+        FREE(strlen(indexFile)+1, "indexFile");
+        free(indexFile);
+    }
+#ifdef DEBUG_MEM
+    int size = iFrames.size();
+    for (int i = 0 ; i < size; i++) {
+        FREE(sizeof(sVDRIFrame), "iFrames");
+    }
+#endif
+    iFrames.clear();
+}
+
+
+bool cVDRIndex::ReadEntries() {
+    if (fd < 0) return false;
+    sVDRIndexEntry entries[VDRINDEX_READ_ENTRIES];
+    int oldFrameCount = frameCount;
+    while (true) {
+        ssize_t bytes = pread(fd, entries, sizeof(entries), static_cast<off_t>(frameCount) * sizeof(sVDRIndexEntry));
+        if (bytes <= 0) break;
+        int count = bytes / sizeof(sVDRIndexEntry);  // ignore incomplete last entry of a growing index file
+        for (int i = 0; i < count; i++) {
+            if (entries[i].independent) {
+                sVDRIFrame iFrame;
+                iFrame.frameNumber = frameCount + i;
+                iFrame.fileNumber = entries[i].number;
+                iFrame.pos = entries[i].offset;
+                iFrames.push_back(iFrame);
+                ALLOC(sizeof(sVDRIFrame), "iFrames");
+            }
+        }
+        frameCount += count;
+        if (bytes < static_cast<ssize_t>(sizeof(entries))) break;
+    }
+    return (frameCount > oldFrameCount);
+}
+
+
+bool cVDRIndex::CompareFrameNumber(const int frameNumber, const sVDRIFrame &iFrame) {
+    return frameNumber < iFrame.frameNumber;
+}
+
+
+bool cVDRIndex::GetIFrameAfter(const int frameNumber, int *iFrameNumber, int *fileNumber, int64_t *pos) {
+    if (!iFrameNumber || !fileNumber || !pos) return false;
+    std::vector<sVDRIFrame>::iterator iFrame = std::upper_bound(iFrames.begin(), iFrames.end(), frameNumber, CompareFrameNumber);
+    if ((iFrame == iFrames.end()) || (iFrame->frameNumber >= (frameCount - 1))) {  // i-frame is not yet complete in a growing recording
+        if (!ReadEntries()) return false;
+        iFrame = std::upper_bound(iFrames.begin(), iFrames.end(), frameNumber, CompareFrameNumber);
+        if ((iFrame == iFrames.end()) || (iFrame->frameNumber >= (frameCount - 1))) return false;
+    }
+    *iFrameNumber = iFrame->frameNumber;
+    *fileNumber = iFrame->fileNumber;
+    *pos = iFrame->pos;
+    return true;
+}
+
+
+bool cVDRIndex::IsIFrame(const int frameNumber, const int fileNumber, const int64_t pos) {
+    if (frameNumber >= frameCount) ReadEntries();
+    std::vector<sVDRIFrame>::iterator iFrame = std::upper_bound(iFrames.begin(), iFrames.end(), frameNumber - 1, CompareFrameNumber);
+    if (iFrame == iFrames.end()) return false;
+    return ((iFrame->frameNumber == frameNumber) && (iFrame->fileNumber == fileNumber) && (iFrame->pos == pos));
+}
@@ -28,8 +28,9 @@ class cIndex {
  * @param fileNumber  number of ts file
  * @param frameNumber number of frame
  * @param timeOffset_ms offset in ms from recording start
+ * @param pos         byte position of the frame packet in the ts file, -1 if unknown
  */
-        void Add(int fileNumber, int frameNumber, int timeOffset_ms);
+        void Add(int fileNumber, int frameNumber, int timeOffset_ms, int64_t pos);
 
 /**
  * get i-frame before frameNumber
@@ -45,6 +46,16 @@ class cIndex {
  */
         int GetIFrameAfter(int frameNumber);
 
+/**
+ * get position of an i-frame in the recording
+ * @param[in]  iFrameNumber  frame number of the i-frame
+ * @param[out] fileNumber    number of ts file with the i-frame
+ * @param[out] pos           byte position of the i-frame packet in the ts file
+ * @param[out] timeOffset_ms offset in ms from recording start
+ * @return true if i-frame is in the index with a valid position, false otherwise
+ */
+        bool GetIFramePosition(const int iFrameNumber, int *fileNumber, int64_t *pos, int *timeOffset_ms);
+
 /**
  * get offset time from recoring start in ms
  * @param frameNumber number of the frame
@@ -80,6 +91,23 @@ class cIndex {
  */
         int GetFirstVideoFrameAfterPTS(const int64_t pts);
 
+/**
+ * get count of i-frames in the recording index
+ * @return count of i-frames in the recording index
+ */
+        int Count();
+
+/**
+ * get an i-frame of the recording index
+ * @param[in]  slot          slot in recording index
+ * @param[out] fileNumber    number of ts file with the i-frame
+ * @param[out] frameNumber   frame number of the i-frame
+ * @param[out] timeOffset_ms offset in ms from recording start
+ * @param[out] pos           byte position of the i-frame packet in the ts file
+ * @return true if slot is valid, false otherwise
+ */
+        bool GetElement(const int slot, int *fileNumber, int *frameNumber, int *timeOffset_ms, int64_t *pos);
+
     private:
 /**
  * get last stored frame number of the recording index
@@ -87,6 +115,13 @@ class cIndex {
  */
         int GetLastFrameNumber();
 
+/**
+ * get slot of the first i-frame in the recording index with frame number >= frameNumber
+ * @param frameNumber number of frame
+ * @return slot in recording index, size of recording index if frameNumber is after last i-frame
+ */
+        int GetSlotAfter(const int frameNumber);
+
 /**
  * element of the video index
  */
@@ -99,9 +134,22 @@ class cIndex {
 
             int timeOffset_ms = 0;                  //!< time offset from start of the recording in ms
                                                     //!<
+
+            int64_t pos = -1;                       //!< byte position of the frame packet in the TS file
+                                                    //!<
         };
+/**
+ * compare function to search recording index by time offset
+ * @param offset_ms time offset from start of the recording in ms
+ * @param element   element of the recording index
+ * @return true if offset_ms is before time offset of element, false otherwise
+ */
+        static bool CompareTimeOffset(const int offset_ms, const sIndexElement &element);
+
         std::vector<sIndexElement> indexVector;     //!< recording index
                                                     //!<
+        std::vector<int> frameSlot;                 //!< slot in recording index of the first i-frame at or after each frame number
+                                                    //!<
 /**
  * ring buffer element to store frame presentation timestamp
  */
@@ -114,4 +162,104 @@ class cIndex {
         std::vector<sPTS_RingbufferElement> ptsRing; //!< ring buffer for PTS per frameA
                                                      //!<
 };
+
+
+/**
+ * read access to the index file of the VDR recording <br>
+ * VDR stores number of ts file, byte offset and i-frame flag of each frame, only the i-frames are kept in memory <br>
+ * new entries of a growing index file are read on demand
+ */
+class cVDRIndex {
+    public:
+
+/**
+ * constructor of the VDR index class
+ * @param recDir recording directory
+ */
+        explicit cVDRIndex(const char *recDir);
+
+        ~cVDRIndex();
+
+/**
+ * copy constructor, not used, only for formal reason
+ */
+        cVDRIndex(const cVDRIndex &origin) {
+            indexFile = NULL;
+            fd = -1;
+            frameCount = origin.frameCount;
+        };
+
+/**
+ * operator=, not used, only for formal reason
+ */
+        cVDRIndex &operator =(const cVDRIndex *origin) {
+            indexFile = NULL;
+            fd = -1;
+            frameCount = origin->frameCount;
+            return *this;
+        }
+
+/**
+ * check if index file is open
+ * @return true if index file is open, false otherwise
+ */
+        bool IsOpen() {
+            return (fd >= 0);
+        }
+
+/**
+ * get first i-frame after a frame, the following frame of the i-frame has to be in the index too
+ * @param[in]  frameNumber  frame number
+ * @param[out] iFrameNumber frame number of the i-frame
+ * @param[out] fileNumber   number of ts file with the i-frame
+ * @param[out] pos          byte position of the i-frame in the ts file
+ * @return true if there is a complete i-frame after frameNumber in the index, false otherwise
+ */
+        bool GetIFrameAfter(const int frameNumber, int *iFrameNumber, int *fileNumber, int64_t *pos);
+
+/**
+ * check if a frame is an i-frame at this position in the VDR index
+ * @param frameNumber frame number
+ * @param fileNumber  number of ts file
+ * @param pos         byte position of the frame in the ts file
+ * @return true if frame is an i-frame at this position, false otherwise
+ */
+        bool IsIFrame(const int frameNumber, const int fileNumber, const int64_t pos);
+
+    private:
+/**
+ * read new entries of the index file
+ * @return true if new entries were read, false otherwise
+ */
+        bool ReadEntries();
+
+/**
+ * i-frame of the VDR index
+ */
+        struct sVDRIFrame {
+            int frameNumber = 0;                    //!< video frame number
+                                                    //!<
+            int fileNumber = 0;                     //!< number of TS file
+                                                    //!<
+            int64_t pos = -1;                       //!< byte position of the frame in the TS file
+                                                    //!<
+        };
+
+/**
+ * compare function to search i-frames by frame number
+ * @param frameNumber frame number
+ * @param iFrame      i-frame of the VDR index
+ * @return true if frameNumber is before frame number of iFrame, false otherwise
+ */
+        static bool CompareFrameNumber(const int frameNumber, const sVDRIFrame &iFrame);
+
+        char *indexFile = NULL;                     //!< name of the VDR index file
+                                                    //!<
+        int fd = -1;                                //!< file descriptor of the VDR index file, -1 if not open
+                                                    //!<
+        int frameCount = 0;                         //!< count of frames read from index file
+                                                    //!<
+        std::vector<sVDRIFrame> iFrames;            //!< i-frames of the VDR index
+                                                    //!<
+};
 #endif
@@ -10,6 +10,7 @@
 
 #include "logo.h"
 #include "index.h"
+#include "perf.h"
 
 extern "C"{
     #include "debug.h"
@@ -42,9 +43,7 @@ cExtractLogo::cExtractLogo(sMarkAdContext *maContext, const sAspectRatio AspectR
 
 
 cExtractLogo::~cExtractLogo() {
-#ifdef DEBUG_MEM
     int maxLogoPixel = GetMaxLogoPixel(maContextLogoSize->Video.Info.width);
-#endif
     for (int corner = 0; corner < CORNERS; corner++) {  // free memory of all corners
 #ifdef DEBUG_MEM
         int size = logoInfoVector[corner].size();
@@ -54,11 +53,7 @@ cExtractLogo::~cExtractLogo() {
 #endif
         // free memory of sobel plane vector
         for (std::vector<sLogoInfo>::iterator actLogo = logoInfoVector[corner].begin(); actLogo != logoInfoVector[corner].end(); ++actLogo) {
-            for (int plane = 0; plane < PLANES; plane++) {
-                delete actLogo->sobel[plane];
-            }
-            delete actLogo->sobel;
-            FREE(sizeof(uchar*) * PLANES * sizeof(uchar) * maxLogoPixel, "actLogoInfo.sobel");
+            FreeLogoInfo(&(*actLogo), maxLogoPixel);
         }
         logoInfoVector[corner].clear();
     }
@@ -857,6 +852,11 @@ int cExtractLogo::Compare(const sMarkAdContext *maContext, sLogoInfo *ptr_actLog
             }
         }
         else {
+            compareCount[corner]++;
+            if (!SignatureMatchPossible(&(*actLogo), ptr_actLogoInfo, logoHeight, logoWidth)) {
+                compareSkipped[corner]++;
+                continue;
+            }
             if (CompareLogoPair(&(*actLogo), ptr_actLogoInfo, logoHeight, logoWidth, corner)) {
                 hits++;
                 actLogo->hits++;
@@ -873,6 +873,7 @@ int cExtractLogo::Compare(const sMarkAdContext *maContext, sLogoInfo *ptr_actLog
 bool cExtractLogo::CompareLogoPairRotating(const sMarkAdContext *maContext, sLogoInfo *logo1, sLogoInfo *logo2, const int logoHeight, const int logoWidth, const int corner) {
     if (!logo1) return false;
     if (!logo2) return false;
+    if (!logo1->sobel || !logo2->sobel) return false;
     if ((corner < 0) || (corner >= CORNERS)) return false;
 // TODO do not hardcode the logo range
     int logoStartLine   = 0;
@@ -942,16 +943,39 @@ bool cExtractLogo::CompareLogoPair(const sLogoInfo *logo1, const sLogoInfo *logo
     int oneBlack_0 = 0;
     int rate_0 = 0;
     int rate_1_2 = 0;
-    for (int i = 0; i < logoHeight*logoWidth; i++) {    // compare all black pixel in plane 0
-        if ((logo1->sobel[0][i] == 255) && (logo2->sobel[0][i] == 255)) continue;   // ignore white pixel
-        else oneBlack_0 ++;
-        if (logo1->sobel[0][i] == logo2->sobel[0][i]) {
-            similar_0++;
+    bool packed = true;
+    for (int plane = 0; plane < PLANES; plane ++) {
+        int pixelCount = (plane == 0) ? logoHeight * logoWidth : logoHeight / 2 * logoWidth / 2;
+        if (!logo1->blackBits[plane] || !logo2->blackBits[plane] || (logo1->blackBitsCount[plane] != pixelCount) || (logo2->blackBitsCount[plane] != pixelCount)) packed = false;
+    }
+    if (packed) {  // black and white logos, compare 64 pixel at once, unused bits are 0 in both logos
+        for (int word = 0; word < (logoHeight * logoWidth + 63) / 64; word++) {  // compare all black pixel in plane 0
+            oneBlack_0 += __builtin_popcountll(logo1->blackBits[0][word] | logo2->blackBits[0][word]);
+            similar_0 += __builtin_popcountll(logo1->blackBits[0][word] & logo2->blackBits[0][word]);
+        }
+        for (int plane = 1; plane < PLANES; plane ++) {  // compare all pixel in plane 1 and 2
+            similar_1_2 += logo1->blackBitsCount[plane];
+            for (int word = 0; word < (logo1->blackBitsCount[plane] + 63) / 64; word++) {
+                similar_1_2 -= __builtin_popcountll(logo1->blackBits[plane][word] ^ logo2->blackBits[plane][word]);
+            }
         }
     }
-    for (int i = 0; i < logoHeight / 2 * logoWidth / 2; i++) {    // compare all pixel in plane 1 and 2
-        for (int plane = 1; plane < PLANES; plane ++) {
-            if (logo1->sobel[plane][i] == logo2->sobel[plane][i]) similar_1_2++;
+    else {
+        if (!logo1->sobel || !logo2->sobel) {
+            dsyslog("cExtractLogo::CompareLogoPair(): frame (%5d) and (%5d): no sobel planes", logo1->iFrameNumber, logo2->iFrameNumber);
+            return false;
+        }
+        for (int i = 0; i < logoHeight*logoWidth; i++) {    // compare all black pixel in plane 0
+            if ((logo1->sobel[0][i] == 255) && (logo2->sobel[0][i] == 255)) continue;   // ignore white pixel
+            else oneBlack_0 ++;
+            if (logo1->sobel[0][i] == logo2->sobel[0][i]) {
+                similar_0++;
+            }
+        }
+        for (int i = 0; i < logoHeight / 2 * logoWidth / 2; i++) {    // compare all pixel in plane 1 and 2
+            for (int plane = 1; plane < PLANES; plane ++) {
+                if (logo1->sobel[plane][i] == logo2->sobel[plane][i]) similar_1_2++;
+            }
         }
     }
 #define MIN_BLACK_PLANE_0 100
@@ -979,10 +1003,120 @@ if (corner == DEBUG_LOGO_CORNER) dsyslog("cExtractLogo::CompareLogoPair(): logo
     return false;
 }
 
+// count black pixel of each plane in a coarse grid and pack black pixel into bit maps, use the same pixel range as CompareLogoPair()
+// pixel values have to be 0 or 255, otherwise the logo gets no signature and no bit maps
+//
+bool cExtractLogo::PackLogo(sLogoInfo *logoInfo, const int logoHeight, const int logoWidth) {
+    if (!logoInfo) return false;
+    if (!logoInfo->sobel) return false;
+    logoInfo->signatureHeight = 0;
+    logoInfo->signatureWidth = 0;
+    memset(logoInfo->blackCells, 0, sizeof(logoInfo->blackCells));
+    if ((logoHeight < 2) || (logoWidth < 2)) return false;
+    for (int plane = 0; plane < PLANES; plane++) {
+        int width = logoWidth;
+        int pixelCount = logoHeight * logoWidth;
+        if (plane > 0) {
+            width = logoWidth / 2;
+            pixelCount = logoHeight / 2 * logoWidth / 2;
+        }
+        int height = (pixelCount + width - 1) / width;
+        for (int i = 0; i < pixelCount; i++) {
+            uchar pixel = logoInfo->sobel[plane][i];
+            if (pixel == 255) continue;
+            if (pixel != 0) return false;  // no black and white picture
+            int cell = ((i / width) * SIGNATURE_GRID / height) * SIGNATURE_GRID + ((i % width) * SIGNATURE_GRID / width);
+            logoInfo->blackCells[plane][cell]++;
+        }
+    }
+    logoInfo->signatureHeight = logoHeight;
+    logoInfo->signatureWidth = logoWidth;
+
+    for (int plane = 0; plane < PLANES; plane++) {
+        int pixelCount = (plane == 0) ? logoHeight * logoWidth : logoHeight / 2 * logoWidth / 2;
+        int words = (pixelCount + 63) / 64;
+        logoInfo->blackBits[plane] = new uint64_t[words];
+        ALLOC(sizeof(uint64_t) * words, "actLogoInfo.blackBits");
+        logoInfo->blackBitsCount[plane] = pixelCount;
+        cMarkAdLogo::PackBlackPixel(logoInfo->sobel[plane], pixelCount, logoInfo->blackBits[plane]);
+    }
+    return true;
+}
+
+
+void cExtractLogo::UnpackLogo(sLogoInfo *logoInfo, const int maxLogoPixel) {
+    if (!logoInfo) return;
+    if (logoInfo->sobel) return;
+    logoInfo->sobel = new uchar*[PLANES];
+    for (int plane = 0; plane < PLANES; plane++) {
+        logoInfo->sobel[plane] = new uchar[maxLogoPixel];
+        memset(logoInfo->sobel[plane], 255, sizeof(uchar) * maxLogoPixel);
+        for (int i = 0; (i < logoInfo->blackBitsCount[plane]) && (i < maxLogoPixel); i++) {
+            if ((logoInfo->blackBits[plane][i / 64] >> (i % 64)) & 1) logoInfo->sobel[plane][i] = 0;
+        }
+    }
+    ALLOC(sizeof(uchar*) * PLANES * sizeof(uchar) * maxLogoPixel, "actLogoInfo.sobel");
+}
+
+
+void cExtractLogo::FreeLogoInfo(sLogoInfo *logoInfo, __attribute__((unused)) const int maxLogoPixel) {
+    if (!logoInfo) return;
+    if (logoInfo->sobel) {
+        for (int plane = 0; plane < PLANES; plane++) {
+            delete logoInfo->sobel[plane];
+        }
+        delete logoInfo->sobel;
+        logoInfo->sobel = NULL;
+        FREE(sizeof(uchar*) * PLANES * sizeof(uchar) * maxLogoPixel, "actLogoInfo.sobel");
+    }
+    for (int plane = 0; plane < PLANES; plane++) {
+        if (logoInfo->blackBits[plane]) {
+            FREE(sizeof(uint64_t) * ((logoInfo->blackBitsCount[plane] + 63) / 64), "actLogoInfo.blackBits");
+            delete[] logoInfo->blackBits[plane];
+            logoInfo->blackBits[plane] = NULL;
+        }
+    }
+}
+
+
+// calculate upper limits of match rates from count of black pixel in each grid cell
+// plane 0: similar pixel are at most the sum of smaller counts, one black pixel are at least the sum of bigger counts
+// plane 1 and 2: each black pixel count difference is at least one different pixel
+//
+bool cExtractLogo::SignatureMatchPossible(const sLogoInfo *logo1, const sLogoInfo *logo2, const int logoHeight, const int logoWidth) {
+    if (!logo1) return true;
+    if (!logo2) return true;
+    if ((logo1->signatureHeight != logoHeight) || (logo1->signatureWidth != logoWidth)) return true;
+    if ((logo2->signatureHeight != logoHeight) || (logo2->signatureWidth != logoWidth)) return true;
+
+    int similarMax_0 = 0;
+    int oneBlackMin_0 = 0;
+    int oneBlackMax_0 = 0;
+    for (int cell = 0; cell < SIGNATURE_GRID * SIGNATURE_GRID; cell++) {
+        int black1 = logo1->blackCells[0][cell];
+        int black2 = logo2->blackCells[0][cell];
+        similarMax_0 += (black1 < black2) ? black1 : black2;
+        oneBlackMin_0 += (black1 > black2) ? black1 : black2;
+        oneBlackMax_0 += black1 + black2;
+    }
+    if (oneBlackMax_0 <= MIN_BLACK_PLANE_0) return false;  // rate_0 will be 0 or -1
+    if ((1000 * similarMax_0 / oneBlackMin_0) <= MINMATCH0) return false;
+
+    int similarMax_1_2 = 2 * (logoHeight / 2 * logoWidth / 2);
+    for (int plane = 1; plane < PLANES; plane++) {
+        for (int cell = 0; cell < SIGNATURE_GRID * SIGNATURE_GRID; cell++) {
+            similarMax_1_2 -= abs(logo1->blackCells[plane][cell] - logo2->blackCells[plane][cell]);
+        }
+    }
+    if ((1000 * similarMax_1_2 / (logoHeight * logoWidth) * 2) <= MINMATCH12) return false;
+    return true;
+}
+
 
 int cExtractLogo::DeleteFrames(const sMarkAdContext *maContext, const int from, const int to) {
     if (!maContext) return 0;
     if (from >= to) return 0;
+    WaitForCorners();  // corner workers have to finish before we change logoInfoVector
     int deleteCount = 0;
     dsyslog("cExtractLogo::DeleteFrames(): delete frames from %d to %d", from, to);
     for (int corner = 0; corner < CORNERS; corner++) {
@@ -991,14 +1125,7 @@ int cExtractLogo::DeleteFrames(const sMarkAdContext *maContext, const int from,
             if (actLogo->iFrameNumber < from) continue;
             if (actLogo->iFrameNumber <= to) {
                 // free memory of sobel planes
-                for (int plane = 0; plane < PLANES; plane++) {
-                    delete actLogo->sobel[plane];
-                }
-                delete actLogo->sobel;
-#ifdef DEBUG_MEM
-                int maxLogoPixel = GetMaxLogoPixel(maContext->Video.Info.width);
-#endif
-                FREE(sizeof(uchar*) * PLANES * sizeof(uchar) * maxLogoPixel, "actLogoInfo.sobel");
+                FreeLogoInfo(&(*actLogo), GetMaxLogoPixel(maContext->Video.Info.width));
 
                 // delete vector element
                 FREE(sizeof(*actLogo), "logoInfoVector");
@@ -1061,31 +1188,43 @@ bool cExtractLogo::WaitForFrames(sMarkAdContext *maContext, cDecoder *ptr_cDecod
 
     bool ret = false;
     struct stat indexStatus;
-    for (int retry = 0; retry < 10; retry++) {
+    cRecordingWaiter *recordingWaiter = NULL;
+    int retry = 0;
+    while (retry < 10) {
         if (stat(indexFile,&indexStatus) == -1) {
             dsyslog("cExtractLogo::WaitForFrames: failed to stat %s", indexFile);
             ret = false;
             break;
         }
         recordingFrameCount = indexStatus.st_size / 8;
-        dsyslog("cExtractLogo::WaitForFrames(): frames recorded (%d) read frames (%d) minFrame (%d)", recordingFrameCount, ptr_cDecoder->GetFrameNumber(), minFrame);
         if ((recordingFrameCount > (ptr_cDecoder->GetFrameNumber() + 200)) && (recordingFrameCount > minFrame)) {
+            dsyslog("cExtractLogo::WaitForFrames(): frames recorded (%d) read frames (%d) minFrame (%d)", recordingFrameCount, ptr_cDecoder->GetFrameNumber(), minFrame);
             ret = true;  // recording has enough frames
             break;
         }
         time_t now = time(NULL);
-        char systemTime[50] = {0};
-        char indexTime[50] = {0};
-        strftime(systemTime, sizeof(systemTime), "%d-%m-%Y %H:%M:%S", localtime(&now));
-        strftime(indexTime, sizeof(indexTime), "%d-%m-%Y %H:%M:%S", localtime(&indexStatus.st_mtime));
-        dsyslog("cExtractLogo::WaitForFrames(): index file size %" PRId64 " bytes, system time %s index time %s, wait %ds", indexStatus.st_size, systemTime, indexTime, WAITTIME);
         if ((difftime(now, indexStatus.st_mtime)) >= 2 * WAITTIME) {
             dsyslog("cExtractLogo::isRunningRecording(): index not growing at frame (%d), old or interrupted recording", ptr_cDecoder->GetFrameNumber());
             ret = false;
             break;
         }
+        if (!recordingWaiter) {
+            char systemTime[50] = {0};
+            char indexTime[50] = {0};
+            strftime(systemTime, sizeof(systemTime), "%d-%m-%Y %H:%M:%S", localtime(&now));
+            strftime(indexTime, sizeof(indexTime), "%d-%m-%Y %H:%M:%S", localtime(&indexStatus.st_mtime));
+            dsyslog("cExtractLogo::WaitForFrames(): frames recorded (%d) read frames (%d) minFrame (%d)", recordingFrameCount, ptr_cDecoder->GetFrameNumber(), minFrame);
+            dsyslog("cExtractLogo::WaitForFrames(): index file size %" PRId64 " bytes, system time %s index time %s, wait max %ds", indexStatus.st_size, systemTime, indexTime, WAITTIME);
+            recordingWaiter = new cRecordingWaiter(maContext->Config->recDir);
+            ALLOC(sizeof(*recordingWaiter), "recordingWaiter");
+        }
         maContext->Info.isRunningRecording = true;
-        sleep(WAITTIME); // now we sleep and hopefully the index will grow
+        if (!recordingWaiter->Wait(WAITTIME * 1000)) retry++;  // wakes up as soon as VDR writes new data, count only waits without new data
+        if (abortNow) break;
+    }
+    if (recordingWaiter) {
+        FREE(sizeof(*recordingWaiter), "recordingWaiter");
+        delete recordingWaiter;
     }
     FREE(strlen(indexFile)+1, "indexFile");
     free(indexFile);
@@ -1186,7 +1325,190 @@ int cExtractLogo::AudioInBroadcast(const sMarkAdContext *maContext, const int iF
 }
 
 
+void cExtractLogo::StartCornerThreads(sMarkAdContext *maContext) {
+    cornerContext = *maContext;
+    cornerGeneration = 0;
+    cornerBusy = 0;
+    cornerStop = false;
+    cornerOutOfMemory = false;
+    for (int corner = 0; corner < CORNERS; corner++) {
+        compareCount[corner] = 0;
+        compareSkipped[corner] = 0;
+        cornerWorker[corner].extractLogo = this;
+        cornerWorker[corner].corner = corner;
+        cornerWorker[corner].ptr_Logo = new cMarkAdLogo(&cornerContext, recordingIndexLogo);
+        ALLOC(sizeof(*cornerWorker[corner].ptr_Logo), "SearchLogo-ptr_Logo");
+        cornerWorker[corner].ptr_Logo->GetArea()->corner = corner;
+        cornerWorker[corner].running = (pthread_create(&cornerWorker[corner].thread, NULL, (void *(*) (void *))&CornerThread, (void *) &cornerWorker[corner]) == 0);
+        if (!cornerWorker[corner].running) esyslog("cExtractLogo::StartCornerThreads(): failed to start worker thread for corner %s, process in main thread", aCorner[corner]);
+    }
+}
+
+
+void cExtractLogo::StopCornerThreads() {
+    WaitForCorners();  // logo of the last started frame has to be stored before the workers stop
+    pthread_mutex_lock(&cornerMutex);
+    cornerStop = true;
+    pthread_cond_broadcast(&cornerCondStart);
+    pthread_mutex_unlock(&cornerMutex);
+    for (int corner = 0; corner < CORNERS; corner++) {
+        if (cornerWorker[corner].running) {
+            pthread_join(cornerWorker[corner].thread, NULL);
+            cornerWorker[corner].running = false;
+        }
+        if (cornerWorker[corner].ptr_Logo) {
+            FREE(sizeof(*cornerWorker[corner].ptr_Logo), "SearchLogo-ptr_Logo");
+            delete cornerWorker[corner].ptr_Logo;
+            cornerWorker[corner].ptr_Logo = NULL;
+        }
+    }
+    cornerBusy = 0;
+    for (int plane = 0; plane < PLANES; plane++) {
+        if (cornerPlane[plane]) {
+            FREE(sizeof(uchar) * cornerPlaneSize[plane], "cornerPlane");
+            delete[] cornerPlane[plane];
+            cornerPlane[plane] = NULL;
+            cornerPlaneSize[plane] = 0;
+        }
+    }
+}
+
+
+void *cExtractLogo::CornerThread(void *worker) {
+    sCornerWorker *cornerWorker = static_cast<sCornerWorker *>(worker);
+    cExtractLogo *extractLogo = cornerWorker->extractLogo;
+    int generation = 0;
+    pthread_mutex_lock(&extractLogo->cornerMutex);
+    while (true) {
+        while (!extractLogo->cornerStop && (extractLogo->cornerGeneration == generation)) pthread_cond_wait(&extractLogo->cornerCondStart, &extractLogo->cornerMutex);
+        if (extractLogo->cornerStop) break;
+        generation = extractLogo->cornerGeneration;
+        pthread_mutex_unlock(&extractLogo->cornerMutex);
+
+        extractLogo->ProcessCorner(cornerWorker->ptr_Logo, cornerWorker->corner);
+
+        pthread_mutex_lock(&extractLogo->cornerMutex);
+        extractLogo->cornerBusy--;
+        if (extractLogo->cornerBusy == 0) pthread_cond_signal(&extractLogo->cornerCondDone);
+    }
+    pthread_mutex_unlock(&extractLogo->cornerMutex);
+    return NULL;
+}
+
+
+// copy frame data of current frame, the decoder can go on with the next frame while the corner workers are running
+// return: false if a corner worker failed to store the logo of the previous frame, true otherwise
+//
+bool cExtractLogo::ProcessCorners(const sMarkAdContext *maContext, const int iFrameNumber, const int maxLogoPixel, const int logoHeight, const int logoWidth) {
+    WaitForCorners();
+    if (cornerOutOfMemory) return false;
+    cornerContext = *maContext;
+    for (int plane = 0; plane < PLANES; plane++) {
+        int height = (plane == 0) ? maContext->Video.Info.height : (maContext->Video.Info.height + 1) / 2;  // YUV420
+        int size = maContext->Video.Data.PlaneLinesize[plane] * height;
+        if (!maContext->Video.Data.Plane[plane] || (size <= 0)) {
+            cornerContext.Video.Data.Plane[plane] = NULL;
+            cornerContext.Video.Data.PlaneLinesize[plane] = 0;
+            continue;
+        }
+        if (size > cornerPlaneSize[plane]) {
+            if (cornerPlane[plane]) {
+                FREE(sizeof(uchar) * cornerPlaneSize[plane], "cornerPlane");
+                delete[] cornerPlane[plane];
+            }
+            cornerPlane[plane] = new uchar[size];
+            cornerPlaneSize[plane] = size;
+            ALLOC(sizeof(uchar) * cornerPlaneSize[plane], "cornerPlane");
+        }
+        memcpy(cornerPlane[plane], maContext->Video.Data.Plane[plane], sizeof(uchar) * size);
+        cornerContext.Video.Data.Plane[plane] = cornerPlane[plane];
+    }
+    cornerIFrameNumber = iFrameNumber;
+    cornerMaxLogoPixel = maxLogoPixel;
+    cornerLogoHeight = logoHeight;
+    cornerLogoWidth = logoWidth;
+
+    pthread_mutex_lock(&cornerMutex);
+    for (int corner = 0; corner < CORNERS; corner++) {
+        if (cornerWorker[corner].running) cornerBusy++;
+    }
+    cornerGeneration++;
+    pthread_cond_broadcast(&cornerCondStart);
+    pthread_mutex_unlock(&cornerMutex);
+
+    for (int corner = 0; corner < CORNERS; corner++) {  // fallback if we could not start the worker thread
+        if (!cornerWorker[corner].running) ProcessCorner(cornerWorker[corner].ptr_Logo, corner);
+    }
+    return true;
+}
+
+
+// called by corner worker threads, only logoInfoVector of the own corner is changed
+//
+void cExtractLogo::ProcessCorner(cMarkAdLogo *ptr_Logo, const int corner) {
+    if (!ptr_Logo) return;
+    int iFrameNumberNext = -1;  // flag for detect logo: -1: called by cExtractLogo, dont analyse, only fill area
+                                //                       -2: called by cExtractLogo, dont analyse, only fill area, store logos in /tmp for debug
+#if defined(DEBUG_LOGO_CORNER) && defined(DEBUG_LOGO_SAVE) && DEBUG_LOGO_SAVE == 0
+    if (corner == DEBUG_LOGO_CORNER) iFrameNumberNext = -2;   // only for debuging, store logo file to /tmp
+#endif
+    ptr_Logo->Detect(0, cornerIFrameNumber, &iFrameNumberNext);  // we do not take care if we detect the logo, we only fill the area
+    sAreaT *area = ptr_Logo->GetArea();
+    sLogoInfo actLogoInfo = {};
+    actLogoInfo.iFrameNumber = cornerIFrameNumber;
+
+    // alloc memory and copy planes
+    actLogoInfo.sobel = new uchar*[PLANES];
+    for (int plane = 0; plane < PLANES; plane++) {
+        actLogoInfo.sobel[plane] = new uchar[cornerMaxLogoPixel];
+        memcpy(actLogoInfo.sobel[plane], area->sobel[plane], sizeof(uchar) * cornerMaxLogoPixel);
+    }
+    ALLOC(sizeof(uchar*) * PLANES * sizeof(uchar) * cornerMaxLogoPixel, "actLogoInfo.sobel");
+
+    if (CheckValid(&cornerContext, &actLogoInfo, cornerLogoHeight, cornerLogoWidth, corner)) {
+        RemovePixelDefects(&cornerContext, &actLogoInfo, cornerLogoHeight, cornerLogoWidth, corner);
+        bool packed = false;
+        if (!cornerContext.Video.Logo.isRotating) packed = PackLogo(&actLogoInfo, cornerLogoHeight, cornerLogoWidth);  // rotating logo detection changes sobel planes
+        actLogoInfo.hits = Compare(&cornerContext, &actLogoInfo, cornerLogoHeight, cornerLogoWidth, corner);
+        if (packed) {  // we only need the bit maps of stored logos, sobel planes will be restored for best logos
+            for (int plane = 0; plane < PLANES; plane++) {
+                delete actLogoInfo.sobel[plane];
+            }
+            delete actLogoInfo.sobel;
+            actLogoInfo.sobel = NULL;
+            FREE(sizeof(uchar*) * PLANES * sizeof(uchar) * cornerMaxLogoPixel, "actLogoInfo.sobel");
+        }
+
+        try { logoInfoVector[corner].push_back(actLogoInfo); }  // this allocates a lot of memory
+        catch(std::bad_alloc &e) {
+            dsyslog("cExtractLogo::ProcessCorner(): out of memory in pushback vector at frame %d", cornerIFrameNumber);
+            pthread_mutex_lock(&cornerMutex);
+            cornerOutOfMemory = true;
+            pthread_mutex_unlock(&cornerMutex);
+            return;
+        }
+        ALLOC((sizeof(sLogoInfo)), "logoInfoVector");
+    }
+    else {  // corner sobel transformed picture not valid
+        // free memory of sobel planes
+        for (int plane = 0; plane < PLANES; plane++) {
+            delete actLogoInfo.sobel[plane];
+        }
+        delete actLogoInfo.sobel;
+        FREE(sizeof(uchar*) * PLANES * sizeof(uchar) * cornerMaxLogoPixel, "actLogoInfo.sobel");
+    }
+}
+
+
+void cExtractLogo::WaitForCorners() {
+    pthread_mutex_lock(&cornerMutex);
+    while (cornerBusy > 0) pthread_cond_wait(&cornerCondDone, &cornerMutex);
+    pthread_mutex_unlock(&cornerMutex);
+}
+
+
 int cExtractLogo::SearchLogo(sMarkAdContext *maContext, int startFrame) {  // return -1 internal error, 0 ok, > 0 no logo found, return last framenumber of search
+    cPerfTimer perfTimer(PERF_LOGO_SEARCH);
     dsyslog("----------------------------------------------------------------------------");
     dsyslog("cExtractLogo::SearchLogo(): start extract logo from frame %i with aspect ratio %d:%d", startFrame, logoAspectRatio.num, logoAspectRatio.den);
 
@@ -1214,9 +1536,8 @@ int cExtractLogo::SearchLogo(sMarkAdContext *maContext, int startFrame) {  // re
 
     cDecoder *ptr_cDecoder = new cDecoder(maContext->Config->threads, recordingIndexLogo);
     ALLOC(sizeof(*ptr_cDecoder), "ptr_cDecoder");
-
-    cMarkAdLogo *ptr_Logo = new cMarkAdLogo(maContext, recordingIndexLogo);
-    ALLOC(sizeof(*ptr_Logo), "SearchLogo-ptr_Logo");
+    ptr_cDecoder->EnablePipeline(false);  // decode next iFrame while corners are processed
+    ptr_cDecoder->SelectStreams(STREAMS_AUDIO_AC3);  // audio channels are checked
 
     cMarkAdBlackBordersHoriz *hborder = new cMarkAdBlackBordersHoriz(maContext);
     ALLOC(sizeof(*hborder), "hborder");
@@ -1224,14 +1545,10 @@ int cExtractLogo::SearchLogo(sMarkAdContext *maContext, int startFrame) {  // re
     cMarkAdBlackBordersVert *vborder = new cMarkAdBlackBordersVert(maContext);
     ALLOC(sizeof(*vborder), "vborder");
 
-    sAreaT *area = ptr_Logo->GetArea();
-
     if (!WaitForFrames(maContext, ptr_cDecoder)) {
         dsyslog("cExtractLogo::SearchLogo(): WaitForFrames() failed");
         FREE(sizeof(*ptr_cDecoder), "ptr_cDecoder");
         delete ptr_cDecoder;
-        FREE(sizeof(*ptr_Logo), "SearchLogo-ptr_Logo");
-        delete ptr_Logo;
         FREE(sizeof(*hborder), "hborder");
         delete hborder;
         FREE(sizeof(*vborder), "vborder");
@@ -1248,15 +1565,15 @@ int cExtractLogo::SearchLogo(sMarkAdContext *maContext, int startFrame) {  // re
     else dsyslog("cExtractLogo::SearchLogo(): already have %d frames from (%d) to frame (%d)", countFrame, firstFrame, lastFrame);
     iFrameCountValid = countFrame;
     if (lastFrame > startFrame) startFrame = lastFrame;
+    StartCornerThreads(maContext);
 
     while(retStatus && readNextFile && (ptr_cDecoder->DecodeDir(maContext->Config->recDir))) {
         maContext->Info.vPidType = ptr_cDecoder->GetVideoType();
         if (maContext->Info.vPidType == 0) {
             dsyslog("cExtractLogo::SearchLogo(): video type not set");
+            StopCornerThreads();
             FREE(sizeof(*ptr_cDecoder), "ptr_cDecoder");
             delete ptr_cDecoder;
-            FREE(sizeof(*ptr_Logo), "SearchLogo-ptr_Logo");
-            delete ptr_Logo;
             FREE(sizeof(*hborder), "hborder");
             delete hborder;
             FREE(sizeof(*vborder), "vborder");
@@ -1270,7 +1587,10 @@ int cExtractLogo::SearchLogo(sMarkAdContext *maContext, int startFrame) {  // re
         dsyslog("cExtractLogo::SearchLogo(): logo size %dx%d", logoWidth, logoHeight);
 
         while(ptr_cDecoder->GetNextPacket()) {
-            if (abortNow) return -1;
+            if (abortNow) {
+                StopCornerThreads();
+                return -1;
+            }
 
             // write an early start mark for running recordings
             if (maContext->Info.isRunningRecording && !maContext->Info.isStartMarkSaved && (iFrameNumber >= (maContext->Info.tStart * maContext->Video.Info.framesPerSecond))) {
@@ -1299,6 +1619,7 @@ int cExtractLogo::SearchLogo(sMarkAdContext *maContext, int startFrame) {  // re
                             dsyslog("cExtractLogo::SearchLogo(): seek to startFrame %d failed", startFrame);
                             retStatus = false;
                         }
+                        ptr_cDecoder->EnablePipeline(false);  // seek has disabled pipeline
                         continue;
                     }
                     iFrameCountAll++;
@@ -1352,46 +1673,7 @@ int cExtractLogo::SearchLogo(sMarkAdContext *maContext, int startFrame) {  // re
                         dsyslog("cExtractLogo::SearchLogo(): faild to get video data of frame (%d)", iFrameNumber);
                         continue;
                     }
-                    for (int corner = 0; corner < CORNERS; corner++) {
-                        int iFrameNumberNext = -1;  // flag for detect logo: -1: called by cExtractLogo, dont analyse, only fill area
-                                                    //                       -2: called by cExtractLogo, dont analyse, only fill area, store logos in /tmp for debug
-#if defined(DEBUG_LOGO_CORNER) && defined(DEBUG_LOGO_SAVE) && DEBUG_LOGO_SAVE == 0
-                        if (corner == DEBUG_LOGO_CORNER) iFrameNumberNext = -2;   // only for debuging, store logo file to /tmp
-#endif
-                        area->corner = corner;
-                        ptr_Logo->Detect(0, iFrameNumber, &iFrameNumberNext);  // we do not take care if we detect the logo, we only fill the area
-                        sLogoInfo actLogoInfo = {};
-                        actLogoInfo.iFrameNumber = iFrameNumber;
-
-                        // alloc memory and copy planes
-                        actLogoInfo.sobel = new uchar*[PLANES];
-                        for (int plane = 0; plane < PLANES; plane++) {
-                            actLogoInfo.sobel[plane] = new uchar[maxLogoPixel];
-                            memcpy(actLogoInfo.sobel[plane], area->sobel[plane], sizeof(uchar) * maxLogoPixel);
-                        }
-                        ALLOC(sizeof(uchar*) * PLANES * sizeof(uchar) * maxLogoPixel, "actLogoInfo.sobel");
-
-                        if (CheckValid(maContext, &actLogoInfo, logoHeight, logoWidth, corner)) {
-                            RemovePixelDefects(maContext, &actLogoInfo, logoHeight, logoWidth, corner);
-                            actLogoInfo.hits = Compare(maContext, &actLogoInfo, logoHeight, logoWidth, corner);
-
-                            try { logoInfoVector[corner].push_back(actLogoInfo); }  // this allocates a lot of memory
-                            catch(std::bad_alloc &e) {
-                                dsyslog("cExtractLogo::SearchLogo(): out of memory in pushback vector at frame %d", iFrameNumber);
-                                retStatus = false;
-                                break;
-                            }
-                            ALLOC((sizeof(sLogoInfo)), "logoInfoVector");
-                        }
-                        else {  // corner sobel transformed picture not valid
-                            // free memory of sobel planes
-                            for (int plane = 0; plane < PLANES; plane++) {
-                                delete actLogoInfo.sobel[plane];
-                            }
-                            delete actLogoInfo.sobel;
-                            FREE(sizeof(uchar*) * PLANES * sizeof(uchar) * maxLogoPixel, "actLogoInfo.sobel");
-                        }
-                    }
+                    if (!ProcessCorners(maContext, iFrameNumber, maxLogoPixel, logoHeight, logoWidth)) retStatus = false;
                     if (iFrameCountValid > 1000) {
                         int firstBorder = hborder->GetFirstBorderFrame();
                         if (firstBorder > 0) {
@@ -1417,6 +1699,9 @@ int cExtractLogo::SearchLogo(sMarkAdContext *maContext, int startFrame) {  // re
         }
     }
 
+    StopCornerThreads();
+    if (cornerOutOfMemory) retStatus = false;
+
     if (!retStatus && (iFrameCountAll < MAXREADFRAMES) && ((iFrameCountAll > MAXREADFRAMES / 2) || (iFrameCountValid > 390))) {  // reached end of recording before we got 1000 valid frames, changed from 700 to 390
         dsyslog("cExtractLogo::SearchLogo(): end of recording reached at frame (%d), read (%d) iFrames and got (%d) valid iFrames, try anyway", iFrameNumber, iFrameCountAll, iFrameCountValid);
         retStatus = true;
@@ -1431,16 +1716,23 @@ int cExtractLogo::SearchLogo(sMarkAdContext *maContext, int startFrame) {  // re
         dsyslog("cExtractLogo::SearchLogo(): %d valid frames of %d frames read, got enough iFrames at frame (%d), start analyze", iFrameCountValid, iFrameCountAll, ptr_cDecoder->GetFrameNumber());
         sLogoInfo actLogoInfo[CORNERS] = {};
         for (int corner = 0; corner < CORNERS; corner++) {
+            sLogoInfo *bestCornerLogo = NULL;
             for (std::vector<sLogoInfo>::iterator actLogo = logoInfoVector[corner].begin(); actLogo != logoInfoVector[corner].end(); ++actLogo) {
                 if (actLogo->hits > actLogoInfo[corner].hits) {
                     actLogoInfo[corner] = *actLogo;
+                    bestCornerLogo = &(*actLogo);
                 }
             }
+            if (bestCornerLogo) {  // restore sobel planes for resize and save
+                UnpackLogo(bestCornerLogo, GetMaxLogoPixel(maContext->Video.Info.width));
+                actLogoInfo[corner] = *bestCornerLogo;
+            }
 #if defined(__x86_64)
             dsyslog("cExtractLogo::SearchLogo(): best guess found at frame %6d with %3d similars out of %3ld valid frames at %s", actLogoInfo[corner].iFrameNumber, actLogoInfo[corner].hits, logoInfoVector[corner].size(), aCorner[corner]);
 #else
             dsyslog("cExtractLogo::SearchLogo(): best guess found at frame %6d with %3d similars out of %3d valid frames at %s", actLogoInfo[corner].iFrameNumber, actLogoInfo[corner].hits, logoInfoVector[corner].size(), aCorner[corner]);
 #endif
+            dsyslog("cExtractLogo::SearchLogo(): %d logo pairs checked, %d skipped by signature at %s", compareCount[corner], compareSkipped[corner], aCorner[corner]);
         }
 
         // find best and second best corner
@@ -1513,9 +1805,6 @@ int cExtractLogo::SearchLogo(sMarkAdContext *maContext, int startFrame) {  // re
             }
         }
     }
-    FREE(sizeof(*ptr_Logo), "SearchLogo-ptr_Logo");  // new cMarkAdLogo(maContext, recordingIndexLogo);
-    delete ptr_Logo;
-
     // restore maContext
     maContext->Video = maContextSaveState.Video;     // restore state of calling video context
     maContext->Audio = maContextSaveState.Audio;     // restore state of calling audio context
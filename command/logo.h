@@ -8,6 +8,7 @@
 #ifndef __logo_h_
 #define __logo_h_
 
+#include <pthread.h>
 #include "global.h"
 #include "markad-standalone.h"
 #include "decoder_new.h"
@@ -21,6 +22,8 @@
 #define BOTTOM_LEFT 2
 #define BOTTOM_RIGHT 3
 
+#define SIGNATURE_GRID 4  // logo signature counts black pixel in a SIGNATURE_GRID x SIGNATURE_GRID grid of each plane
+
 /**
  * logo after sobel transformation
  */
@@ -37,6 +40,21 @@ struct sLogoInfo {
     bool valid[PLANES] = {}; //!< <b>true:</b> data planes contain valid data <br>
                              //!< <b>false:</b> data planes are not valid
                              //!<
+
+    int signatureHeight = 0; //!< logo height of signature, 0 if there is no valid signature
+                             //!<
+
+    int signatureWidth = 0;  //!< logo width of signature
+                             //!<
+
+    int blackCells[PLANES][SIGNATURE_GRID * SIGNATURE_GRID] = {};  //!< count of black pixel in each grid cell of each plane
+                                                                   //!<
+
+    uint64_t *blackBits[PLANES] = {};  //!< black pixel of sobel planes, 1 bit per pixel, NULL if logo is not packed
+                                       //!<
+
+    int blackBitsCount[PLANES] = {};   //!< number of pixel in blackBits
+                                       //!<
 };
 
 
@@ -85,6 +103,40 @@ class cExtractLogo : public cLogoSize {
  */
         bool CompareLogoPair(const sLogoInfo *logo1, const sLogoInfo *logo2, const int logoHeight, const int logoWidth, const int corner, int match0 = 0, int match12 = 0, int *rate0 = NULL);
 
+/**
+ * calculate black pixel signature of a logo and pack black pixel into bit maps <br>
+ * signature is used to skip logo pairs who can not be similar, bit maps are used to compare logo pairs
+ * @param[in,out] logoInfo logo pixel map
+ * @param logoHeight       logo height
+ * @param logoWidth        logo width
+ * @return true if logo is black and white and packed, false otherwise
+ */
+        bool PackLogo(sLogoInfo *logoInfo, const int logoHeight, const int logoWidth);
+
+/**
+ * restore sobel planes of a logo from its bit maps if sobel planes were freed
+ * @param[in,out] logoInfo logo pixel map
+ * @param maxLogoPixel     size of each sobel plane
+ */
+        void UnpackLogo(sLogoInfo *logoInfo, const int maxLogoPixel);
+
+/**
+ * free sobel planes and bit maps of a logo
+ * @param[in,out] logoInfo logo pixel map
+ * @param maxLogoPixel     size of each sobel plane
+ */
+        void FreeLogoInfo(sLogoInfo *logoInfo, const int maxLogoPixel);
+
+/**
+ * check with black pixel signatures if CompareLogoPair() with default match rates can find the logo pair similar
+ * @param logo1      pixel map of logo 1
+ * @param logo2      pixel map of logo 2
+ * @param logoHeight logo height
+ * @param logoWidth  logo width
+ * @return false if logo pair is never similar, true if we have to compare the logo pair
+ */
+        bool SignatureMatchPossible(const sLogoInfo *logo1, const sLogoInfo *logo2, const int logoHeight, const int logoWidth);
+
 /**
  * request programm abort
  */
@@ -250,6 +302,63 @@ class cExtractLogo : public cLogoSize {
  */
         int AudioInBroadcast(const sMarkAdContext *maContext, const int iFrameNumber);
 
+/**
+ * worker thread to search logo in one corner
+ */
+        struct sCornerWorker {
+            cExtractLogo *extractLogo = NULL;  //!< logo extraction class of this worker
+                                               //!<
+            cMarkAdLogo *ptr_Logo = NULL;      //!< logo detection of this corner
+                                               //!<
+            int corner = -1;                   //!< logo corner of this worker
+                                               //!<
+            pthread_t thread;                  //!< worker thread
+                                               //!<
+            bool running = false;              //!< true if worker thread is running, false otherwise
+                                               //!<
+        };
+
+/**
+ * start one worker thread for each corner
+ * @param maContext markad context
+ */
+        void StartCornerThreads(sMarkAdContext *maContext);
+
+/**
+ * wait until all corner workers have processed the last started frame, then stop all corner worker threads
+ */
+        void StopCornerThreads();
+
+/**
+ * corner worker thread, process each new frame for its corner
+ * @param worker corner worker
+ */
+        static void *CornerThread(void *worker);
+
+/**
+ * copy current frame and start logo search of all corners <br>
+ * logo search of the previous frame has to be finished before
+ * @param maContext    markad context
+ * @param iFrameNumber frame number
+ * @param maxLogoPixel maximum logo pixel
+ * @param logoHeight   logo height
+ * @param logoWidth    logo width
+ * @return false if a corner worker could not store the logo of the previous frame, true otherwise
+ */
+        bool ProcessCorners(const sMarkAdContext *maContext, const int iFrameNumber, const int maxLogoPixel, const int logoHeight, const int logoWidth);
+
+/**
+ * search logo of one corner in copied frame and compare with all stored logos of this corner
+ * @param ptr_Logo logo detection of this corner
+ * @param corner   logo corner
+ */
+        void ProcessCorner(cMarkAdLogo *ptr_Logo, const int corner);
+
+/**
+ * wait until all corner workers have finished the current frame
+ */
+        void WaitForCorners();
+
         sMarkAdContext *maContextLogoSize = NULL;         //!< markad context
                                                           //!<
         cIndex *recordingIndexLogo = NULL;                //!< recording index
@@ -264,6 +373,40 @@ class cExtractLogo : public cLogoSize {
                                                           //!<
         int iFrameCountValid = 0;                         //!< number of valid i-frames
                                                           //!<
+        sCornerWorker cornerWorker[CORNERS];              //!< corner worker threads
+                                                          //!<
+        pthread_mutex_t cornerMutex = PTHREAD_MUTEX_INITIALIZER;  //!< mutex for corner worker state
+                                                                  //!<
+        pthread_cond_t cornerCondStart = PTHREAD_COND_INITIALIZER; //!< signal new frame to corner workers
+                                                                   //!<
+        pthread_cond_t cornerCondDone = PTHREAD_COND_INITIALIZER;  //!< signal all corner workers finished current frame
+                                                                   //!<
+        int cornerGeneration = 0;                         //!< counter of frames started for corner workers
+                                                          //!<
+        int cornerBusy = 0;                               //!< number of corner workers processing current frame
+                                                          //!<
+        bool cornerStop = false;                          //!< true if corner workers should stop
+                                                          //!<
+        bool cornerOutOfMemory = false;                   //!< true if a corner worker could not store a logo
+                                                          //!<
+        sMarkAdContext cornerContext = {};                //!< markad context with copied frame data for corner workers
+                                                          //!<
+        uchar *cornerPlane[PLANES] = {};                  //!< copied frame planes for corner workers
+                                                          //!<
+        int cornerPlaneSize[PLANES] = {};                 //!< allocated size of copied frame planes
+                                                          //!<
+        int cornerIFrameNumber = -1;                      //!< frame number of copied frame
+                                                          //!<
+        int cornerMaxLogoPixel = 0;                       //!< maximum logo pixel of copied frame
+                                                          //!<
+        int cornerLogoHeight = 0;                         //!< logo height of copied frame
+                                                          //!<
+        int cornerLogoWidth = 0;                          //!< logo width of copied frame
+                                                          //!<
+        int compareCount[CORNERS] = {};                   //!< number of logo pairs checked in Compare()
+                                                          //!<
+        int compareSkipped[CORNERS] = {};                 //!< number of logo pairs skipped by signature in Compare()
+                                                          //!<
         const char *aCorner[CORNERS] = { "TOP_LEFT", "TOP_RIGHT", "BOTTOM_LEFT", "BOTTOM_RIGHT" }; //!< array to transform enum corner to text
                                                                                                    //!<
 
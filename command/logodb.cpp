@@ -0,0 +1,365 @@
+/*
+ * logodb.cpp: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <vector>
+#include <algorithm>
+
+#include "logodb.h"
+extern "C" {
+    #include "debug.h"
+}
+
+
+/**
+ * logo read from PGM files, used to create the logo database
+ */
+struct sLogoDBImport {
+    sLogoDBEntry entry = {};                          //!< index entry of the logo
+                                                      //!<
+    unsigned char *mask[LOGODB_PLANES] = {NULL};      //!< mask of each plane as stored in the logo database
+                                                      //!<
+};
+
+
+cLogoDB::cLogoDB() {
+}
+
+
+cLogoDB::~cLogoDB() {
+    Close();
+}
+
+
+bool cLogoDB::Open(const char *directoryParam) {
+    if (!directoryParam) return false;
+    if (directory && (strcmp(directory, directoryParam) == 0) && !Changed()) return (map != NULL);  // already tried this directory
+    Close();
+    directory = strdup(directoryParam);
+    ALLOC(strlen(directory)+1, "directory");
+
+    char *path = NULL;
+    if (asprintf(&path, "%s/%s", directory, LOGODB_FILENAME) == -1) return false;
+    ALLOC(strlen(path)+1, "path");
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    FREE(strlen(path)+1, "path");
+    free(path);
+    if (fd < 0) return false;
+    struct stat statbuf;
+    if (fstat(fd, &statbuf) == 0) {
+        fileInode = statbuf.st_ino;
+        fileTime  = statbuf.st_mtime;
+    }
+    else statbuf.st_size = 0;
+    if (statbuf.st_size >= static_cast<off_t>(sizeof(sLogoDBHeader))) {
+        void *mapped = mmap(NULL, statbuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            map = mapped;
+            mapSize = statbuf.st_size;
+        }
+    }
+    close(fd);
+    if (!map) return false;
+
+    header = static_cast<const sLogoDBHeader *>(map);
+    if ((memcmp(header->magic, LOGODB_MAGIC, sizeof(header->magic)) != 0) || (header->version != LOGODB_VERSION) ||
+        (sizeof(sLogoDBHeader) + static_cast<size_t>(header->count) * sizeof(sLogoDBEntry) > mapSize)) {
+        esyslog("logo database %s/%s is not valid, use PGM files", directory, LOGODB_FILENAME);
+        munmap(map, mapSize);
+        map = NULL;
+        mapSize = 0;
+        header = NULL;
+        return false;
+    }
+    entries = reinterpret_cast<const sLogoDBEntry *>(static_cast<const char *>(map) + sizeof(sLogoDBHeader));
+    dsyslog("cLogoDB::Open(): logo database %s/%s with %u logos mapped", directory, LOGODB_FILENAME, header->count);
+    return true;
+}
+
+
+// the logo database is replaced by rename(), so a new database has a new inode
+//
+bool cLogoDB::Changed() {
+    if (!directory) return false;
+    char *path = NULL;
+    if (asprintf(&path, "%s/%s", directory, LOGODB_FILENAME) == -1) return false;
+    ALLOC(strlen(path)+1, "path");
+    struct stat statbuf;
+    bool exists = (stat(path, &statbuf) == 0);
+    FREE(strlen(path)+1, "path");
+    free(path);
+    if (!exists) return (fileInode != 0);
+    if ((statbuf.st_ino == fileInode) && (statbuf.st_mtime == fileTime)) return false;
+    dsyslog("cLogoDB::Changed(): logo database %s/%s has changed, map it again", directory, LOGODB_FILENAME);
+    return true;
+}
+
+
+void cLogoDB::Close() {
+    if (map) munmap(map, mapSize);
+    fileInode = 0;
+    fileTime = 0;
+    map = NULL;
+    mapSize = 0;
+    header = NULL;
+    entries = NULL;
+    if (directory) {
+        FREE(strlen(directory)+1, "directory");
+        free(directory);
+        directory = NULL;
+    }
+}
+
+
+const sLogoDBEntry *cLogoDB::Find(const char *name) {
+    if (!map || !name) return NULL;
+    int first = 0;
+    int last = header->count - 1;
+    while (first <= last) {
+        int middle = (first + last) / 2;
+        int compare = strncmp(entries[middle].name, name, LOGODB_NAME_SIZE);
+        if (compare == 0) return &entries[middle];
+        if (compare < 0) first = middle + 1;
+        else last = middle - 1;
+    }
+    return NULL;
+}
+
+
+// all logo names with the channel name as prefix follow the first name >= channel name
+//
+bool cLogoDB::HasChannel(const char *channel) {
+    if (!map || !channel) return false;
+    int len = strlen(channel);
+    int first = 0;
+    int last = header->count;
+    while (first < last) {
+        int middle = (first + last) / 2;
+        if (strncmp(entries[middle].name, channel, LOGODB_NAME_SIZE) < 0) first = middle + 1;
+        else last = middle;
+    }
+    return (first < static_cast<int>(header->count)) && (strncmp(entries[first].name, channel, len) == 0);
+}
+
+
+bool cLogoDB::GetMask(const sLogoDBEntry *entry, const int plane, unsigned char *mask, const int maxSize) {
+    if (!map || !entry || !mask) return false;
+    if ((plane < 0) || (plane >= LOGODB_PLANES)) return false;
+    const sLogoDBPlane *dbPlane = &entry->plane[plane];
+    int pixelCount = dbPlane->width * dbPlane->height;
+    if ((dbPlane->offset == 0) || (pixelCount <= 0) || (pixelCount > maxSize)) return false;
+    if (static_cast<size_t>(dbPlane->offset) + dbPlane->size > mapSize) return false;
+    const unsigned char *data = static_cast<const unsigned char *>(map) + dbPlane->offset;
+    if (dbPlane->packed) {
+        if (dbPlane->size < static_cast<uint32_t>((pixelCount + 7) / 8)) return false;
+        for (int i = 0; i < pixelCount; i++) mask[i] = (data[i / 8] & (1 << (i % 8))) ? 255 : 0;
+    }
+    else {
+        if (dbPlane->size < static_cast<uint32_t>(pixelCount)) return false;
+        memcpy(mask, data, pixelCount);
+    }
+    return true;
+}
+
+
+static bool CompareLogoName(const sLogoDBImport &logo1, const sLogoDBImport &logo2) {
+    return strncmp(logo1.entry.name, logo2.entry.name, LOGODB_NAME_SIZE) < 0;
+}
+
+
+// read one plane in the same format as cMarkAdLogo::Load()
+//
+static bool ReadLogoPlane(const char *path, sLogoDBImport *logo, const int plane) {
+    FILE *pFile = fopen(path, "rb");
+    if (!pFile) return false;
+    int width = 0;
+    int height = 0;
+    int corner = 0;
+    int pixel = 0;
+    char c = 0;
+    if (fscanf(pFile, "P5\n#%1c%1i %4i\n%3d %3d\n255\n#", &c, &corner, &pixel, &width, &height) != 5) {
+        fclose(pFile);
+        return false;
+    }
+    if (height == 255) {
+        height = width;
+        width = pixel;
+        pixel = 0;
+    }
+    if ((width <= 0) || (height <= 0) || (width * height > 0xFFFFFF)) {
+        fclose(pFile);
+        return false;
+    }
+    int pixelCount = width * height;
+    unsigned char *data = new unsigned char[pixelCount];
+    ALLOC(sizeof(unsigned char) * pixelCount, "data");
+    if (fread(data, 1, pixelCount, pFile) != static_cast<size_t>(pixelCount)) {
+        FREE(sizeof(unsigned char) * pixelCount, "data");
+        delete[] data;
+        fclose(pFile);
+        return false;
+    }
+    fclose(pFile);
+
+    // masks from logo extraction have only black and white pixel, store them with 1 bit per pixel
+    bool packed = true;
+    for (int i = 0; i < pixelCount; i++) {
+        if ((data[i] != 0) && (data[i] != 255)) {
+            packed = false;
+            break;
+        }
+    }
+    sLogoDBPlane *dbPlane = &logo->entry.plane[plane];
+    dbPlane->width = width;
+    dbPlane->height = height;
+    dbPlane->pixel = pixel;
+    dbPlane->packed = packed;
+    if (packed) {
+        dbPlane->size = (pixelCount + 7) / 8;
+        logo->mask[plane] = new unsigned char[dbPlane->size];
+        ALLOC(sizeof(unsigned char) * dbPlane->size, "logo->mask");
+        memset(logo->mask[plane], 0, dbPlane->size);
+        for (int i = 0; i < pixelCount; i++) {
+            if (data[i]) logo->mask[plane][i / 8] |= 1 << (i % 8);
+        }
+        FREE(sizeof(unsigned char) * pixelCount, "data");
+        delete[] data;
+    }
+    else {
+        dbPlane->size = pixelCount;
+        logo->mask[plane] = data;  // take over memory
+        FREE(sizeof(unsigned char) * pixelCount, "data");
+        ALLOC(sizeof(unsigned char) * dbPlane->size, "logo->mask");
+    }
+    if ((plane == 0) || (logo->entry.corner < 0)) {
+        logo->entry.corner = corner;
+        logo->entry.flags = (c == 'D') ? LOGODB_FLAG_DOLBY : 0;
+    }
+    return true;
+}
+
+
+int cLogoDB::Create(const char *directory) {
+    if (!directory) return -1;
+    DIR *dir = opendir(directory);
+    if (!dir) {
+        esyslog("could not open logo directory %s", directory);
+        return -1;
+    }
+
+    // read all PGM files <channel>-A<num>_<den>-P<plane>.pgm
+    std::vector<sLogoDBImport> logos;
+    int files = 0;
+    struct dirent *dirent = NULL;
+    while ((dirent = readdir(dir))) {
+        int len = strlen(dirent->d_name);
+        if ((len < 8) || (strcmp(dirent->d_name + len - 4, ".pgm") != 0)) continue;
+        if ((strncmp(dirent->d_name + len - 7, "-P", 2) != 0) || (dirent->d_name[len - 5] < '0') || (dirent->d_name[len - 5] >= '0' + LOGODB_PLANES)) continue;
+        int plane = dirent->d_name[len - 5] - '0';
+        int nameLen = len - 7;
+        if (nameLen >= LOGODB_NAME_SIZE) {
+            esyslog("logo name too long, ignore %s", dirent->d_name);
+            continue;
+        }
+        std::vector<sLogoDBImport>::iterator logo = logos.begin();
+        for (; logo != logos.end(); ++logo) {
+            if ((strncmp(logo->entry.name, dirent->d_name, nameLen) == 0) && (logo->entry.name[nameLen] == 0)) break;
+        }
+        if (logo == logos.end()) {
+            sLogoDBImport newLogo;
+            strncpy(newLogo.entry.name, dirent->d_name, nameLen);
+            newLogo.entry.name[nameLen] = 0;
+            newLogo.entry.corner = -1;
+            logos.push_back(newLogo);
+            logo = logos.end() - 1;
+        }
+        char *path = NULL;
+        if (asprintf(&path, "%s/%s", directory, dirent->d_name) == -1) continue;
+        ALLOC(strlen(path)+1, "path");
+        if (ReadLogoPlane(path, &(*logo), plane)) files++;
+        else esyslog("format error in %s", path);
+        FREE(strlen(path)+1, "path");
+        free(path);
+    }
+    closedir(dir);
+    std::sort(logos.begin(), logos.end(), CompareLogoName);
+
+    // calculate position of the masks behind the index
+    uint32_t offset = sizeof(sLogoDBHeader) + logos.size() * sizeof(sLogoDBEntry);
+    for (std::vector<sLogoDBImport>::iterator logo = logos.begin(); logo != logos.end(); ++logo) {
+        for (int plane = 0; plane < LOGODB_PLANES; plane++) {
+            if (!logo->mask[plane]) continue;
+            logo->entry.plane[plane].offset = offset;
+            offset += logo->entry.plane[plane].size;
+        }
+    }
+
+    // write to temporary file and replace logo database at once, running markad processes keep their mapping
+    char *tmpFile = NULL;
+    char *dbFile = NULL;
+    int count = -1;
+    if (asprintf(&tmpFile, "%s/%s.tmp", directory, LOGODB_FILENAME) == -1) tmpFile = NULL;
+    else {
+        ALLOC(strlen(tmpFile)+1, "tmpFile");
+    }
+    if (asprintf(&dbFile, "%s/%s", directory, LOGODB_FILENAME) == -1) dbFile = NULL;
+    else {
+        ALLOC(strlen(dbFile)+1, "dbFile");
+    }
+    if (tmpFile && dbFile) {
+        FILE *outFile = fopen(tmpFile, "wb");
+        if (outFile) {
+            sLogoDBHeader header = {};
+            memcpy(header.magic, LOGODB_MAGIC, sizeof(header.magic));
+            header.version = LOGODB_VERSION;
+            header.count = logos.size();
+            bool success = (fwrite(&header, sizeof(header), 1, outFile) == 1);
+            for (std::vector<sLogoDBImport>::iterator logo = logos.begin(); success && (logo != logos.end()); ++logo) {
+                success = (fwrite(&logo->entry, sizeof(logo->entry), 1, outFile) == 1);
+            }
+            for (std::vector<sLogoDBImport>::iterator logo = logos.begin(); success && (logo != logos.end()); ++logo) {
+                for (int plane = 0; success && (plane < LOGODB_PLANES); plane++) {
+                    if (logo->mask[plane]) success = (fwrite(logo->mask[plane], 1, logo->entry.plane[plane].size, outFile) == logo->entry.plane[plane].size);
+                }
+            }
+            if (fclose(outFile) != 0) success = false;
+            if (success && (rename(tmpFile, dbFile) == 0)) {
+                count = logos.size();
+                isyslog("logo database %s with %d logos from %d PGM files created", dbFile, count, files);
+            }
+            else {
+                esyslog("could not write logo database %s", dbFile);
+                unlink(tmpFile);
+            }
+        }
+        else esyslog("could not create %s", tmpFile);
+    }
+    if (tmpFile) {
+        FREE(strlen(tmpFile)+1, "tmpFile");
+        free(tmpFile);
+    }
+    if (dbFile) {
+        FREE(strlen(dbFile)+1, "dbFile");
+        free(dbFile);
+    }
+
+    for (std::vector<sLogoDBImport>::iterator logo = logos.begin(); logo != logos.end(); ++logo) {
+        for (int plane = 0; plane < LOGODB_PLANES; plane++) {
+            if (!logo->mask[plane]) continue;
+            FREE(sizeof(unsigned char) * logo->entry.plane[plane].size, "logo->mask");
+            delete[] logo->mask[plane];
+        }
+    }
+    return count;
+}
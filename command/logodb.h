@@ -0,0 +1,187 @@
+/*
+ * logodb.h: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#ifndef __logodb_h_
+#define __logodb_h_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include <sys/types.h>
+
+#define LOGODB_FILENAME "markad.logodb"  //!< name of the logo database in the logo cache directory
+                                         //!<
+#define LOGODB_MAGIC "MARKADLG"          //!< first 8 bytes of the logo database
+                                         //!<
+#define LOGODB_VERSION 1                 //!< format version of the logo database
+                                         //!<
+#define LOGODB_NAME_SIZE 128             //!< maximum size of logo name <channel>-A<num>_<den> incl. terminating 0
+                                         //!<
+#define LOGODB_PLANES 3                  //!< number of planes stored for each logo, same as PLANES
+                                         //!<
+#define LOGODB_FLAG_DOLBY 0x01           //!< logo file has 'D' flag, ignore dolby detection for this channel
+                                         //!<
+
+
+/**
+ * header of the logo database
+ */
+struct sLogoDBHeader {
+    char magic[8];     //!< #LOGODB_MAGIC
+                       //!<
+    uint32_t version;  //!< #LOGODB_VERSION
+                       //!<
+    uint32_t count;    //!< number of logos, the index follows the header
+                       //!<
+};
+
+
+/**
+ * one plane of a logo in the logo database
+ */
+struct sLogoDBPlane {
+    int32_t width;     //!< width of the logo plane
+                       //!<
+    int32_t height;    //!< height of the logo plane
+                       //!<
+    int32_t pixel;     //!< number of logo pixel from PGM header, 0 if it has to be counted from the mask
+                       //!<
+    uint32_t offset;   //!< byte position of the mask from start of the database, 0 if plane is not stored
+                       //!<
+    uint32_t size;     //!< size of the mask in the database
+                       //!<
+    uint32_t packed;   //!< 1 if mask is packed to 1 bit per pixel (bit set = 255), 0 if mask is stored with 1 byte per pixel
+                       //!<
+};
+
+
+/**
+ * index entry of a logo in the logo database, entries are sorted by name
+ */
+struct sLogoDBEntry {
+    char name[LOGODB_NAME_SIZE];         //!< logo name <channel>-A<num>_<den>
+                                         //!<
+    int32_t corner;                      //!< logo corner
+                                         //!<
+    int32_t flags;                       //!< #LOGODB_FLAG_DOLBY
+                                         //!<
+    sLogoDBPlane plane[LOGODB_PLANES];   //!< logo planes
+                                         //!<
+};
+
+
+/**
+ * read only access to the logo database, the file is mapped into memory <br>
+ * the logo database replaces the <channel>-A<num>_<den>-P<plane>.pgm files of the logo cache directory,
+ * create it with "markad --logocachedir=<directory> logodb"
+ */
+class cLogoDB {
+    public:
+        cLogoDB();
+        ~cLogoDB();
+
+/**
+ * copy constructor, not used, only for formal reason
+ */
+        cLogoDB(const cLogoDB &origin) {
+            directory = NULL;
+            fileInode = 0;
+            fileTime = origin.fileTime;
+            map = NULL;
+            mapSize = 0;
+            header = NULL;
+            entries = NULL;
+        };
+
+/**
+ * operator=, not used, only for formal reason
+ */
+        cLogoDB &operator =(const cLogoDB *origin) {
+            directory = NULL;
+            fileInode = 0;
+            fileTime = origin->fileTime;
+            map = NULL;
+            mapSize = 0;
+            header = NULL;
+            entries = NULL;
+            return *this;
+        }
+
+/**
+ * map logo database of a directory into memory, do nothing if this directory is already open and the database is unchanged
+ * @param directoryParam directory with the logo database
+ * @return true if directory has a valid logo database, false otherwise
+ */
+        bool Open(const char *directoryParam);
+
+/**
+ * get directory of the logo database
+ * @return directory given to Open(), NULL if not open
+ */
+        const char *GetDirectory() {
+            return directory;
+        }
+
+/**
+ * unmap logo database
+ */
+        void Close();
+
+/**
+ * find a logo
+ * @param name logo name <channel>-A<num>_<den>
+ * @return index entry of the logo, NULL if not found
+ */
+        const sLogoDBEntry *Find(const char *name);
+
+/**
+ * check if there is any logo of a channel
+ * @param channel channel name
+ * @return true if a logo name starts with the channel name, false otherwise
+ */
+        bool HasChannel(const char *channel);
+
+/**
+ * unpack logo mask of one plane
+ * @param[in]  entry   index entry of the logo
+ * @param[in]  plane   plane number
+ * @param[out] mask    buffer for the mask, each pixel is 0 or 255
+ * @param[in]  maxSize size of mask buffer
+ * @return true if successful, false otherwise
+ */
+        bool GetMask(const sLogoDBEntry *entry, const int plane, unsigned char *mask, const int maxSize);
+
+/**
+ * create logo database from all PGM logo files of a directory
+ * @param directory logo cache directory
+ * @return number of logos stored, -1 on error
+ */
+        static int Create(const char *directory);
+
+    private:
+/**
+ * check if the logo database file of the open directory was created, replaced or removed since it was mapped
+ * @return true if changed, false otherwise
+ */
+        bool Changed();
+
+        char *directory = NULL;                //!< directory of the mapped logo database
+                                               //!<
+        ino_t fileInode = 0;                   //!< inode of the logo database file, 0 if there was no file
+                                               //!<
+        time_t fileTime = 0;                   //!< modification time of the logo database file
+                                               //!<
+        void *map = NULL;                      //!< mapped logo database, NULL if not found or not valid
+                                               //!<
+        size_t mapSize = 0;                    //!< size of the mapped logo database
+                                               //!<
+        const sLogoDBHeader *header = NULL;    //!< header of the logo database
+                                               //!<
+        const sLogoDBEntry *entries = NULL;    //!< sorted index of the logo database
+                                               //!<
+};
+#endif
@@ -35,6 +35,9 @@
 #include "version.h"
 #include "logo.h"
 #include "index.h"
+#include "perf.h"
+#include "remux.h"
+#include "logodb.h"
 
 bool SYSLOG = false;
 bool LOG2REC = false;
@@ -320,6 +323,7 @@ void cMarkAdStandalone::CalculateCheckPositions(int startframe) {
 
 
 void cMarkAdStandalone::CheckStop() {
+    cPerfTimer perfTimer(PERF_MARKS);
     LogSeparator(true);
     LogSeparator();
     dsyslog("cMarkAdStandalone::CheckStop(): start check stop (%i)", frameCurrent);
@@ -689,6 +693,7 @@ void cMarkAdStandalone::RemoveLogoChangeMarks() {  // for performance reason onl
     // alloc new objects
     ptr_cDecoderLogoChange = new cDecoder(macontext.Config->threads, recordingIndexMark);
     ALLOC(sizeof(*ptr_cDecoderLogoChange), "ptr_cDecoderLogoChange");
+    ptr_cDecoderLogoChange->SelectStreams(STREAMS_VIDEO);
     ptr_cDecoderLogoChange->DecodeDir(directory);
 
     cExtractLogo *ptr_cExtractLogoChange = new cExtractLogo(&macontext, macontext.Video.Info.AspectRatio, recordingIndexMark);
@@ -770,6 +775,7 @@ void cMarkAdStandalone::RemoveLogoChangeMarks() {  // for performance reason onl
 
 
 void cMarkAdStandalone::CheckStart() {
+    cPerfTimer perfTimer(PERF_MARKS);
     LogSeparator(true);
     dsyslog("cMarkAdStandalone::CheckStart(): checking start at frame (%d) check start planed at (%d)", frameCurrent, chkSTART);
     dsyslog("cMarkAdStandalone::CheckStart(): assumed start frame %i", iStartA);
@@ -1460,6 +1466,7 @@ void cMarkAdStandalone::DebugMarks() {           // write all marks to log file
 
 
 void cMarkAdStandalone::CheckMarks() {           // cleanup marks that make no sense
+    cPerfTimer perfTimer(PERF_MARKS);
     LogSeparator(true);
     cMark *mark = NULL;
 
@@ -2217,8 +2224,8 @@ void cMarkAdStandalone::CheckIndexGrowing()
 {
     // Here we check if the index is more
     // advanced than our framecounter.
-    // If not we wait. If we wait too much,
-    // we discard this check...
+    // If not we wait for new data. If we got
+    // no new data two times, we discard this check...
 
 #define WAITTIME 15
 
@@ -2266,31 +2273,25 @@ void cMarkAdStandalone::CheckIndexGrowing()
                     return;
                 }
             }
-            unsigned int sleeptime = WAITTIME;
-            time_t sleepstart = time(NULL);
-            double slepttime = 0;
-            while ((unsigned int)slepttime < sleeptime) {
-                while (sleeptime > 0) {
-                    macontext.Info.isRunningRecording = true;
-                    unsigned int ret = sleep(sleeptime); // now we sleep and hopefully the index will grow
-                    if ((errno) && (ret)) {
-                        if (abortNow) return;
-                        esyslog("got errno %i while waiting for new data", errno);
-                        if (errno != EINTR) return;
-                    }
-                    sleeptime = ret;
-                }
-                slepttime = difftime(time(NULL), sleepstart);
-                if (slepttime < WAITTIME) {
-                    esyslog("what's wrong with your system? we just slept %.0fs", slepttime);
+            if (!recordingWaiter) {
+                recordingWaiter = new cRecordingWaiter(directory);
+                ALLOC(sizeof(*recordingWaiter), "recordingWaiter");
+            }
+            macontext.Info.isRunningRecording = true;
+            struct timeval waitStart, waitEnd;
+            gettimeofday(&waitStart, NULL);
+            bool newData = recordingWaiter->Wait(WAITTIME * 1000);  // wakes up as soon as VDR writes new data
+            gettimeofday(&waitEnd, NULL);
+            if (abortNow) return;
+            waittime_ms += (waitEnd.tv_sec - waitStart.tv_sec) * 1000 + (waitEnd.tv_usec - waitStart.tv_usec) / 1000;
+            if (newData) sleepcnt = 0;  // recording is growing, check again
+            else {
+                sleepcnt++;
+                if (sleepcnt >= 2) {
+                    esyslog("no new data after %is, skipping wait!", waittime_ms / 1000);
+                    notenough = false; // something went wrong?
                 }
             }
-            waittime += static_cast<int> (slepttime);
-            sleepcnt++;
-            if (sleepcnt >= 2) {
-                esyslog("no new data after %is, skipping wait!", waittime);
-                notenough = false; // something went wrong?
-            }
         }
         else {
             if (iwaittime) {
@@ -2544,6 +2545,285 @@ void cMarkAdStandalone::DebugMarkFrames() {
 #endif
 
 
+// copy ts packets from the i-frame after each start mark up to the last i-frame at or before each stop mark
+// a part can end up to one GOP before the stop mark, but it never contains a picture of the following ad
+// timestamps of each part are moved to the end of the part before by the time of the cut out ad
+//
+bool cMarkAdStandalone::MarkadCutRemux() {
+    if (!recordingIndexMark) return false;
+    int lastFileNumber = 0;
+    int lastFrameNumber = 0;
+    int lastTime_ms = 0;
+    int64_t lastPos = -1;
+    if (!recordingIndexMark->GetElement(recordingIndexMark->Count() - 1, &lastFileNumber, &lastFrameNumber, &lastTime_ms, &lastPos)) return false;
+
+    cRemux *ptr_cRemux = new cRemux(directory);
+    ALLOC(sizeof(*ptr_cRemux), "ptr_cRemux");
+    bool success = ptr_cRemux->OpenFile();
+    int64_t ptsOffset = 0;
+    int stopTimeBefore_ms = -1;
+    cMark *startMark = marks.GetFirst();
+    while (success && startMark && startMark->Next() && !abortNow) {
+        cMark *stopMark = startMark->Next();
+        if (((startMark->type & 0x0F) != MT_START) || ((stopMark->type & 0x0F) != MT_STOP)) {
+            esyslog("got invalid mark pair (%d) type 0x%X and (%d) type 0x%X", startMark->position, startMark->type, stopMark->position, stopMark->type);
+            success = false;
+            break;
+        }
+        int startFileNumber = 0;
+        int64_t startPos = -1;
+        int startTime_ms = 0;
+        int startPosition = recordingIndexMark->GetIFrameAfter(startMark->position);  // go after mark position to prevent last picture of ad
+        if ((startPosition < 0) || !recordingIndexMark->GetIFramePosition(startPosition, &startFileNumber, &startPos, &startTime_ms)) {
+            dsyslog("cMarkAdStandalone::MarkadCutRemux(): no byte position for start mark (%d)", startMark->position);
+            success = false;
+            break;
+        }
+        int stopFileNumber = 0;
+        int64_t stopPos = -1;
+        int stopTime_ms = 0;
+        int stopPosition = recordingIndexMark->GetIFrameBefore(stopMark->position + 1);  // part ends before this i-frame
+        if (stopPosition < 0) stopPosition = lastFrameNumber;                             // stop mark after last i-frame
+        if (stopPosition <= startPosition) {
+            dsyslog("cMarkAdStandalone::MarkadCutRemux(): no i-frame between start mark (%d) and stop mark (%d), skip part", startMark->position, stopMark->position);
+            framecnt4 = stopMark->position;
+            startMark = stopMark->Next();
+            continue;
+        }
+        if (!recordingIndexMark->GetIFramePosition(stopPosition, &stopFileNumber, &stopPos, &stopTime_ms)) {
+            dsyslog("cMarkAdStandalone::MarkadCutRemux(): no byte position for stop mark (%d)", stopMark->position);
+            success = false;
+            break;
+        }
+        if (stopTimeBefore_ms >= 0) ptsOffset += static_cast<int64_t>(startTime_ms - stopTimeBefore_ms) * 90;  // 90kHz clock
+        dsyslog("cMarkAdStandalone::MarkadCutRemux(): copy frame (%6d) file %d position %10" PRId64 " to frame (%6d) file %d position %10" PRId64 ", timestamp offset %" PRId64, startPosition, startFileNumber, startPos, stopPosition, stopFileNumber, stopPos, ptsOffset);
+        success = ptr_cRemux->CopyPart(startFileNumber, startPos, stopFileNumber, stopPos, ptsOffset);
+        stopTimeBefore_ms = stopTime_ms;
+        framecnt4 = stopMark->position;
+        startMark = stopMark->Next();
+    }
+    if (!ptr_cRemux->CloseFile()) success = false;
+    FREE(sizeof(*ptr_cRemux), "ptr_cRemux");
+    delete ptr_cRemux;
+    return success && !abortNow;
+}
+
+
+/**
+ * segment of a full encoded cut, encoded by a child process
+ */
+struct sCutSegment {
+    int startPosition = 0;      //!< i-frame before start mark to preload decoder
+                                //!<
+    int startMarkPosition = 0;  //!< frame position of the start mark
+                                //!<
+    int stopMarkPosition = 0;   //!< frame position of the stop mark
+                                //!<
+    pid_t pid = 0;              //!< process id of the child process, 0 if not started or finished
+                                //!<
+};
+
+
+bool cMarkAdStandalone::MarkadCutSegment(const int segment, const int startPosition, const int startMarkPosition, const int stopMarkPosition) {
+    dsyslog("cMarkAdStandalone::MarkadCutSegment(): segment %d: encode from start mark (%d) to stop mark (%d)", segment, startMarkPosition, stopMarkPosition);
+    cDecoder *ptr_cDecoderSegment = new cDecoder(macontext.Config->threads, recordingIndexMark);
+    ALLOC(sizeof(*ptr_cDecoderSegment), "ptr_cDecoderSegment");
+    cEncoder *ptr_cEncoderSegment = new cEncoder(&macontext, segment);
+    ALLOC(sizeof(*ptr_cEncoderSegment), "ptr_cEncoderSegment");
+
+    bool success = true;
+    for (int pass = 1; success && (pass <= 2); pass++) {  // statistic of pass 1 is stored in the encoder of this segment
+        ptr_cDecoderSegment->OpenDir(directory);
+        ptr_cEncoderSegment->Reset(pass);
+        ptr_cDecoderSegment->SeekToFrame(&macontext, startPosition);  // seek to start posiition to get correct input video parameter
+        if (!ptr_cEncoderSegment->OpenFile(directory, ptr_cDecoderSegment)) {
+            esyslog("failed to open output file of segment %d", segment);
+            success = false;
+            break;
+        }
+        bool stopReached = false;
+        do {  // input is open and positioned by SeekToFrame(), DecodeDir() only continues after end of input
+            while (ptr_cDecoderSegment->GetNextPacket()) {
+                int frameNumber = ptr_cDecoderSegment->GetFrameNumber();
+                if (frameNumber < startPosition) {  // go to start frame
+                    ptr_cDecoderSegment->SeekToFrame(&macontext, startPosition);
+                    frameNumber = ptr_cDecoderSegment->GetFrameNumber();
+                }
+                if ((frameNumber > stopMarkPosition) || abortNow) {
+                    stopReached = true;
+                    break;
+                }
+                AVPacket *pkt = ptr_cDecoderSegment->GetPacket();
+                if (!pkt) {
+                    esyslog("failed to get packet from input stream");
+                    success = false;
+                    stopReached = true;
+                    break;
+                }
+                if (frameNumber < startMarkPosition) {  // preload decoder pipe
+                    ptr_cDecoderSegment->DecodePacket(pkt);
+                    continue;
+                }
+                if (!ptr_cEncoderSegment->WritePacket(pkt, ptr_cDecoderSegment)) {
+                    dsyslog("cMarkAdStandalone::MarkadCutSegment(): failed to write frame %d to output stream", frameNumber);  // no not abort, maybe next frame works
+                }
+            }
+        } while (!stopReached && ptr_cDecoderSegment->DecodeDir(directory));
+        if (!ptr_cEncoderSegment->CloseFile(ptr_cDecoderSegment)) {
+            dsyslog("cMarkAdStandalone::MarkadCutSegment(): failed to close output file of segment %d", segment);
+            success = false;
+        }
+    }
+    FREE(sizeof(*ptr_cEncoderSegment), "ptr_cEncoderSegment");
+    delete ptr_cEncoderSegment;
+    FREE(sizeof(*ptr_cDecoderSegment), "ptr_cDecoderSegment");
+    delete ptr_cDecoderSegment;
+    return success && !abortNow;
+}
+
+
+// share the thread budget of --threads between parallel jobs
+// --threads not set (auto): budget is the number of online CPUs
+// return: threads per job, 1 to 16
+//
+static int ThreadsPerJob(const int threads, const int jobs) {
+    int budget = threads;
+    if (budget <= 0) budget = sysconf(_SC_NPROCESSORS_ONLN);
+    int threadsPerJob = (jobs > 1) ? budget / jobs : budget;
+    if (threadsPerJob < 1) threadsPerJob = 1;
+    if (threadsPerJob > 16) threadsPerJob = 16;
+    return threadsPerJob;
+}
+
+
+// each child process has its own decoder, encoder and copy of the recording index,
+// timestamps of each segment are moved to the end of the segment before by the cut out frames
+//
+bool cMarkAdStandalone::MarkadCutParallel() {
+    if (!recordingIndexMark) return false;
+    if (macontext.Video.Info.framesPerSecond <= 0) return false;
+
+    std::vector<sCutSegment> segments;
+    cMark *startMark = marks.GetFirst();
+    while (startMark && startMark->Next()) {
+        cMark *stopMark = startMark->Next();
+        if (((startMark->type & 0x0F) != MT_START) || ((stopMark->type & 0x0F) != MT_STOP)) {
+            esyslog("got invalid mark pair (%d) type 0x%X and (%d) type 0x%X", startMark->position, startMark->type, stopMark->position, stopMark->type);
+            return false;
+        }
+        sCutSegment segment;
+        segment.startPosition = recordingIndexMark->GetIFrameBefore(startMark->position - 1);  // go before mark position to preload decoder pipe
+        if (segment.startPosition < 0) segment.startPosition = startMark->position;
+        segment.startMarkPosition = startMark->position;
+        segment.stopMarkPosition = stopMark->position;
+        segments.push_back(segment);
+        startMark = stopMark->Next();
+    }
+    if (segments.size() < 2) return false;  // nothing to encode in parallel
+
+    int jobs = macontext.Config->cutJobs;
+    if (jobs > static_cast<int>(segments.size())) jobs = segments.size();
+    int threads = ThreadsPerJob(macontext.Config->threads, jobs);  // share the thread budget of --threads between all segments
+    isyslog("encode %d segments with %d parallel jobs, %d threads per job", static_cast<int>(segments.size()), jobs, threads);
+    if (ptr_cDecoder) ptr_cDecoder->DisablePipeline();  // no decoder thread while fork
+
+    unsigned int next = 0;
+    int running = 0;
+    bool success = true;
+    bool stopSent = false;
+    while (true) {
+        while (success && !abortNow && (running < jobs) && (next < segments.size())) {
+            fflush(stdout);  // do not inherit buffered output
+            pid_t pid = fork();
+            if (pid < 0) {
+                esyslog("fork for segment %d failed: %s", next, strerror(errno));
+                success = false;
+                break;
+            }
+            if (pid == 0) {  // child process
+                macontext.Config->threads = threads;
+                _exit(MarkadCutSegment(next, segments[next].startPosition, segments[next].startMarkPosition, segments[next].stopMarkPosition) ? 0 : 1);
+            }
+            dsyslog("cMarkAdStandalone::MarkadCutParallel(): markad [%d] encodes segment %d", pid, next);
+            segments[next].pid = pid;
+            next++;
+            running++;
+        }
+        if (running == 0) break;
+        if ((abortNow || !success) && !stopSent) {  // stop all running segments
+            for (std::vector<sCutSegment>::iterator segment = segments.begin(); segment != segments.end(); ++segment) {
+                if (segment->pid > 0) kill(segment->pid, SIGTERM);
+            }
+            stopSent = true;
+        }
+        bool finished = false;
+        for (std::vector<sCutSegment>::iterator segment = segments.begin(); segment != segments.end(); ++segment) {
+            if (segment->pid <= 0) continue;
+            int status = 0;
+            if (waitpid(segment->pid, &status, WNOHANG) != segment->pid) continue;
+            if (!WIFEXITED(status) || (WEXITSTATUS(status) != 0)) {
+                esyslog("encoding of segment %d failed", static_cast<int>(segment - segments.begin()));
+                success = false;
+            }
+            segment->pid = 0;
+            running--;
+            finished = true;
+        }
+        if (!finished) sleep(1);
+    }
+
+    // concatenate segments to the cut file
+    cRemux *ptr_cRemux = NULL;
+    if (success && !abortNow) {
+        ptr_cRemux = new cRemux(directory);
+        ALLOC(sizeof(*ptr_cRemux), "ptr_cRemux");
+        success = ptr_cRemux->OpenFile();
+    }
+    int64_t ptsOffset = 0;
+    for (unsigned int segment = 0; segment < next; segment++) {
+        char *segmentFile = NULL;
+        if (asprintf(&segmentFile, "%s/" CUT_SEGMENT_FILE, directory, segment) == -1) {
+            success = false;
+            continue;
+        }
+        ALLOC(strlen(segmentFile)+1, "segmentFile");
+        if (segment > 0) {  // remove time of the frames between stop mark and next start mark
+            int gapFrames = segments[segment].startMarkPosition - segments[segment - 1].stopMarkPosition - 1;
+            int fileNumber = 0;
+            int64_t pos = -1;
+            int startTime_ms = 0;
+            int stopTime_ms = 0;
+            if (recordingIndexMark->GetIFramePosition(segments[segment].startMarkPosition, &fileNumber, &pos, &startTime_ms) &&
+                recordingIndexMark->GetIFramePosition(segments[segment - 1].stopMarkPosition, &fileNumber, &pos, &stopTime_ms)) {  // marks on i-frames, use time from index
+                ptsOffset += static_cast<int64_t>(startTime_ms - stopTime_ms) * 90 - static_cast<int64_t>(90000 / macontext.Video.Info.framesPerSecond);  // 90kHz clock
+            }
+            else ptsOffset += static_cast<int64_t>(static_cast<int64_t>(gapFrames) * 90000 / macontext.Video.Info.framesPerSecond);
+        }
+        if (ptr_cRemux && success && !abortNow) {
+            dsyslog("cMarkAdStandalone::MarkadCutParallel(): append segment %d, timestamp offset %" PRId64, segment, ptsOffset);
+            success = ptr_cRemux->AppendFile(segmentFile, ptsOffset);
+        }
+        if (unlink(segmentFile) != 0) dsyslog("cMarkAdStandalone::MarkadCutParallel(): failed to remove %s", segmentFile);
+        FREE(strlen(segmentFile)+1, "segmentFile");
+        free(segmentFile);
+        char *passlogFile = NULL;  // H.264 2 pass statistic of the segment
+        if (asprintf(&passlogFile, "%s/" CUT_SEGMENT_PASSLOG, directory, segment) != -1) {
+            ALLOC(strlen(passlogFile)+1, "passlogFile");
+            unlink(passlogFile);
+            FREE(strlen(passlogFile)+1, "passlogFile");
+            free(passlogFile);
+        }
+    }
+    if (ptr_cRemux) {
+        if (!ptr_cRemux->CloseFile()) success = false;
+        FREE(sizeof(*ptr_cRemux), "ptr_cRemux");
+        delete ptr_cRemux;
+    }
+    if (success) framecnt4 = segments.back().stopMarkPosition;
+    return success && !abortNow;
+}
+
+
 void cMarkAdStandalone::MarkadCut() {
     if (abortNow) return;
     if (!ptr_cDecoder) {
@@ -2559,6 +2839,20 @@ void cMarkAdStandalone::MarkadCut() {
     dsyslog("cMarkAdStandalone::MarkadCut(): final marks are:");
     DebugMarks();     //  only for debugging
 
+    // without re-encoding we need no decoder, copy ts packets between i-frames
+    if (!macontext.Config->fullEncode && !macontext.Config->ac3ReEncode) {
+        if (MarkadCutRemux()) return;
+        if (abortNow) return;
+        dsyslog("cMarkAdStandalone::MarkadCut(): remux failed, copy packets with encoder");
+    }
+
+    // full encode of more than one part, encode each part in parallel
+    if (macontext.Config->fullEncode && (macontext.Config->cutJobs > 1)) {
+        if (MarkadCutParallel()) return;
+        if (abortNow) return;
+        dsyslog("cMarkAdStandalone::MarkadCut(): parallel encoding not possible, encode sequential");
+    }
+
     // init encoder
     cEncoder *ptr_cEncoder = new cEncoder(&macontext);
     ALLOC(sizeof(*ptr_cEncoder), "ptr_cEncoder");
@@ -2572,8 +2866,9 @@ void cMarkAdStandalone::MarkadCut() {
 
     for (int pass = passMin; pass <= passMax; pass ++) {
         dsyslog("cMarkAdStandalone::MarkadCut(): start pass %d", pass);
-        ptr_cDecoder->Reset();
-        ptr_cDecoder->DecodeDir(directory);
+        ptr_cDecoder->SelectStreams(STREAMS_AUDIO_ALL);  // encoder writes all audio streams
+        ptr_cDecoder->SetAnalysisDecode(false, macontext.Config->fullDecode);  // encoder needs full picture quality
+        ptr_cDecoder->OpenDir(directory);  // SeekToFrame() jumps to the start position
         ptr_cEncoder->Reset(pass);
 
         // set start and end mark of first part
@@ -2604,8 +2899,8 @@ void cMarkAdStandalone::MarkadCut() {
         }
 
         bool nextFile = true;
-        // process input file
-        while(nextFile && ptr_cDecoder->DecodeDir(directory)) {
+        // process input file, input is open and positioned by SeekToFrame(), DecodeDir() only continues after end of input
+        do {
             while(ptr_cDecoder->GetNextPacket()) {
                 int frameNumber = ptr_cDecoder->GetFrameNumber();
                 if  (frameNumber < startPosition) {  // go to start frame
@@ -2666,7 +2961,7 @@ void cMarkAdStandalone::MarkadCut() {
                     return;
                 }
             }
-        }
+        } while(nextFile && ptr_cDecoder->DecodeDir(directory));
         if (!ptr_cEncoder->CloseFile(ptr_cDecoder)) {
             dsyslog("failed to close output file");
             return;
@@ -2712,8 +3007,8 @@ void cMarkAdStandalone::Process3ndPass() {
     LogSeparator(true);
     dsyslog("cMarkAdStandalone::Process3ndPass(): check for advertising in frame with logo after logo start and before logo stop mark and check for introduction logo");
 
-    ptr_cDecoder->Reset();
-    ptr_cDecoder->DecodeDir(directory);
+    ptr_cDecoder->SelectStreams(STREAMS_VIDEO);  // GetNextSilence() adds MP2 audio if it has to decode audio
+    ptr_cDecoder->OpenDir(directory);  // detection seeks to each search range
 
     cDetectLogoStopStart *ptr_cDetectLogoStopStart = new cDetectLogoStopStart(&macontext, ptr_cDecoder, recordingIndexMark, NULL);
     ALLOC(sizeof(*ptr_cDetectLogoStopStart), "ptr_cDetectLogoStopStart");
@@ -2814,12 +3109,6 @@ void cMarkAdStandalone::Process3ndPass() {
                 FREE(strlen(indexToHMSFSearchPosition)+1, "indexToHMSF");
                 free(indexToHMSFSearchPosition);
             }
-            // short start/stop pair can result in overlapping checks
-            if (ptr_cDecoder->GetFrameNumber() > searchStartPosition) {
-                dsyslog("cMarkAdStandalone::Process3ndPass(): current framenumber (%d) greater than framenumber to seek (%d), restart decoder", ptr_cDecoder->GetFrameNumber(), searchStartPosition);
-                ptr_cDecoder->Reset();
-                ptr_cDecoder->DecodeDir(directory);
-            }
             // detect frames
             if (ptr_cDetectLogoStopStart->Detect(searchStartPosition, markLogo->position, true)) {
                 int newStopPosition = ptr_cDetectLogoStopStart->AdInFrameWithLogo(false);
@@ -2845,8 +3134,8 @@ void cMarkAdStandalone::Process3ndPass() {
     if ((strcmp(macontext.Info.ChannelName, "TELE_5") == 0) ||
         (strcmp(macontext.Info.ChannelName, "Nickelodeon") == 0)) silenceRange =  7; // logo fade in/out
 
-    ptr_cDecoder->Reset();
-    ptr_cDecoder->DecodeDir(directory);
+    ptr_cDecoder->OpenDir(directory);  // GetNextSilence() seeks to each search range
+    int silenceSearchEnd = -1;         // decoder position after last silence search
 
     char *indexToHMSF = NULL;
     cMark *mark = marks.GetFirst();
@@ -2861,12 +3150,9 @@ void cMarkAdStandalone::Process3ndPass() {
             if (indexToHMSF) dsyslog("cMarkAdStandalone::Process3ndPass(): detect audio silence before logo mark at frame (%6i) type 0x%X at %s range %is", mark->position, mark->type, indexToHMSF, silenceRange);
             int seekPos =  mark->position - (silenceRange * macontext.Video.Info.framesPerSecond);
             if (seekPos < 0) seekPos = 0;
-            if (!ptr_cDecoder->SeekToFrame(&macontext, seekPos)) {
-                esyslog("could not seek to frame (%i)", mark->position);
-                break;
-            }
             framecnt3 += silenceRange * macontext.Video.Info.framesPerSecond;
-            int beforeSilence = ptr_cDecoder->GetNextSilence(&macontext, mark->position, true, true);
+            int beforeSilence = ptr_cDecoder->GetNextSilence(&macontext, seekPos, mark->position, true, true);
+            silenceSearchEnd = ptr_cDecoder->GetFrameNumber();
             if ((beforeSilence >= 0) && (beforeSilence != mark->position)) {
                 dsyslog("cMarkAdStandalone::Process3ndPass(): found audio silence before logo start at frame (%i)", beforeSilence);
                 // search for blackscreen near silence to optimize mark positon
@@ -2883,23 +3169,17 @@ void cMarkAdStandalone::Process3ndPass() {
             // search before stop mark
             if (indexToHMSF) dsyslog("cMarkAdStandalone::Process3ndPass(): detect audio silence before logo stop mark at frame (%6i) type 0x%X at %s range %i", mark->position, mark->type, indexToHMSF, silenceRange);
             int seekPos =  mark->position - (silenceRange * macontext.Video.Info.framesPerSecond);
-            if (seekPos < ptr_cDecoder->GetFrameNumber()) seekPos = ptr_cDecoder->GetFrameNumber();  // will retun -1 before first frame read
+            if (seekPos < silenceSearchEnd) seekPos = silenceSearchEnd;  // do not search again in range of mark before
             if (seekPos < 0) seekPos = 0;
-            if (!ptr_cDecoder->SeekToFrame(&macontext, seekPos)) {
-                esyslog("could not seek to frame (%i)", mark->position);
-                break;
-            }
-            int beforeSilence = ptr_cDecoder->GetNextSilence(&macontext, mark->position, true, false);
+            int beforeSilence = ptr_cDecoder->GetNextSilence(&macontext, seekPos, mark->position, true, false);
+            silenceSearchEnd = ptr_cDecoder->GetFrameNumber();
             if (beforeSilence >= 0) dsyslog("cMarkAdStandalone::Process3ndPass(): found audio silence before logo stop mark (%i) at frame (%i)", mark->position, beforeSilence);
 
             // search after stop mark
             if (indexToHMSF) dsyslog("cMarkAdStandalone::Process3ndPass(): detect audio silence after logo stop mark at frame (%6i) type 0x%X at %s range %i", mark->position, mark->type, indexToHMSF, silenceRange);
-            if (!ptr_cDecoder->SeekToFrame(&macontext, mark->position)) {
-                esyslog("could not seek to frame (%i)", mark->position);
-                break;
-            }
             int stopFrame =  mark->position + ((silenceRange - 1) * macontext.Video.Info.framesPerSecond);  // reduce detection range after logo stop to avoid to get stop mark after separation image
-            int afterSilence = ptr_cDecoder->GetNextSilence(&macontext, stopFrame, false, false);
+            int afterSilence = ptr_cDecoder->GetNextSilence(&macontext, mark->position, stopFrame, false, false);
+            silenceSearchEnd = ptr_cDecoder->GetFrameNumber();
             if (afterSilence >= 0) dsyslog("cMarkAdStandalone::Process3ndPass(): found audio silence after logo stop mark (%i) at iFrame (%i)", mark->position, afterSilence);
             framecnt3 += 2 * (silenceRange - 1) * macontext.Video.Info.framesPerSecond;
             bool before = false;
@@ -3006,8 +3286,8 @@ void cMarkAdStandalone::Process2ndPass() {
     cMark *p1 = NULL,*p2 = NULL;
 
     if (ptr_cDecoder) {
-        ptr_cDecoder->Reset();
-        ptr_cDecoder->DecodeDir(directory);
+        ptr_cDecoder->SelectStreams(STREAMS_VIDEO);  // overlap detection needs only video
+        ptr_cDecoder->OpenDir(directory);            // overlap detection seeks to each mark
     }
 
     if (marks.Count() >= 4) {
@@ -3169,6 +3449,20 @@ void cMarkAdStandalone::ProcessFiles() {
     dsyslog("cMarkAdStandalone::ProcessFiles(): start processing files");
     ptr_cDecoder = new cDecoder(macontext.Config->threads, recordingIndexMark);
     ALLOC(sizeof(*ptr_cDecoder), "ptr_cDecoder");
+    ptr_cDecoder->EnablePipeline(macontext.Config->fullDecode);  // read and decode in a separate thread
+    if (macontext.Config->sparseRead && !macontext.Config->fullDecode) {
+        ptr_cDecoder->EnableSparseRead(directory);  // no level track, silence detection has to decode audio
+        ptr_cDecoder->SelectStreams(STREAMS_AUDIO_AC3);
+    }
+    else {
+        ptr_cDecoder->EnableLevelTrack(true);  // audio levels for silence detection of 3rd pass
+        ptr_cDecoder->SelectStreams(STREAMS_AUDIO_AC3 | STREAMS_AUDIO_MP2);
+    }
+    ptr_cDecoder->SetAnalysisDecode(macontext.Config->analysisDecode, macontext.Config->fullDecode);
+    if (macontext.Config->useCache && !cache) {
+        cache = new cMarkAdCache(directory);
+        ALLOC(sizeof(*cache), "cache");
+    }
     CheckIndexGrowing();
     while(ptr_cDecoder && ptr_cDecoder->DecodeDir(directory)) {
         if (abortNow) {
@@ -3219,6 +3513,11 @@ void cMarkAdStandalone::ProcessFiles() {
             CheckIndexGrowing();
         }
     }
+    if (ptr_cDecoder) {
+        ptr_cDecoder->DisablePipeline();  // following passes seek in the recording
+        ptr_cDecoder->EnableSparseRead(NULL);
+        ptr_cDecoder->EnableLevelTrack(false);
+    }
 
     if (!abortNow) {
         if (iStart !=0 ) {  // iStart will be 0 if iStart was called
@@ -3247,11 +3546,43 @@ void cMarkAdStandalone::ProcessFiles() {
                     if (macontext.Config->saveInfo) SaveInfo();
 
         }
+        if (cache) cache->Save(&macontext, recordingIndexMark, &marks, &blackMarks);
     }
     dsyslog("cMarkAdStandalone::ProcessFiles(): end processing files");
 }
 
 
+// use results of the first pass from analysis cache instead of decoding the recording again
+// return: true if analysis cache is valid, false otherwise
+//
+bool cMarkAdStandalone::RestoreFromCache() {
+    if (abortNow) return false;
+    if (!macontext.Config->useCache) return false;
+    if (macontext.Info.isRunningRecording) return false;
+    if (!cache) {
+        cache = new cMarkAdCache(directory);
+        ALLOC(sizeof(*cache), "cache");
+    }
+    if (!cache->Load(macontext.Config)) {
+        isyslog("no valid analysis cache found");
+        return false;
+    }
+    cache->RestoreVideoInfo(&macontext);
+    cache->RestoreIndex(recordingIndexMark);
+    marks.DelAll();
+    blackMarks.DelAll();
+    cache->RestoreMarks(&marks, &blackMarks);
+    if (!ptr_cDecoder) {
+        ptr_cDecoder = new cDecoder(macontext.Config->threads, recordingIndexMark);
+        ALLOC(sizeof(*ptr_cDecoder), "ptr_cDecoder");
+        ptr_cDecoder->SetAnalysisDecode(macontext.Config->analysisDecode, macontext.Config->fullDecode);
+    }
+    isyslog("use recording index and marks of first pass from analysis cache");
+    DebugMarks();
+    return true;
+}
+
+
 bool cMarkAdStandalone::SetFileUID(char *file) {
     if (!file) return false;
     struct stat statbuf;
@@ -3568,6 +3899,11 @@ bool cMarkAdStandalone::CheckLogo() {
 
     dsyslog("cMarkAdStandalone::CheckLogo(): using logo directory %s", macontext.Config->logoDirectory);
     dsyslog("cMarkAdStandalone::CheckLogo(): searching logo for %s", macontext.Info.ChannelName);
+    cLogoDB logoDB;
+    if (logoDB.Open(macontext.Config->logoDirectory) && logoDB.HasChannel(macontext.Info.ChannelName)) {
+        dsyslog("cMarkAdStandalone::CheckLogo(): found logo in logo database");
+        return true;
+    }
     DIR *dir = opendir(macontext.Config->logoDirectory);
     if (!dir) return false;
 
@@ -3928,7 +4264,7 @@ cMarkAdStandalone::cMarkAdStandalone(const char *directoryParam, sMarkAdConfig *
 
     length = 0;
     sleepcnt = 0;
-    waittime = iwaittime = 0;
+    waittime_ms = iwaittime = 0;
     duplicate = false;
     title[0] = 0;
 
@@ -4155,9 +4491,26 @@ cMarkAdStandalone::~cMarkAdStandalone() {
         }
         double etime = 0;
         double ftime = 0;
-        etime = sec + ((double) usec / 1000000) - waittime;
+        etime = sec + ((double) usec / 1000000) - ((double) waittime_ms / 1000);
         if (etime > 0) ftime = (framecnt1 + framecnt2 + framecnt3) / etime;
         isyslog("processed time %d:%02d min with %.1f fps", static_cast<int> (etime / 60), static_cast<int> (etime - (static_cast<int> (etime / 60) * 60)), ftime);
+
+        if (macontext.Config->perfReport) {  // write timing report of all stages
+            int passFrames[4] = {framecnt1, framecnt2, framecnt3, framecnt4};
+            char *perfFile = NULL;
+            if (macontext.Config->perfReportFile[0]) {
+                if (asprintf(&perfFile, "%s", macontext.Config->perfReportFile) == -1) perfFile = NULL;
+            }
+            else {
+                if (asprintf(&perfFile, "%s/%s", directory, PERF_FILENAME) == -1) perfFile = NULL;
+            }
+            if (perfFile) {
+                ALLOC(strlen(perfFile)+1, "perfFile");
+                if (PerfWriteReport(perfFile, VERSION, directory, passFrames)) SetFileUID(perfFile);
+                FREE(strlen(perfFile)+1, "perfFile");
+                free(perfFile);
+            }
+        }
     }
 
     if ((osd) && (!duplicate)) {
@@ -4198,6 +4551,16 @@ cMarkAdStandalone::~cMarkAdStandalone() {
         delete ptr_cDecoder;
         ptr_cDecoder = NULL;
     }
+    if (cache) {
+        FREE(sizeof(*cache), "cache");
+        delete cache;
+        cache = NULL;
+    }
+    if (recordingWaiter) {
+        FREE(sizeof(*recordingWaiter), "recordingWaiter");
+        delete recordingWaiter;
+        recordingWaiter = NULL;
+    }
     RemovePidfile();
 }
 
@@ -4275,6 +4638,7 @@ int usage(int svdrpport) {
            "                  process only first pass, setting of marks\n"
            "                --pass2only\n"
            "                  process only second pass, fine adjustment of marks\n"
+           "                  with --cache the marks of the first pass are taken from markad.cache of a previous run\n"
            "                --svdrphost=<ip/hostname> (default is 127.0.0.1)\n"
            "                  ip/hostname of a remote VDR for OSD messages\n"
            "                --svdrpport=<port> (default is %i)\n"
@@ -4302,12 +4666,38 @@ int usage(int svdrpport) {
            "                  use it only on powerfull CPUs, it will double overall run time\n"
            "                  <streams>  all  = keep all video and audio streams of the recording\n"
            "                             best = only encode best video and best audio stream, drop rest\n"
+           "                --cutjobs=<n>\n"
+           "                  number of parts encoded in parallel by --fullencode, default 1, max. 16\n"
+           "                  --threads is shared between all parallel parts, without --threads the number of CPUs\n"
+           "                --cache\n"
+           "                  store recording index and marks of first pass in markad.cache\n"
+           "                  in the recording directory and use it with --pass2only\n"
+           "                --fastoverlap\n"
+           "                  overlap detection uses only every second line and column of the frames\n"
+           "                --sparseread\n"
+           "                  first pass reads only i-frames and the audio packets after them from the ts files\n"
+           "                  byte positions are taken from the VDR index file, not used with --fulldecode\n"
+           "                --analysisdecode\n"
+           "                  faster video decoding with reduced picture quality, which is good enough for the detectors\n"
+           "                  not used for the cut\n"
+           "                --readlimit=<MB/s>\n"
+           "                  maximum read rate from the ts files, default 0 = no limit, max. 1000\n"
+           "                --perf-report[=<file>]\n"
+           "                  measure time of all processing stages and write it as JSON to <file>\n"
+           "                  default is markad.perf.json in the recording directory\n"
+           "                --jobs=<n>\n"
+           "                  number of recordings processed in parallel by batch and serve, default 1, max. 16\n"
+           "                  --threads is shared between all parallel recordings, without --threads the number of CPUs\n"
            "\ncmd: one of\n"
            "-                            dummy-parameter if called directly\n"
            "nice                         runs markad directly and with nice(19)\n"
            "after                        markad started by vdr after the recording is complete\n"
            "before                       markad started by vdr before the recording is complete, only valid together with --online\n"
            "edited                       markad started by vdr in edit function and exits immediately\n"
+           "batch                        process all following recordings, directories are searched for recordings\n"
+           "serve                        wait for jobs in the following spool directory until SIGTERM\n"
+           "                             a job is a link to a recording or a file with the recording directory in the first line\n"
+           "logodb                       create logo database markad.logodb from all PGM logo files of --logocachedir and exit\n"
            "\n<record>                     is the name of the directory where the recording\n"
            "                             is stored\n\n",
            svdrpport
@@ -4363,9 +4753,357 @@ void freedir(void) {
 }
 
 
+// process one recording, used for a single recording and for each recording of batch mode
+//
+static int ProcessRecording(sMarkAdConfig *config, const bool pass1Only, const bool pass2Only, const int niceLevel, const int ioprioClass, const int prioProcess, const int ioPrio) {
+    // now do the work...
+    struct stat statbuf;
+    if (stat(recDir, &statbuf) == -1) {
+        fprintf(stderr,"%s not found\n", recDir);
+        return -1;
+    }
+
+    if (!S_ISDIR(statbuf.st_mode)) {
+        fprintf(stderr, "%s is not a directory\n", recDir);
+        return -1;
+    }
+
+    if (access(recDir, W_OK|R_OK) == -1) {
+        fprintf(stderr,"cannot access %s\n", recDir);
+        return -1;
+    }
+
+    // ignore some signals
+    signal(SIGHUP, SIG_IGN);
+
+    // catch some signals
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGSEGV, signal_handler);
+    signal(SIGABRT, signal_handler);
+    signal(SIGUSR1, signal_handler);
+    signal(SIGTSTP, signal_handler);
+    signal(SIGCONT, signal_handler);
+
+    cIndex *recordingIndex = new cIndex();
+    ALLOC(sizeof(*recordingIndex), "recordingIndex");
+
+    cmasta = new cMarkAdStandalone(recDir, config, recordingIndex);
+    ALLOC(sizeof(*cmasta), "cmasta");
+    if (!cmasta) return -1;
+
+    isyslog("parameter --loglevel is set to %i", SysLogLevel);
+
+    if (niceLevel != 19) {
+        isyslog("parameter --priority %i", niceLevel);
+        isyslog("warning: increasing priority may affect other applications");
+    }
+    if (ioprioClass != 3) {
+        isyslog("parameter --ioprio %i", ioprioClass);
+        isyslog("warning: increasing priority may affect other applications");
+    }
+    dsyslog("markad process nice level %i", prioProcess);
+    dsyslog("markad IO priority class  %i" ,ioPrio);
+
+    dsyslog("parameter --logocachedir is set to %s", config->logoDirectory);
+    dsyslog("parameter --threads is set to %i", config->threads);
+    dsyslog("parameter --astopoffs is set to %i", config->astopoffs);
+    if (LOG2REC) dsyslog("parameter --log2rec is set");
+
+    if (config->useVPS) {
+        dsyslog("parameter --vps is set");
+    }
+    if (config->MarkadCut) {
+        dsyslog("parameter --cut is set");
+    }
+    if (config->ac3ReEncode) {
+        dsyslog("parameter --ac3reencode is set");
+        if (!config->MarkadCut) {
+            esyslog("--cut is not set, ignoring --ac3reencode");
+            config->ac3ReEncode = false;
+        }
+    }
+    dsyslog("parameter --autologo is set to %i",config->autoLogo);
+    if (config->fullDecode) {
+        dsyslog("parameter --fulldecode is set");
+    }
+    if (config->fullEncode) {
+        dsyslog("parameter --fullencode is set");
+        if (config->bestEncode) dsyslog("encode best streams");
+        else dsyslog("encode all streams");
+        if (config->cutJobs > 1) dsyslog("parameter --cutjobs is set to %d", config->cutJobs);
+    }
+    if (config->useCache) {
+        dsyslog("parameter --cache is set");
+    }
+    if (config->fastOverlap) {
+        dsyslog("parameter --fastoverlap is set");
+    }
+    if (config->sparseRead) {
+        dsyslog("parameter --sparseread is set");
+    }
+    if (config->analysisDecode) {
+        dsyslog("parameter --analysisdecode is set");
+    }
+    if (config->readLimit > 0) {
+        dsyslog("parameter --readlimit is set to %dMB/s", config->readLimit);
+    }
+    if (config->perfReport) {
+        dsyslog("parameter --perf-report is set");
+    }
+    cDecoder::SetReadLimit(config->readLimit);  // shared by all decoders of this process
+    if (!pass2Only) {
+        cPerfTimer perfTimer(PERF_PASS1);
+        gettimeofday(&startPass1, NULL);
+        cmasta->ProcessFiles();
+        gettimeofday(&endPass1, NULL);
+    }
+    else cmasta->RestoreFromCache();
+    if (!pass1Only) {
+        {
+            cPerfTimer perfTimer(PERF_PASS2);
+            gettimeofday(&startPass2, NULL);
+            cmasta->Process2ndPass();  // overlap detection
+            gettimeofday(&endPass2, NULL);
+        }
+        {
+            cPerfTimer perfTimer(PERF_PASS3);
+            gettimeofday(&startPass3, NULL);
+            cmasta->Process3ndPass();  // Audio silence detection
+            gettimeofday(&endPass3, NULL);
+        }
+    }
+    if (config->MarkadCut) {
+        cPerfTimer perfTimer(PERF_PASS4);
+        gettimeofday(&startPass4, NULL);
+        cmasta->MarkadCut();
+        gettimeofday(&endPass4, NULL);
+    }
+#ifdef DEBUG_MARK_FRAMES
+    cmasta->DebugMarkFrames(); // write frames picture of marks to recording directory
+#endif
+    if (cmasta) {
+        FREE(sizeof(*cmasta), "cmasta");
+        delete cmasta;
+        cmasta = NULL;
+    }
+    if (recordingIndex) {
+        FREE(sizeof(*recordingIndex), "recordingIndex");
+        delete recordingIndex;
+        recordingIndex = NULL;
+    }
+
+#ifdef DEBUG_MEM
+    memList();
+#endif
+    return 0;
+}
+
+
+/**
+ * running child process of batch mode
+ */
+struct sBatchJob {
+    pid_t pid = 0;            //!< process id of the child process
+                              //!<
+    char *recording = NULL;   //!< recording directory processed by the child process
+                              //!<
+};
+
+
+// add a recording directory or all recording directories below a directory to the batch queue
+// a recording which is already queued or running is ignored, a finished recording can be queued again
+//
+static void BatchAddRecordings(const char *path, std::vector<char *> *recordings, const std::vector<sBatchJob> *running, const int depth) {
+    if (depth > BATCH_MAX_DEPTH) return;
+    char *realPath = realpath(path, NULL);
+    if (!realPath) {
+        esyslog("batch: %s not found", path);
+        return;
+    }
+    struct stat statbuf;
+    if ((stat(realPath, &statbuf) == -1) || !S_ISDIR(statbuf.st_mode)) {
+        esyslog("batch: %s is not a directory", realPath);
+        free(realPath);
+        return;
+    }
+    int len = strlen(realPath);
+    if ((len > 4) && (strcmp(realPath + len - 4, ".rec") == 0)) {
+        bool duplicate = false;
+        for (std::vector<char *>::iterator recording = recordings->begin(); recording != recordings->end(); ++recording) {
+            if (strcmp(*recording, realPath) == 0) {
+                duplicate = true;
+                break;
+            }
+        }
+        if (running) {
+            for (std::vector<sBatchJob>::const_iterator job = running->begin(); job != running->end(); ++job) {
+                if (strcmp(job->recording, realPath) == 0) {
+                    duplicate = true;
+                    break;
+                }
+            }
+        }
+        if (duplicate) {
+            isyslog("batch: %s is already queued or running, ignore it", realPath);
+            free(realPath);
+            return;
+        }
+        recordings->push_back(realPath);
+        return;
+    }
+    DIR *dir = opendir(realPath);  // search recordings in sub directories
+    if (dir) {
+        struct dirent *dirent = NULL;
+        while ((dirent = readdir(dir))) {
+            if (dirent->d_name[0] == '.') continue;
+            if ((dirent->d_type != DT_DIR) && (dirent->d_type != DT_LNK) && (dirent->d_type != DT_UNKNOWN)) continue;
+            char *subDir = NULL;
+            if (asprintf(&subDir, "%s/%s", realPath, dirent->d_name) == -1) continue;
+            ALLOC(strlen(subDir)+1, "subDir");
+            BatchAddRecordings(subDir, recordings, running, depth + 1);
+            FREE(strlen(subDir)+1, "subDir");
+            free(subDir);
+        }
+        closedir(dir);
+    }
+    free(realPath);
+}
+
+
+// read new jobs from spool directory and remove them
+// a job is a link to the recording directory or a file with the recording directory in the first line
+// files starting with a dot are ignored, create the job file with a dot and rename it when it is complete
+//
+static void BatchReadSpool(const char *spoolDir, std::vector<char *> *recordings, const std::vector<sBatchJob> *running) {
+    DIR *dir = opendir(spoolDir);
+    if (!dir) {
+        esyslog("serve: cannot open spool directory %s", spoolDir);
+        return;
+    }
+    struct dirent *dirent = NULL;
+    while ((dirent = readdir(dir))) {
+        if (dirent->d_name[0] == '.') continue;
+        char *job = NULL;
+        if (asprintf(&job, "%s/%s", spoolDir, dirent->d_name) == -1) continue;
+        ALLOC(strlen(job)+1, "job");
+        struct stat statbuf;
+        if (stat(job, &statbuf) == 0) {
+            if (S_ISDIR(statbuf.st_mode)) BatchAddRecordings(job, recordings, running, 0);
+            else if (S_ISREG(statbuf.st_mode)) {
+                FILE *jobFile = fopen(job, "r");
+                if (jobFile) {
+                    char line[PATH_MAX] = {};
+                    if (fgets(line, sizeof(line), jobFile)) {
+                        line[strcspn(line, "\r\n")] = 0;
+                        if (line[0]) BatchAddRecordings(line, recordings, running, 0);
+                    }
+                    fclose(jobFile);
+                }
+            }
+        }
+        dsyslog("serve: job %s received", dirent->d_name);
+        if (unlink(job) == -1) esyslog("serve: cannot remove job %s from spool directory", job);
+        FREE(strlen(job)+1, "job");
+        free(job);
+    }
+    closedir(dir);
+}
+
+
+// process many recordings in one markad process
+// each recording runs in a child process forked from this already initialized process, the child processes
+// inherit the preloaded logo files and write their log to the recording directory
+// with a spool directory run as server until SIGTERM, otherwise return after all recordings are processed
+// recordings is the queue of not started recordings, a started recording moves to its job and is freed when the job ends
+//
+static int RunBatch(sMarkAdConfig *config, std::vector<char *> *recordings, const char *spoolDir, const int jobs, const bool pass1Only, const bool pass2Only, const int niceLevel, const int ioprioClass, const int prioProcess, const int ioPrio) {
+    // share the thread budget of --threads between all parallel recordings
+    if (jobs > 1) config->threads = ThreadsPerJob(config->threads, jobs);
+    config->perfReportFile[0] = 0;  // each recording gets its own timing report in the recording directory
+    isyslog("batch: %d recordings queued, %d parallel jobs, %d threads per job", static_cast<int> (recordings->size()), jobs, config->threads);
+    if (spoolDir) isyslog("serve: wait for jobs in spool directory %s", spoolDir);
+    cMarkAdLogo::PreloadLogoFiles(config->logoDirectory);
+
+    signal(SIGHUP, SIG_IGN);
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    std::vector<sBatchJob> running;
+    int done = 0;
+    int failed = 0;
+    bool stopSent = false;
+    while (true) {
+        if (spoolDir && !abortNow) BatchReadSpool(spoolDir, recordings, &running);
+        while (!abortNow && (running.size() < static_cast<unsigned int> (jobs)) && !recordings->empty()) {
+            char *recording = recordings->front();
+            fflush(stdout);  // do not inherit buffered output
+            pid_t pid = fork();
+            if (pid < 0) {
+                esyslog("batch: fork failed: %s", strerror(errno));
+                break;  // retry later
+            }
+            if (pid == 0) {  // child process
+                gettimeofday(&startAll, NULL);
+                if (config->perfReport) PerfEnable();
+                LOG2REC = true;
+                if (recDir) free(recDir);
+                recDir = strdup(recording);
+                config->recDir = recDir;
+                exit(ProcessRecording(config, pass1Only, pass2Only, niceLevel, ioprioClass, prioProcess, ioPrio));
+            }
+            recordings->erase(recordings->begin());
+            isyslog("batch: markad [%d] started for %s", pid, recording);
+            sBatchJob job;
+            job.pid = pid;
+            job.recording = recording;
+            running.push_back(job);
+        }
+        if (running.empty()) {
+            if (!spoolDir || abortNow) break;
+            sleep(BATCH_POLL_TIME);
+            continue;
+        }
+        if (abortNow && !stopSent) {  // stop all running recordings
+            for (std::vector<sBatchJob>::iterator job = running.begin(); job != running.end(); ++job) kill(job->pid, SIGTERM);
+            stopSent = true;
+        }
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, WNOHANG);
+        if (pid <= 0) {
+            sleep(1);
+            continue;
+        }
+        for (std::vector<sBatchJob>::iterator job = running.begin(); job != running.end(); ++job) {
+            if (job->pid != pid) continue;
+            if (WIFEXITED(status) && (WEXITSTATUS(status) == 0)) {
+                isyslog("batch: markad [%d] finished %s", pid, job->recording);
+                done++;
+            }
+            else {
+                if (WIFSIGNALED(status)) esyslog("batch: markad [%d] killed by signal %d for %s", pid, WTERMSIG(status), job->recording);
+                else esyslog("batch: markad [%d] failed with status %d for %s", pid, WEXITSTATUS(status), job->recording);
+                failed++;
+            }
+            free(job->recording);
+            running.erase(job);
+            break;
+        }
+    }
+    isyslog("batch: %d recordings processed, %d failed, %d not started", done, failed, static_cast<int> (recordings->size()));
+    for (std::vector<char *>::iterator recording = recordings->begin(); recording != recordings->end(); ++recording) free(*recording);
+    recordings->clear();
+    return (failed > 0) ? 1 : 0;
+}
+
+
 int main(int argc, char *argv[]) {
     bool bAfter = false, bEdited = false;
     bool bFork = false, bNice = false, bImmediateCall = false;
+    bool bBatch = false, bServe = false, bLogoDB = false;
+    int batchJobs = 1;
+    std::vector<char *> batchRecordings;
+    const char *spoolDir = NULL;
     int niceLevel = 19;
     int ioprio_class = 3;
     int ioprio = 7;
@@ -4438,6 +5176,14 @@ int main(int argc, char *argv[]) {
             {"autologo",1,0,16},
             {"fulldecode",0,0,17},
             {"fullencode",1,0,18},
+            {"cache",0,0,19},
+            {"fastoverlap",0,0,20},
+            {"perf-report",2,0,21},
+            {"jobs",1,0,22},
+            {"cutjobs",1,0,23},
+            {"sparseread",0,0,24},
+            {"readlimit",1,0,25},
+            {"analysisdecode",0,0,26},
 
             {0, 0, 0, 0}
         };
@@ -4695,10 +5441,62 @@ int main(int argc, char *argv[]) {
                     ntok++;
                 }
                 break;
+            case 19: // --cache
+                config.useCache = true;
+                break;
+            case 20: // --fastoverlap
+                config.fastOverlap = true;
+                break;
+            case 21: // --perf-report
+                config.perfReport = true;
+                if (optarg) {
+                    // markad changes to / before it writes the report, relative path has to be resolved now
+                    char cwd[PATH_MAX] = "";
+                    if ((optarg[0] != '/') && !getcwd(cwd, sizeof(cwd))) {
+                        fprintf(stderr, "markad: cannot get current directory for timing report %s\n", optarg);
+                        return 2;
+                    }
+                    int len = 0;
+                    if (cwd[0]) len = snprintf(config.perfReportFile, sizeof(config.perfReportFile), "%s/%s", cwd, optarg);
+                    else len = snprintf(config.perfReportFile, sizeof(config.perfReportFile), "%s", optarg);
+                    if ((len < 0) || (len >= static_cast<int>(sizeof(config.perfReportFile)))) {
+                        fprintf(stderr, "markad: filename of timing report too long: %s\n", optarg);
+                        return 2;
+                    }
+                }
+                break;
+            case 22: // --jobs
+                batchJobs = atoi(optarg);
+                if ((batchJobs < 1) || (batchJobs > BATCH_MAX_JOBS)) {
+                    fprintf(stderr, "markad: invalid jobs value: %s\n", optarg);
+                    return 2;
+                }
+                break;
+            case 23: // --cutjobs
+                config.cutJobs = atoi(optarg);
+                if ((config.cutJobs < 1) || (config.cutJobs > CUT_MAX_JOBS)) {
+                    fprintf(stderr, "markad: invalid cutjobs value: %s\n", optarg);
+                    return 2;
+                }
+                break;
+            case 24: // --sparseread
+                config.sparseRead = true;
+                break;
+            case 25: // --readlimit
+                if (isnumber(optarg) && atoi(optarg) >= 0 && atoi(optarg) <= READ_LIMIT_MAX) config.readLimit = atoi(optarg);
+                else {
+                    fprintf(stderr, "markad: invalid readlimit value: %s\n", optarg);
+                    return 2;
+                }
+                break;
+            case 26: // --analysisdecode
+                config.analysisDecode = true;
+                break;
             default:
                 printf ("? getopt returned character code 0%o ? (option_index %d)\n", option,option_index);
         }
     }
+    if (config.perfReport) PerfEnable();
 
     if (optind < argc) {
         while (optind < argc) {
@@ -4718,6 +5516,21 @@ int main(int argc, char *argv[]) {
             else if (strcmp(argv[optind], "-" ) == 0 ) {
                 bImmediateCall = true;
             }
+            else if (strcmp(argv[optind], "batch" ) == 0 ) {
+                bBatch = true;
+            }
+            else if (strcmp(argv[optind], "serve" ) == 0 ) {
+                bServe = true;
+            }
+            else if (strcmp(argv[optind], "logodb" ) == 0 ) {
+                bLogoDB = true;
+            }
+            else if (bBatch) {
+                BatchAddRecordings(argv[optind], &batchRecordings, NULL, 0);
+            }
+            else if (bServe) {
+                spoolDir = argv[optind];
+            }
             else {
                 if ( strstr(argv[optind], ".rec") != NULL ) {
                     recDir=realpath(argv[optind], NULL);
@@ -4736,12 +5549,23 @@ int main(int argc, char *argv[]) {
 
     // do nothing if called from vdr before/after the video is cutted
     if (bEdited) return 0;
+
+    // create logo database and exit
+    if (bLogoDB) return (cLogoDB::Create(config.logoDirectory) >= 0) ? 0 : 1;
     if ((bAfter) && (config.online)) return 0;
     if ((config.before) && (config.online == 1) && recDir && (!strchr(recDir, '@'))) return 0;
 
     // we can run, if one of bImmediateCall, bAfter, bBefore or bNice is true
     // and recDir is given
-    if ( (bImmediateCall || config.before || bAfter || bNice) && recDir ) {
+    if (bServe && !spoolDir) {
+        fprintf(stderr, "markad: serve needs a spool directory\n");
+        return 2;
+    }
+    if (bBatch && batchRecordings.empty()) {
+        fprintf(stderr, "markad: no recordings found for batch\n");
+        return 2;
+    }
+    if ( ((bImmediateCall || config.before || bAfter || bNice) && recDir) || bBatch || bServe ) {
         // if bFork is given go in background
         if ( bFork ) {
             //close_files();
@@ -4826,119 +5650,8 @@ int main(int argc, char *argv[]) {
         }
         IOPrio = IOPrio >> 13;
 
-        // now do the work...
-        struct stat statbuf;
-        if (stat(recDir, &statbuf) == -1) {
-            fprintf(stderr,"%s not found\n", recDir);
-            return -1;
-        }
-
-        if (!S_ISDIR(statbuf.st_mode)) {
-            fprintf(stderr, "%s is not a directory\n", recDir);
-            return -1;
-        }
-
-        if (access(recDir, W_OK|R_OK) == -1) {
-            fprintf(stderr,"cannot access %s\n", recDir);
-            return -1;
-        }
-
-        // ignore some signals
-        signal(SIGHUP, SIG_IGN);
-
-        // catch some signals
-        signal(SIGINT, signal_handler);
-        signal(SIGTERM, signal_handler);
-        signal(SIGSEGV, signal_handler);
-        signal(SIGABRT, signal_handler);
-        signal(SIGUSR1, signal_handler);
-        signal(SIGTSTP, signal_handler);
-        signal(SIGCONT, signal_handler);
-
-        cIndex *recordingIndex = new cIndex();
-        ALLOC(sizeof(*recordingIndex), "recordingIndex");
-
-        cmasta = new cMarkAdStandalone(recDir,&config, recordingIndex);
-        ALLOC(sizeof(*cmasta), "cmasta");
-        if (!cmasta) return -1;
-
-        isyslog("parameter --loglevel is set to %i", SysLogLevel);
-
-        if (niceLevel != 19) {
-            isyslog("parameter --priority %i", niceLevel);
-            isyslog("warning: increasing priority may affect other applications");
-        }
-        if (ioprio_class != 3) {
-            isyslog("parameter --ioprio %i", ioprio_class);
-            isyslog("warning: increasing priority may affect other applications");
-        }
-        dsyslog("markad process nice level %i", PrioProcess);
-        dsyslog("markad IO priority class  %i" ,IOPrio);
-
-        dsyslog("parameter --logocachedir is set to %s", config.logoDirectory);
-        dsyslog("parameter --threads is set to %i", config.threads);
-        dsyslog("parameter --astopoffs is set to %i", config.astopoffs);
-        if (LOG2REC) dsyslog("parameter --log2rec is set");
-
-        if (config.useVPS) {
-            dsyslog("parameter --vps is set");
-        }
-        if (config.MarkadCut) {
-            dsyslog("parameter --cut is set");
-        }
-        if (config.ac3ReEncode) {
-            dsyslog("parameter --ac3reencode is set");
-            if (!config.MarkadCut) {
-                esyslog("--cut is not set, ignoring --ac3reencode");
-                config.ac3ReEncode = false;
-            }
-        }
-        dsyslog("parameter --autologo is set to %i",config.autoLogo);
-        if (config.fullDecode) {
-            dsyslog("parameter --fulldecode is set");
-        }
-        if (config.fullEncode) {
-            dsyslog("parameter --fullencode is set");
-            if (config.bestEncode) dsyslog("encode best streams");
-            else dsyslog("encode all streams");
-        }
-        if (!bPass2Only) {
-            gettimeofday(&startPass1, NULL);
-            cmasta->ProcessFiles();
-            gettimeofday(&endPass1, NULL);
-        }
-        if (!bPass1Only) {
-            gettimeofday(&startPass2, NULL);
-            cmasta->Process2ndPass();  // overlap detection
-            gettimeofday(&endPass2, NULL);
-
-            gettimeofday(&startPass3, NULL);
-            cmasta->Process3ndPass();  // Audio silence detection
-            gettimeofday(&endPass3, NULL);
-        }
-        if (config.MarkadCut) {
-            gettimeofday(&startPass4, NULL);
-            cmasta->MarkadCut();
-            gettimeofday(&endPass4, NULL);
-        }
-#ifdef DEBUG_MARK_FRAMES
-        cmasta->DebugMarkFrames(); // write frames picture of marks to recording directory
-#endif
-        if (cmasta) {
-            FREE(sizeof(*cmasta), "cmasta");
-            delete cmasta;
-            cmasta = NULL;
-        }
-        if (recordingIndex) {
-            FREE(sizeof(*recordingIndex), "recordingIndex");
-            delete recordingIndex;
-            recordingIndex = NULL;
-        }
-
-#ifdef DEBUG_MEM
-        memList();
-#endif
-        return 0;
+        if (bBatch || bServe) return RunBatch(&config, &batchRecordings, spoolDir, batchJobs, bPass1Only, bPass2Only, niceLevel, ioprio_class, PrioProcess, IOPrio);
+        return ProcessRecording(&config, bPass1Only, bPass2Only, niceLevel, ioprio_class, PrioProcess, IOPrio);
     }
     return usage(config.svdrpport);
 }
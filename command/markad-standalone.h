@@ -19,6 +19,8 @@ extern "C" {
 #include "marks.h"
 #include "encoder_new.h"
 #include "evaluate.h"
+#include "cache.h"
+#include "waiter.h"
 
 #define trcs(c) bind_textdomain_codeset("markad",c)
 #define tr(s) dgettext("markad",s)
@@ -31,6 +33,12 @@ extern "C" {
 
 #define MAXRANGE 120 /* range to search for start/stop marks in seconds */
 
+#define BATCH_MAX_JOBS 16  /* maximum of recordings processed in parallel by batch mode */
+#define BATCH_MAX_DEPTH 8  /* maximum depth of sub directories searched for recordings by batch mode */
+#define BATCH_POLL_TIME 5  /* seconds between two checks of the spool directory in serve mode */
+#define CUT_MAX_JOBS 16    /* maximum of segments encoded in parallel by --fullencode */
+#define READ_LIMIT_MAX 1000 /* maximum value of --readlimit in MB/s */
+
 
 /**
  * send OSD message to VDR
@@ -100,7 +108,7 @@ class cMarkAdStandalone {
             framecnt1 = origin.framecnt1;
             framecnt2 = origin.framecnt2;
             gotendmark = origin.gotendmark;
-            waittime = origin.waittime;
+            waittime_ms = origin.waittime_ms;
             iwaittime = origin.iwaittime;
             bDecodeVideo = origin.bDecodeVideo;
             bDecodeAudio = origin.bDecodeAudio;
@@ -111,6 +119,7 @@ class cMarkAdStandalone {
             inBroadCast = origin.inBroadCast;
             indexFile = origin.indexFile;
             sleepcnt = origin.sleepcnt;
+            recordingWaiter = NULL;
         };
 
 /**
@@ -130,7 +139,7 @@ class cMarkAdStandalone {
             framecnt2 = origin->framecnt2;
             framecnt3 = origin->framecnt3;
             gotendmark = origin->gotendmark;
-            waittime = origin->waittime;
+            waittime_ms = origin->waittime_ms;
             iwaittime = origin->iwaittime;
             bDecodeVideo = origin->bDecodeVideo;
             bDecodeAudio = origin->bDecodeAudio;
@@ -141,6 +150,7 @@ class cMarkAdStandalone {
             inBroadCast = origin->inBroadCast;
             indexFile = origin->indexFile;
             sleepcnt = origin->sleepcnt;
+            recordingWaiter = NULL;
             return *this;
         }
 
@@ -149,6 +159,12 @@ class cMarkAdStandalone {
  */
         void ProcessFiles();
 
+/**
+ * restore recording index, video infos and marks of the first pass from analysis cache
+ * @return true if analysis cache is valid, false otherwise
+ */
+        bool RestoreFromCache();
+
 /**
  * process second pass, detect overlaps
  */
@@ -170,6 +186,29 @@ class cMarkAdStandalone {
 
     private:
 
+/**
+ * cut recording without decoding, copy ts packets between the i-frame byte positions of the recording index
+ * @return true if successful, false if cut needs cDecoder and cEncoder
+ */
+        bool MarkadCutRemux();
+
+/**
+ * full encode cut with parallel encoded segments, each start/stop mark pair is encoded by its own child process
+ * into a temporary file, all segments are concatenated to the cut file
+ * @return true if successful, false if cut needs sequential encoding
+ */
+        bool MarkadCutParallel();
+
+/**
+ * encode one segment with 2 pass encoding, called in the child process
+ * @param segment           number of the segment
+ * @param startPosition     i-frame before start mark to preload decoder
+ * @param startMarkPosition frame position of the start mark
+ * @param stopMarkPosition  frame position of the stop mark
+ * @return true if successful, false otherwise
+ */
+        bool MarkadCutSegment(const int segment, const int startPosition, const int startMarkPosition, const int stopMarkPosition);
+
 /**
  * check for start mark
  */
@@ -361,7 +400,7 @@ class cMarkAdStandalone {
                                                                        //!<
         bool gotendmark = false;                                       //!< true if a valid end mark was found, false otherwise
                                                                        //!<
-        int waittime = 0;                                              //!< time waited for more frames if markad runs during recording
+        int waittime_ms = 0;                                           //!< time in ms waited for more frames if markad runs during recording
                                                                        //!<
         int iwaittime = 0;                                             //!< time waited for continuation of interrupted recording
                                                                        //!<
@@ -395,7 +434,9 @@ class cMarkAdStandalone {
                                                                        //!<
         char *indexFile = NULL;                                        //!< file name of the VDR index file
                                                                        //!<
-        int sleepcnt = 0;                                              //!< count of sleeps to wait for new frames when decode during recording
+        int sleepcnt = 0;                                              //!< count of waits without new frames when decode during recording
+                                                                       //!<
+        cRecordingWaiter *recordingWaiter = NULL;                      //!< wait for new data of a running recording
                                                                        //!<
         cMarks marks;                                                 //!< objects with all marks
                                                                        //!<
@@ -405,5 +446,7 @@ class cMarkAdStandalone {
                                                                        //!<
         cEvaluateLogoStopStartPair *evaluateLogoStopStartPair = NULL;  //!< pointer to class cEvaluateLogoStopStartPair
                                                                        //!<
+        cMarkAdCache *cache = NULL;                                    //!< persistent analysis cache, NULL if not used
+                                                                       //!<
 };
 #endif
@@ -0,0 +1,102 @@
+/*
+ * perf.cpp: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <inttypes.h>
+
+#include "perf.h"
+extern "C" {
+    #include "debug.h"
+}
+
+
+static bool perfEnabled = false;
+static int64_t perfStart = 0;
+static int64_t perfTime_ns[PERF_STAGES] = {};
+static int64_t perfCalls[PERF_STAGES] = {};
+
+static const char *perfStageName[PERF_STAGES] = {
+    "demux",
+    "decode",
+    "video_luma",
+    "video_logo",
+    "video_blackscreen",
+    "video_hborder",
+    "video_vborder",
+    "video_aspectratio",
+    "audio",
+    "logo_search",
+    "marks",
+    "overlap",
+    "encode",
+    "pass1",
+    "pass2",
+    "pass3",
+    "pass4"
+};
+
+
+void PerfEnable() {
+    perfEnabled = true;
+    perfStart = PerfNow();
+}
+
+
+bool PerfEnabled() {
+    return perfEnabled;
+}
+
+
+int64_t PerfNow() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+
+// decoder pipeline thread and corner worker threads add their times in parallel to the main thread
+//
+void PerfAdd(const int stage, const int64_t ns) {
+    if ((stage < 0) || (stage >= PERF_STAGES)) return;
+    __sync_fetch_and_add(&perfTime_ns[stage], ns);
+    __sync_fetch_and_add(&perfCalls[stage], 1);
+}
+
+
+// write report in JSON format, times of stages from different threads can overlap
+//
+bool PerfWriteReport(const char *fileName, const char *version, const char *recDir, const int passFrames[4]) {
+    if (!perfEnabled || !fileName) return false;
+    FILE *report = fopen(fileName, "w");
+    if (!report) {
+        esyslog("could not write timing report %s", fileName);
+        return false;
+    }
+    fprintf(report, "{\n");
+    fprintf(report, "  \"version\": \"%s\",\n", version ? version : "");
+    fprintf(report, "  \"recording\": \"");
+    for (const char *c = recDir; c && *c; c++) {  // escape JSON special characters
+        if ((*c == '"') || (*c == '\\')) fputc('\\', report);
+        if ((unsigned char) *c >= 0x20) fputc(*c, report);
+    }
+    fprintf(report, "\",\n");
+    fprintf(report, "  \"total_ms\": %.3f,\n", (PerfNow() - perfStart) / 1000000.0);
+    fprintf(report, "  \"frames\": {\"pass1\": %d, \"pass2\": %d, \"pass3\": %d, \"pass4\": %d},\n", passFrames[0], passFrames[1], passFrames[2], passFrames[3]);
+    fprintf(report, "  \"stages\": {\n");
+    for (int stage = 0; stage < PERF_STAGES; stage++) {
+        int64_t time_ns = perfTime_ns[stage];
+        int64_t calls = perfCalls[stage];
+        fprintf(report, "    \"%s\": {\"calls\": %" PRId64 ", \"time_ms\": %.3f, \"avg_us\": %.3f}%s\n", perfStageName[stage], calls, time_ns / 1000000.0,
+                                                                       (calls > 0) ? time_ns / 1000.0 / calls : 0, (stage < PERF_STAGES - 1) ? "," : "");
+    }
+    fprintf(report, "  }\n");
+    fprintf(report, "}\n");
+    fclose(report);
+    dsyslog("PerfWriteReport(): timing report written to %s", fileName);
+    return true;
+}
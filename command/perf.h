@@ -0,0 +1,125 @@
+/*
+ * perf.h: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#ifndef __perf_h_
+#define __perf_h_
+
+#include <stdint.h>
+
+#define PERF_FILENAME "markad.perf.json"  //!< default name of the timing report in the recording directory
+                                          //!<
+
+
+/**
+ * measured stages of markad
+ */
+enum ePerfStage {
+    PERF_DEMUX = 0,      //!< read packets from ts files
+                         //!<
+    PERF_DECODE,         //!< decode video and audio packets
+                         //!<
+    PERF_LUMA,           //!< brightness statistics of video frames
+                         //!<
+    PERF_LOGO,           //!< logo detection
+                         //!<
+    PERF_BLACKSCREEN,    //!< black screen detection
+                         //!<
+    PERF_HBORDER,        //!< horizontal border detection
+                         //!<
+    PERF_VBORDER,        //!< vertical border detection
+                         //!<
+    PERF_ASPECTRATIO,    //!< aspect ratio detection
+                         //!<
+    PERF_AUDIO,          //!< audio channel detection
+                         //!<
+    PERF_LOGO_SEARCH,    //!< search logo in recording
+                         //!<
+    PERF_MARKS,          //!< evaluation of start, stop and all other marks
+                         //!<
+    PERF_OVERLAP,        //!< overlap detection
+                         //!<
+    PERF_ENCODE,         //!< encode frames of the cut video
+                         //!<
+    PERF_PASS1,          //!< pass 1: mark detection
+                         //!<
+    PERF_PASS2,          //!< pass 2: overlap detection
+                         //!<
+    PERF_PASS3,          //!< pass 3: silence detection
+                         //!<
+    PERF_PASS4,          //!< pass 4: cut
+                         //!<
+    PERF_STAGES          //!< count of stages
+                         //!<
+};
+
+
+/**
+ * enable time measurement, without it all timers do nothing
+ */
+void PerfEnable();
+
+/**
+ * check if time measurement is enabled
+ * @return true if enabled, false otherwise
+ */
+bool PerfEnabled();
+
+/**
+ * get time of monotonic clock
+ * @return time in ns
+ */
+int64_t PerfNow();
+
+/**
+ * add used time to a stage, can be called from all threads
+ * @param stage #ePerfStage
+ * @param ns    used time in ns
+ */
+void PerfAdd(const int stage, const int64_t ns);
+
+/**
+ * write timing report as JSON
+ * @param fileName   name of the report file
+ * @param version    markad version
+ * @param recDir     recording directory
+ * @param passFrames processed frames of pass 1 to 4
+ * @return true if successful, false otherwise
+ */
+bool PerfWriteReport(const char *fileName, const char *version, const char *recDir, const int passFrames[4]);
+
+
+/**
+ * scoped timer, adds the time from construction to destruction to a stage
+ */
+class cPerfTimer {
+    public:
+
+/**
+ * start timer
+ * @param stageParam #ePerfStage
+ */
+        explicit cPerfTimer(const int stageParam) {
+            if (PerfEnabled()) {
+                stage = stageParam;
+                start = PerfNow();
+            }
+        }
+
+/**
+ * stop timer and add time to stage
+ */
+        ~cPerfTimer() {
+            if (start) PerfAdd(stage, PerfNow() - start);
+        }
+
+    private:
+        int stage = 0;      //!< stage of the timer
+                            //!<
+        int64_t start = 0;  //!< start time, 0 if time measurement is disabled
+                            //!<
+};
+#endif
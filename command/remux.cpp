@@ -0,0 +1,306 @@
+/*
+ * remux.cpp: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "remux.h"
+extern "C" {
+    #include "debug.h"
+}
+
+
+// global variables
+extern bool abortNow;
+
+
+cRemux::cRemux(const char *recDirParam) {
+    if (!recDirParam) return;
+    recDir = strdup(recDirParam);
+    ALLOC(strlen(recDir)+1, "recDir");
+    buffer = (uint8_t *) malloc(REMUX_BUFFER_PACKETS * TS_PACKET_SIZE);
+    ALLOC(REMUX_BUFFER_PACKETS * TS_PACKET_SIZE, "buffer");
+    memset(continuity, 0xFF, sizeof(continuity));
+}
+
+
+cRemux::~cRemux() {
+    if (outFile) CloseFile();
+    if (buffer) {
+        FREE(REMUX_BUFFER_PACKETS * TS_PACKET_SIZE, "buffer");
+        free(buffer);
+    }
+    if (recDir) {
+        FREE(strlen(recDir)+1, "recDir");
+        free(recDir);
+    }
+}
+
+
+// VDR starts each ts file with PAT and PMT, store them to insert them at the start of each part
+//
+bool cRemux::ReadPSI() {
+    char *tsFile = NULL;
+    if (asprintf(&tsFile, "%s/%05d.ts", recDir, 1) == -1) return false;
+    ALLOC(strlen(tsFile)+1, "tsFile");
+    FILE *in = fopen(tsFile, "r");
+    if (!in) {
+        dsyslog("cRemux::ReadPSI(): failed to open %s", tsFile);
+        FREE(strlen(tsFile)+1, "tsFile");
+        free(tsFile);
+        return false;
+    }
+    FREE(strlen(tsFile)+1, "tsFile");
+    free(tsFile);
+
+    uint8_t packet[TS_PACKET_SIZE];
+    int pmtPID = -1;
+    int pmtNeeded = 0;  // payload bytes of PMT still missing
+    psiCount = 0;
+    for (int i = 0; i < REMUX_PSI_SEARCH_PACKETS; i++) {
+        if (fread(packet, 1, TS_PACKET_SIZE, in) != TS_PACKET_SIZE) break;
+        if (packet[0] != TS_SYNC_BYTE) break;
+        int pid = ((packet[1] & 0x1F) << 8) | packet[2];
+        bool unitStart = packet[1] & 0x40;
+        int payload = 4;
+        if (packet[3] & 0x20) payload = 5 + packet[4];
+        if (!(packet[3] & 0x10) || (payload >= TS_PACKET_SIZE)) continue;
+
+        if ((pid == 0) && unitStart && (pmtPID < 0)) {  // PAT
+            int section = payload + 1 + packet[payload];
+            if ((section + 8 > TS_PACKET_SIZE) || (packet[section] != 0x00)) continue;
+            int sectionEnd = section + 3 + (((packet[section + 1] & 0x0F) << 8) | packet[section + 2]) - 4;  // without CRC
+            if (sectionEnd > TS_PACKET_SIZE) sectionEnd = TS_PACKET_SIZE;
+            for (int program = section + 8; program + 4 <= sectionEnd; program += 4) {
+                int programNumber = (packet[program] << 8) | packet[program + 1];
+                if (programNumber == 0) continue;  // network PID
+                pmtPID = ((packet[program + 2] & 0x1F) << 8) | packet[program + 3];
+                break;
+            }
+            if (pmtPID < 0) continue;
+            memcpy(psi[psiCount], packet, TS_PACKET_SIZE);
+            psiCount++;
+            dsyslog("cRemux::ReadPSI(): PAT found in packet %d, PMT PID %d", i, pmtPID);
+        }
+        else if ((pid == pmtPID) && (pmtPID > 0)) {  // PMT, can be splitted over more than one packet
+            if (unitStart && (pmtNeeded == 0) && (psiCount == 1)) {
+                int section = payload + 1 + packet[payload];
+                if ((section + 3 > TS_PACKET_SIZE) || (packet[section] != 0x02)) continue;
+                pmtNeeded = section + 3 + (((packet[section + 1] & 0x0F) << 8) | packet[section + 2]) - payload;
+            }
+            else if (unitStart || (pmtNeeded == 0)) continue;
+            if (psiCount >= REMUX_PSI_PACKETS) break;
+            memcpy(psi[psiCount], packet, TS_PACKET_SIZE);
+            psiCount++;
+            pmtNeeded -= TS_PACKET_SIZE - payload;
+            if (pmtNeeded <= 0) {
+                dsyslog("cRemux::ReadPSI(): PMT found in %d packet(s)", psiCount - 1);
+                fclose(in);
+                return true;
+            }
+        }
+    }
+    fclose(in);
+    dsyslog("cRemux::ReadPSI(): no complete PAT and PMT found at start of recording");
+    psiCount = 0;
+    return false;
+}
+
+
+bool cRemux::OpenFile() {
+    if (!recDir || !buffer) return false;
+    if (outFile) return true;
+
+    // cut file is <recording name>.ts in the recording directory, same name as from cEncoder::OpenFile()
+    const char *datePart = strrchr(recDir, '/');
+    if (!datePart || (datePart == recDir)) {
+        dsyslog("cRemux::OpenFile(): faild to find last '/'");
+        return false;
+    }
+    const char *cutName = datePart - 1;
+    while ((cutName > recDir) && (*cutName != '/')) cutName--;
+    if (*cutName != '/') {
+        dsyslog("cRemux::OpenFile(): faild to find '/' before date part");
+        return false;
+    }
+    cutName++;   // ignore first char = /
+
+    char *filename = NULL;
+    if (asprintf(&filename, "%s/%.*s.ts", recDir, static_cast<int>(datePart - cutName), cutName) == -1) {
+        dsyslog("cRemux::OpenFile(): failed to allocate string, out of memory?");
+        return false;
+    }
+    ALLOC(strlen(filename)+1, "filename");
+    dsyslog("cRemux::OpenFile(): write to '%s'", filename);
+    outFile = fopen(filename, "w");
+    if (!outFile) dsyslog("cRemux::OpenFile(): could not open output file '%s'", filename);
+    FREE(strlen(filename)+1, "filename");
+    free(filename);
+    bytesWritten = 0;
+    return (outFile != NULL);
+}
+
+
+bool cRemux::CopyPart(const int startFileNumber, const int64_t startPos, const int stopFileNumber, const int64_t stopPos, const int64_t ptsOffset) {
+    if (!outFile) return false;
+    if ((startPos < 0) || (startPos % TS_PACKET_SIZE) || ((stopPos >= 0) && (stopPos % TS_PACKET_SIZE)) || (stopFileNumber < startFileNumber)) {
+        dsyslog("cRemux::CopyPart(): invalid part from file %d position %" PRId64 " to file %d position %" PRId64, startFileNumber, startPos, stopFileNumber, stopPos);
+        return false;
+    }
+
+    // new part starts with PAT and PMT
+    if ((psiCount == 0) && !ReadPSI()) return false;
+    for (int i = 0; i < psiCount; i++) {
+        uint8_t packet[TS_PACKET_SIZE];
+        memcpy(packet, psi[i], TS_PACKET_SIZE);
+        RewritePacket(packet, 0);
+        if (fwrite(packet, 1, TS_PACKET_SIZE, outFile) != TS_PACKET_SIZE) return false;
+        bytesWritten += TS_PACKET_SIZE;
+    }
+
+    for (int fileNumber = startFileNumber; fileNumber <= stopFileNumber; fileNumber++) {
+        char *tsFile = NULL;
+        if (asprintf(&tsFile, "%s/%05d.ts", recDir, fileNumber) == -1) return false;
+        ALLOC(strlen(tsFile)+1, "tsFile");
+        FILE *in = fopen(tsFile, "r");
+        if (!in) dsyslog("cRemux::CopyPart(): failed to open %s", tsFile);
+        FREE(strlen(tsFile)+1, "tsFile");
+        free(tsFile);
+        if (!in) return false;
+
+        int64_t pos = (fileNumber == startFileNumber) ? startPos : 0;
+        int64_t end = (fileNumber == stopFileNumber) ? stopPos : -1;
+        if (fseeko(in, pos, SEEK_SET) != 0) {
+            dsyslog("cRemux::CopyPart(): failed to seek to position %" PRId64 " in file %d", pos, fileNumber);
+            fclose(in);
+            return false;
+        }
+        while (!abortNow) {
+            size_t want = REMUX_BUFFER_PACKETS * TS_PACKET_SIZE;
+            if (end >= 0) {
+                if (pos >= end) break;
+                if (end - pos < static_cast<int64_t>(want)) want = end - pos;
+            }
+            size_t got = fread(buffer, 1, want, in);
+            got -= got % TS_PACKET_SIZE;  // ignore incomplete packet at end of file
+            if (got == 0) break;
+            if (buffer[0] != TS_SYNC_BYTE) {
+                dsyslog("cRemux::CopyPart(): lost sync at position %" PRId64 " in file %d", pos, fileNumber);
+                fclose(in);
+                return false;
+            }
+            for (size_t offset = 0; offset < got; offset += TS_PACKET_SIZE) RewritePacket(buffer + offset, ptsOffset);
+            if (fwrite(buffer, 1, got, outFile) != got) {
+                dsyslog("cRemux::CopyPart(): write to output file failed");
+                fclose(in);
+                return false;
+            }
+            pos += got;
+            bytesWritten += got;
+        }
+        fclose(in);
+    }
+    return !abortNow;
+}
+
+
+// ts files written by libavformat start with their own PAT and PMT, copy them unchanged
+//
+bool cRemux::AppendFile(const char *fileName, const int64_t ptsOffset) {
+    if (!outFile || !fileName) return false;
+    FILE *in = fopen(fileName, "r");
+    if (!in) {
+        dsyslog("cRemux::AppendFile(): failed to open %s", fileName);
+        return false;
+    }
+    bool success = true;
+    while (!abortNow) {
+        size_t got = fread(buffer, 1, REMUX_BUFFER_PACKETS * TS_PACKET_SIZE, in);
+        got -= got % TS_PACKET_SIZE;
+        if (got == 0) break;
+        for (size_t offset = 0; offset < got; offset += TS_PACKET_SIZE) RewritePacket(buffer + offset, ptsOffset);
+        if (fwrite(buffer, 1, got, outFile) != got) {
+            dsyslog("cRemux::AppendFile(): write to output file failed");
+            success = false;
+            break;
+        }
+        bytesWritten += got;
+    }
+    fclose(in);
+    return success && !abortNow;
+}
+
+
+bool cRemux::CloseFile() {
+    if (!outFile) return false;
+    bool ok = (fclose(outFile) == 0);
+    outFile = NULL;
+    dsyslog("cRemux::CloseFile(): %" PRId64 " bytes written", bytesWritten);
+    return ok;
+}
+
+
+// make continuity counter continuous over the cuts and move timestamps of the part to the end of the part before
+//
+void cRemux::RewritePacket(uint8_t *packet, const int64_t ptsOffset) {
+    if (packet[0] != TS_SYNC_BYTE) return;
+    int pid = ((packet[1] & 0x1F) << 8) | packet[2];
+    if (pid == 0x1FFF) return;  // null packet
+    bool hasPayload = packet[3] & 0x10;
+    bool hasAdaptation = packet[3] & 0x20;
+
+    // continuity counter is only incremented for packets with payload
+    if (hasPayload) {
+        if (continuity[pid] == 0xFF) continuity[pid] = packet[3] & 0x0F;
+        else continuity[pid] = (continuity[pid] + 1) & 0x0F;
+        packet[3] = (packet[3] & 0xF0) | continuity[pid];
+    }
+    if (ptsOffset == 0) return;
+
+    int payload = 4;
+    if (hasAdaptation) {
+        int adaptationLength = packet[4];
+        if ((adaptationLength >= 7) && (packet[5] & 0x10)) {  // PCR, 33 bit base in 90kHz, 6 reserved bits, 9 bit extension
+            int64_t pcrBase = ((int64_t) packet[6] << 25) | (packet[7] << 17) | (packet[8] << 9) | (packet[9] << 1) | (packet[10] >> 7);
+            pcrBase = (pcrBase - ptsOffset) & 0x1FFFFFFFFLL;
+            packet[6] = (pcrBase >> 25) & 0xFF;
+            packet[7] = (pcrBase >> 17) & 0xFF;
+            packet[8] = (pcrBase >> 9) & 0xFF;
+            packet[9] = (pcrBase >> 1) & 0xFF;
+            packet[10] = ((pcrBase & 0x01) << 7) | (packet[10] & 0x7F);
+        }
+        payload = 5 + adaptationLength;
+    }
+
+    // PES header with PTS/DTS is at the start of the payload
+    if (!hasPayload || !(packet[1] & 0x40) || (payload + 14 > TS_PACKET_SIZE)) return;
+    uint8_t *pes = packet + payload;
+    if ((pes[0] != 0x00) || (pes[1] != 0x00) || (pes[2] != 0x01)) return;
+    switch (pes[3]) {  // stream id without optional PES header
+        case 0xBC: case 0xBE: case 0xBF: case 0xF0: case 0xF1: case 0xF2: case 0xF8: case 0xFF:
+            return;
+        default:
+            break;
+    }
+    if ((pes[6] & 0xC0) != 0x80) return;  // no MPEG-2 PES header
+    int ptsDtsFlags = pes[7] >> 6;
+    if (ptsDtsFlags & 0x02) RewriteTimestamp(pes + 9, ptsOffset);
+    if ((ptsDtsFlags == 0x03) && (payload + 19 <= TS_PACKET_SIZE)) RewriteTimestamp(pes + 14, ptsOffset);
+}
+
+
+void cRemux::RewriteTimestamp(uint8_t *field, const int64_t ptsOffset) {
+    int64_t timestamp = ((int64_t) (field[0] & 0x0E) << 29) | (field[1] << 22) | ((field[2] & 0xFE) << 14) | (field[3] << 7) | (field[4] >> 1);
+    timestamp = (timestamp - ptsOffset) & 0x1FFFFFFFFLL;
+    field[0] = (field[0] & 0xF1) | ((timestamp >> 29) & 0x0E);
+    field[1] = (timestamp >> 22) & 0xFF;
+    field[2] = ((timestamp >> 14) & 0xFE) | 0x01;
+    field[3] = (timestamp >> 7) & 0xFF;
+    field[4] = ((timestamp << 1) & 0xFE) | 0x01;
+}
@@ -0,0 +1,136 @@
+/*
+ * remux.h: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#ifndef __remux_h_
+#define __remux_h_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define TS_PACKET_SIZE 188            //!< size of a MPEG transport stream packet
+                                      //!<
+#define TS_SYNC_BYTE 0x47             //!< first byte of each transport stream packet
+                                      //!<
+#define TS_MAX_PID 8192               //!< number of possible PIDs in a transport stream
+                                      //!<
+#define REMUX_BUFFER_PACKETS 2048     //!< number of transport stream packets read and written at once
+                                      //!<
+#define REMUX_PSI_SEARCH_PACKETS 4096 //!< number of packets at the start of the recording to search for PAT and PMT
+                                      //!<
+#define REMUX_PSI_PACKETS 8           //!< maximum number of PAT and PMT packets inserted at the start of each part
+                                      //!<
+
+
+/**
+ * cut recording without decoding <br>
+ * copy whole transport stream packets between i-frame byte positions of the recording index,
+ * continue PCR/PTS/DTS and continuity counters across the cuts and insert PAT/PMT at the start of each part <br>
+ * also used to concatenate segments encoded in parallel
+ */
+class cRemux {
+    public:
+
+/**
+ * constructor of the remux class
+ * @param recDirParam recording directory
+ */
+        explicit cRemux(const char *recDirParam);
+
+        ~cRemux();
+
+/**
+ * copy constructor, not used, only for formal reason
+ */
+        cRemux(const cRemux &origin) {
+            recDir = NULL;
+            outFile = NULL;
+            buffer = NULL;
+            psiCount = 0;
+            bytesWritten = origin.bytesWritten;
+        };
+
+/**
+ * operator=, not used, only for formal reason
+ */
+        cRemux &operator =(const cRemux *origin) {
+            recDir = NULL;
+            outFile = NULL;
+            buffer = NULL;
+            psiCount = 0;
+            bytesWritten = origin->bytesWritten;
+            return *this;
+        }
+
+/**
+ * open cut output file in the recording directory
+ * @return true if successful, false otherwise
+ */
+        bool OpenFile();
+
+/**
+ * copy one part of the recording to the output file, PAT/PMT are read from the first ts file of the recording
+ * @param startFileNumber number of the ts file with the first packet of the part
+ * @param startPos        byte position of the first packet of the part
+ * @param stopFileNumber  number of the ts file with the end of the part
+ * @param stopPos         byte position after the last packet of the part, -1 to copy up to the end of the ts file
+ * @param ptsOffset       offset in 90kHz ticks to subtract from all PCR, PTS and DTS of this part
+ * @return true if successful, false otherwise
+ */
+        bool CopyPart(const int startFileNumber, const int64_t startPos, const int stopFileNumber, const int64_t stopPos, const int64_t ptsOffset);
+
+/**
+ * append a complete ts file to the output file
+ * @param fileName  name of the ts file
+ * @param ptsOffset offset in 90kHz ticks to subtract from all PCR, PTS and DTS of this file
+ * @return true if successful, false otherwise
+ */
+        bool AppendFile(const char *fileName, const int64_t ptsOffset);
+
+/**
+ * close output file
+ * @return true if all data are written, false otherwise
+ */
+        bool CloseFile();
+
+    private:
+
+/**
+ * read PAT and PMT packets from the start of the first ts file
+ * @return true if PAT and PMT found, false otherwise
+ */
+        bool ReadPSI();
+
+/**
+ * rewrite continuity counter, PCR, PTS and DTS of a transport stream packet
+ * @param packet    transport stream packet
+ * @param ptsOffset offset in 90kHz ticks to subtract
+ */
+        void RewritePacket(uint8_t *packet, const int64_t ptsOffset);
+
+/**
+ * subtract offset from a PTS or DTS in a PES header
+ * @param field     5 byte timestamp field
+ * @param ptsOffset offset in 90kHz ticks to subtract
+ */
+        static void RewriteTimestamp(uint8_t *field, const int64_t ptsOffset);
+
+        char *recDir = NULL;                 //!< recording directory
+                                             //!<
+        FILE *outFile = NULL;                //!< cut output file
+                                             //!<
+        uint8_t *buffer = NULL;              //!< read/write buffer of #REMUX_BUFFER_PACKETS packets
+                                             //!<
+        uint8_t psi[REMUX_PSI_PACKETS][TS_PACKET_SIZE] = {};  //!< PAT and PMT packets
+                                                              //!<
+        int psiCount = 0;                    //!< number of stored PAT and PMT packets
+                                             //!<
+        uint8_t continuity[TS_MAX_PID] = {}; //!< last continuity counter of each PID in the output file, 0xFF if PID not yet written
+                                             //!<
+        int64_t bytesWritten = 0;            //!< bytes written to output file
+                                             //!<
+};
+#endif
@@ -6,10 +6,16 @@
  */
 
 #include <time.h>
+#include <pthread.h>
 #include <math.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 extern "C" {
     #include "debug.h"
@@ -17,11 +23,43 @@ extern "C" {
 
 #include "video.h"
 #include "logo.h"
+#include "perf.h"
+#include "logodb.h"
 
 
 // global variables
 extern bool abortNow;
 
+
+/**
+ * logo file preloaded into memory
+ */
+struct sLogoFile {
+    char *path = NULL;  //!< full path of the logo file
+                        //!<
+    char *data = NULL;  //!< content of the logo file
+                        //!<
+    size_t size = 0;    //!< size of the logo file
+                        //!<
+    time_t mtime = 0;   //!< modification time of the logo file
+                        //!<
+};
+static std::vector<sLogoFile> logoFiles;  // preloaded logo files, only used in batch mode
+static std::vector<cLogoDB *> logoDBs;    // mapped logo databases, one for each used directory
+
+
+// get logo database of a directory, keep the mapping of each directory to prevent a remap if recording directory and logo directory are used alternately
+//
+static cLogoDB *GetLogoDB(const char *directory) {
+    for (std::vector<cLogoDB *>::iterator logoDB = logoDBs.begin(); logoDB != logoDBs.end(); ++logoDB) {
+        if ((*logoDB)->GetDirectory() && (strcmp((*logoDB)->GetDirectory(), directory) == 0)) return *logoDB;
+    }
+    cLogoDB *logoDB = new cLogoDB();
+    ALLOC(sizeof(*logoDB), "logoDB");
+    logoDBs.push_back(logoDB);
+    return logoDB;
+}
+
 cLogoSize::cLogoSize() {
 }
 
@@ -155,6 +193,7 @@ void cMarkAdLogo::Clear(const bool isRestart, const bool inBroadCast) {
         delete area.result;
         area.result = NULL;
     }
+    for (int plane = 0; plane < PLANES; plane++) FreeMaskBlack(plane);
     area = {};
 
     if (isRestart) { // reset valid logo status after restart
@@ -173,6 +212,68 @@ sAreaT * cMarkAdLogo::GetArea() {
 void cMarkAdLogo::SetLogoSize(const int width, const int height) {
     logoWidth = width;
     logoHeight = height;
+    for (int plane = 0; plane < PLANES; plane++) FreeMaskBlack(plane);
+}
+
+
+// read all logo files into memory, child processes of batch mode inherit them without reading the files again
+//
+int cMarkAdLogo::PreloadLogoFiles(const char *directory) {
+    if (!directory) return 0;
+    DIR *dir = opendir(directory);
+    if (!dir) return 0;
+    struct dirent *dirent = NULL;
+    while ((dirent = readdir(dir))) {
+        int len = strlen(dirent->d_name);
+        if ((len < 4) || (strcmp(dirent->d_name + len - 4, ".pgm") != 0)) continue;
+        sLogoFile logoFile;
+        if (asprintf(&logoFile.path, "%s/%s", directory, dirent->d_name) == -1) continue;
+        ALLOC(strlen(logoFile.path)+1, "logoFile.path");
+        FILE *pFile = fopen(logoFile.path, "rb");
+        if (pFile) {
+            struct stat statbuf;
+            if ((fstat(fileno(pFile), &statbuf) == 0) && (statbuf.st_size > 0)) {
+                logoFile.size = statbuf.st_size;
+                logoFile.mtime = statbuf.st_mtime;
+                logoFile.data = new char[logoFile.size];
+                ALLOC(sizeof(char) * logoFile.size, "logoFile.data");
+                if (fread(logoFile.data, 1, logoFile.size, pFile) == logoFile.size) {
+                    logoFiles.push_back(logoFile);
+                    logoFile.path = NULL;
+                    logoFile.data = NULL;
+                }
+            }
+            fclose(pFile);
+        }
+        if (logoFile.data) {
+            FREE(sizeof(char) * logoFile.size, "logoFile.data");
+            delete[] logoFile.data;
+        }
+        if (logoFile.path) {
+            FREE(strlen(logoFile.path)+1, "logoFile.path");
+            free(logoFile.path);
+        }
+    }
+    closedir(dir);
+    GetLogoDB(directory)->Open(directory);
+    dsyslog("cMarkAdLogo::PreloadLogoFiles(): %d logo files from %s preloaded", static_cast<int> (logoFiles.size()), directory);
+    return logoFiles.size();
+}
+
+
+// use preloaded logo file only if it is unchanged, a batch server runs for a long time and the logo cache can be updated meanwhile
+//
+FILE *cMarkAdLogo::OpenLogoFile(const char *path) {
+    for (std::vector<sLogoFile>::iterator logoFile = logoFiles.begin(); logoFile != logoFiles.end(); ++logoFile) {
+        if (strcmp(logoFile->path, path) != 0) continue;
+        struct stat statbuf;
+        if ((stat(path, &statbuf) == 0) && (static_cast<size_t>(statbuf.st_size) == logoFile->size) && (statbuf.st_mtime == logoFile->mtime)) {
+            return fmemopen(logoFile->data, logoFile->size, "rb");
+        }
+        dsyslog("cMarkAdLogo::OpenLogoFile(): preloaded logo file %s has changed, read it again", path);
+        break;
+    }
+    return fopen(path, "rb");
 }
 
 
@@ -184,47 +285,66 @@ int cMarkAdLogo::Load(const char *directory, const char *file, const int plane)
         return -3;
     }
     dsyslog("cMarkAdLogo::Load(): try to find logo %s plane %d in %s", file, plane, directory);
+    area.valid[plane] = false;
+    FreeMaskBlack(plane);
+
+    // use logo database if there is one in this directory, PGM files otherwise
+    FILE *pFile = NULL;
+    int width = 0;
+    int height = 0;
+    char c = 0;
+    const sLogoDBEntry *dbEntry = NULL;
+    cLogoDB *logoDB = GetLogoDB(directory);
+    if (logoDB->Open(directory)) {
+        dbEntry = logoDB->Find(file);
+        if (dbEntry && !dbEntry->plane[plane].offset) dbEntry = NULL;  // plane not in database
+    }
+    if (dbEntry) {
+        dsyslog("cMarkAdLogo::Load(): logo %s plane %d found in logo database of %s", file, plane, directory);
+        if (dbEntry->flags & LOGODB_FLAG_DOLBY) c = 'D';
+        area.corner = dbEntry->corner;
+        area.mPixel[plane] = dbEntry->plane[plane].pixel;
+        width = dbEntry->plane[plane].width;
+        height = dbEntry->plane[plane].height;
+    }
+    else {
+        char *path;
+        if (asprintf(&path, "%s/%s-P%i.pgm", directory, file, plane) == -1) return -3;
+        ALLOC(strlen(path)+1, "path");
 
-    char *path;
-    if (asprintf(&path, "%s/%s-P%i.pgm", directory, file, plane) == -1) return -3;
-    ALLOC(strlen(path)+1, "path");
+        // Load mask
+        pFile = OpenLogoFile(path);
+        FREE(strlen(path)+1, "path");
+        free(path);
+        if (!pFile) {
+            dsyslog("cMarkAdLogo::Load(): file not found for logo %s plane %d in %s",file, plane, directory);
+            return -1;
+        }
+        else dsyslog("cMarkAdLogo::Load(): file found for logo %s plane %d in %s",file, plane, directory);
 
-    // Load mask
-    FILE *pFile;
-    area.valid[plane] = false;
-    pFile=fopen(path, "rb");
-    FREE(strlen(path)+1, "path");
-    free(path);
-    if (!pFile) {
-        dsyslog("cMarkAdLogo::Load(): file not found for logo %s plane %d in %s",file, plane, directory);
-        return -1;
-    }
-    else dsyslog("cMarkAdLogo::Load(): file found for logo %s plane %d in %s",file, plane, directory);
-
-    int width,height;
-    char c;
-    if (fscanf(pFile, "P5\n#%1c%1i %4i\n%3d %3d\n255\n#", &c, &area.corner, &area.mPixel[plane], &width, &height) != 5) {
-        fclose(pFile);
-        esyslog("format error in %s", file);
-        return -2;
+        if (fscanf(pFile, "P5\n#%1c%1i %4i\n%3d %3d\n255\n#", &c, &area.corner, &area.mPixel[plane], &width, &height) != 5) {
+            fclose(pFile);
+            esyslog("format error in %s", file);
+            return -2;
+        }
+        if (height == 255) {
+            height = width;
+            width = area.mPixel[plane];
+            area.mPixel[plane] = 0;
+        }
     }
     if (c == 'D') maContext->Audio.Options.ignoreDolbyDetection = true;
 
-    if (height == 255) {
-        height = width;
-        width = area.mPixel[plane];
-        area.mPixel[plane] = 0;
-    }
     sLogoSize MaxLogoSize = GetMaxLogoSize(maContext->Video.Info.width);
     if ((width <= 0) || (height <= 0) || (width > MaxLogoSize.width) || (height > MaxLogoSize.height) || (area.corner < TOP_LEFT) || (area.corner > BOTTOM_RIGHT)) {
-        fclose(pFile);
+        if (pFile) fclose(pFile);
         esyslog("format error in %s", file);
         return -2;
     }
 
     // alloc memory for mask planes (logo)
+    int maxLogoPixel = GetMaxLogoPixel(maContext->Video.Info.width);
     if (plane == 0) {
-        int maxLogoPixel = GetMaxLogoPixel(maContext->Video.Info.width);
         if (area.mask) {
             FREE(sizeof(uchar*) * PLANES * sizeof(uchar) * maxLogoPixel, "area.mask");
             for (int planeTMP = 0; planeTMP < PLANES; planeTMP++) {
@@ -239,13 +359,21 @@ int cMarkAdLogo::Load(const char *directory, const char *file, const int plane)
         }
         ALLOC(sizeof(uchar*) * PLANES * sizeof(uchar) * maxLogoPixel, "area.mask");
     }
-    // read logo from file
-    if (fread(area.mask[plane], 1, width * height, pFile) != (size_t)(width * height)) {
+    // read logo from database or file
+    if (dbEntry) {
+        if (!logoDB->GetMask(dbEntry, plane, area.mask[plane], maxLogoPixel)) {
+            esyslog("format error in logo database for %s", file);
+            return -2;
+        }
+    }
+    else {
+        if (fread(area.mask[plane], 1, width * height, pFile) != (size_t)(width * height)) {
+            fclose(pFile);
+            esyslog("format error in %s", file);
+            return -2;
+        }
         fclose(pFile);
-        esyslog("format error in %s", file);
-        return -2;
     }
-    fclose(pFile);
 
     if (area.mPixel[plane] == 0) {
         for (int i = 0; i < width * height; i++) {
@@ -696,6 +824,221 @@ int cMarkAdLogo::ReduceBrightness(__attribute__((unused)) const int frameNumber,
 }
 
 
+// sobel transform of pixel xFrom to xTo of one line, scalar version
+// line: pointer to the first pixel of the line in the plane
+//
+void cMarkAdLogo::SobelLine(const uchar *line, const int linesize, const int xFrom, const int xTo, const int cutval, uchar *sobelLine) {
+    for (int X = xFrom; X <= xTo; X++) {
+        int sumX = 0;
+        int sumY = 0;
+        // X Gradient approximation
+        for (int I = -1; I <= 1; I++) {
+            for (int J = -1; J <= 1; J++) {
+                sumX = sumX + static_cast<int> ((*(line + X + I + J * linesize)) * GX[I + 1][J + 1]);
+            }
+        }
+
+        // Y Gradient approximation
+        for (int I = -1; I <= 1; I++) {
+            for (int J = -1; J <= 1; J++) {
+                sumY = sumY + static_cast<int> ((*(line + X + I + J * linesize)) * GY[I + 1][J + 1]);
+            }
+        }
+
+        // Gradient Magnitude approximation
+        int SUM = abs(sumX) + abs(sumY);
+        if (SUM >= cutval) SUM = 255;
+        if (SUM < cutval) SUM = 0;
+        sobelLine[X] = 255 - (uchar) SUM;
+    }
+}
+
+
+#if defined(__x86_64__) || defined(__i386__)
+// sobel transform of <count> pixel of one line, SSE2 version, same result as cMarkAdLogo::SobelLine()
+// GX mask is (line below - line above) weighted 1 2 1, GY mask is (left column - right column) weighted 1 2 1
+// all values fit into 16 bit: |sumX| + |sumY| <= 2040
+// src: pointer to first pixel to transform
+// return: number of transformed pixel (multiple of 16)
+//
+__attribute__((target("sse2"))) static int SobelLineSSE2(const uchar *src, const int linesize, const int count, const int cutval, uchar *dst) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i cut  = _mm_set1_epi16(cutval - 1);
+    const __m128i ones = _mm_set1_epi8(-1);
+    int done = 0;
+    for (; done + 16 <= count; done += 16) {
+        const uchar *p = src + done;
+        __m128i up[3], mid[3], down[3];
+        for (int i = 0; i < 3; i++) {
+            up[i]   = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p - linesize + i - 1));
+            mid[i]  = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i - 1));
+            down[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + linesize + i - 1));
+        }
+        __m128i sobel[2];
+        for (int half = 0; half < 2; half++) {
+            __m128i u[3], m[3], d[3];
+            for (int i = 0; i < 3; i++) {
+                u[i] = half ? _mm_unpackhi_epi8(up[i], zero)   : _mm_unpacklo_epi8(up[i], zero);
+                m[i] = half ? _mm_unpackhi_epi8(mid[i], zero)  : _mm_unpacklo_epi8(mid[i], zero);
+                d[i] = half ? _mm_unpackhi_epi8(down[i], zero) : _mm_unpacklo_epi8(down[i], zero);
+            }
+            __m128i sumUp    = _mm_add_epi16(_mm_add_epi16(u[0], u[2]), _mm_slli_epi16(u[1], 1));
+            __m128i sumDown  = _mm_add_epi16(_mm_add_epi16(d[0], d[2]), _mm_slli_epi16(d[1], 1));
+            __m128i sumLeft  = _mm_add_epi16(_mm_add_epi16(u[0], d[0]), _mm_slli_epi16(m[0], 1));
+            __m128i sumRight = _mm_add_epi16(_mm_add_epi16(u[2], d[2]), _mm_slli_epi16(m[2], 1));
+            __m128i sumX = _mm_sub_epi16(sumDown, sumUp);
+            __m128i sumY = _mm_sub_epi16(sumLeft, sumRight);
+            sumX = _mm_max_epi16(sumX, _mm_sub_epi16(zero, sumX));
+            sumY = _mm_max_epi16(sumY, _mm_sub_epi16(zero, sumY));
+            sobel[half] = _mm_cmpgt_epi16(_mm_add_epi16(sumX, sumY), cut);  // 0xFFFF if SUM >= cutval
+        }
+        __m128i edge = _mm_packs_epi16(sobel[0], sobel[1]);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + done), _mm_xor_si128(edge, ones));  // 0 on edge, 255 otherwise
+    }
+    return done;
+}
+
+
+// sobel transform of <count> pixel of one line, AVX2 version, same result as cMarkAdLogo::SobelLine()
+// return: number of transformed pixel (multiple of 16)
+//
+__attribute__((target("avx2"))) static int SobelLineAVX2(const uchar *src, const int linesize, const int count, const int cutval, uchar *dst) {
+    const __m256i cut  = _mm256_set1_epi16(cutval - 1);
+    const __m128i ones = _mm_set1_epi8(-1);
+    int done = 0;
+    for (; done + 16 <= count; done += 16) {
+        const uchar *p = src + done;
+        __m256i u[3], m[3], d[3];
+        for (int i = 0; i < 3; i++) {
+            u[i] = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p - linesize + i - 1)));
+            m[i] = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i - 1)));
+            d[i] = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p + linesize + i - 1)));
+        }
+        __m256i sumUp    = _mm256_add_epi16(_mm256_add_epi16(u[0], u[2]), _mm256_slli_epi16(u[1], 1));
+        __m256i sumDown  = _mm256_add_epi16(_mm256_add_epi16(d[0], d[2]), _mm256_slli_epi16(d[1], 1));
+        __m256i sumLeft  = _mm256_add_epi16(_mm256_add_epi16(u[0], d[0]), _mm256_slli_epi16(m[0], 1));
+        __m256i sumRight = _mm256_add_epi16(_mm256_add_epi16(u[2], d[2]), _mm256_slli_epi16(m[2], 1));
+        __m256i sum = _mm256_add_epi16(_mm256_abs_epi16(_mm256_sub_epi16(sumDown, sumUp)), _mm256_abs_epi16(_mm256_sub_epi16(sumLeft, sumRight)));
+        __m256i edge = _mm256_cmpgt_epi16(sum, cut);  // 0xFFFF if SUM >= cutval
+        __m128i edge8 = _mm_packs_epi16(_mm256_castsi256_si128(edge), _mm256_extracti128_si256(edge, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + done), _mm_xor_si128(edge8, ones));  // 0 on edge, 255 otherwise
+    }
+    return done;
+}
+#endif
+
+
+// pack black pixel into bit map, use SSE2 to test 16 pixel at once
+// return: false if a pixel is neither black nor white
+//
+bool cMarkAdLogo::PackBlackPixel(const uchar *pixel, const int count, uint64_t *bits) {
+    if (!pixel) return false;
+    if (!bits) return false;
+    memset(bits, 0, sizeof(uint64_t) * ((count + 63) / 64));
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i black = _mm_setzero_si128();
+    const __m128i white = _mm_set1_epi8(static_cast<char>(255));
+    for (; i + 16 <= count; i += 16) {
+        __m128i pixel16 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixel + i));
+        unsigned int isBlack = _mm_movemask_epi8(_mm_cmpeq_epi8(pixel16, black));
+        unsigned int isWhite = _mm_movemask_epi8(_mm_cmpeq_epi8(pixel16, white));
+        if ((isBlack | isWhite) != 0xFFFF) return false;
+        bits[i / 64] |= static_cast<uint64_t>(isBlack) << (i % 64);
+    }
+#endif
+    for (; i < count; i++) {
+        if (pixel[i] == 0) bits[i / 64] |= static_cast<uint64_t>(1) << (i % 64);
+        else if (pixel[i] != 255) return false;
+    }
+    return true;
+}
+
+
+const uint64_t *cMarkAdLogo::GetMaskBlack(const int plane, const int count, const int lines, const int stride) {
+    if (area.maskBlackValid[plane] && (area.maskBlackCorner[plane] == area.corner)) return area.maskBlack[plane];
+    FreeMaskBlack(plane);
+    area.maskBlackValid[plane] = true;
+    area.maskBlackCorner[plane] = area.corner;
+    if (!area.mask || (count <= 0) || (lines <= 0)) return NULL;
+
+    int wordsPerLine = (count + 63) / 64;
+    area.maskBlackSize[plane] = lines * wordsPerLine;
+    area.maskBlack[plane] = new uint64_t[area.maskBlackSize[plane]];
+    ALLOC(sizeof(uint64_t) * area.maskBlackSize[plane], "area.maskBlack");
+    for (int line = 0; line < lines; line++) {
+        if (!PackBlackPixel(area.mask[plane] + line * stride, count, area.maskBlack[plane] + line * wordsPerLine)) {  // mask is not black and white, use byte compare
+            FreeMaskBlack(plane);
+            area.maskBlackValid[plane] = true;
+            area.maskBlackCorner[plane] = area.corner;
+            return NULL;
+        }
+    }
+    return area.maskBlack[plane];
+}
+
+
+void cMarkAdLogo::FreeMaskBlack(const int plane) {
+    if (area.maskBlack[plane]) {
+        FREE(sizeof(uint64_t) * area.maskBlackSize[plane], "area.maskBlack");
+        delete[] area.maskBlack[plane];
+        area.maskBlack[plane] = NULL;
+    }
+    area.maskBlackSize[plane] = 0;
+    area.maskBlackValid[plane] = false;
+}
+
+
+// select fastest sobel line transformation supported by the CPU, only once per process
+// logo search calls this from more than one thread, use pthread_once
+//
+typedef int (*tSobelLineSIMD)(const uchar *src, const int linesize, const int count, const int cutval, uchar *dst);
+static tSobelLineSIMD sobelLineSIMD = NULL;
+static pthread_once_t sobelCPUChecked = PTHREAD_ONCE_INIT;
+
+static void SobelInitCPU() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        sobelLineSIMD = SobelLineAVX2;
+        dsyslog("SobelInitCPU(): use AVX2 sobel transformation");
+        return;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        sobelLineSIMD = SobelLineSSE2;
+        dsyslog("SobelInitCPU(): use SSE2 sobel transformation");
+        return;
+    }
+#endif
+    dsyslog("SobelInitCPU(): use scalar sobel transformation");
+}
+
+
+bool cMarkAdLogo::SobelLineVersion(const int version, const uchar *line, const int linesize, const int xFrom, const int xTo, const int cutval, uchar *sobelLine) {
+    int X = xFrom;
+    switch (version) {
+        case SOBEL_SCALAR:
+            break;
+#if defined(__x86_64__) || defined(__i386__)
+        case SOBEL_SSE2:
+            __builtin_cpu_init();
+            if (!__builtin_cpu_supports("sse2")) return false;
+            X += SobelLineSSE2(line + X, linesize, xTo - X + 1, cutval, sobelLine + X);
+            break;
+        case SOBEL_AVX2:
+            __builtin_cpu_init();
+            if (!__builtin_cpu_supports("avx2")) return false;
+            X += SobelLineAVX2(line + X, linesize, xTo - X + 1, cutval, sobelLine + X);
+            break;
+#endif
+        default:
+            return false;
+    }
+    if (X <= xTo) SobelLine(line, linesize, X, xTo, cutval, sobelLine);
+    return true;
+}
+
+
 bool cMarkAdLogo::SobelPlane(const int plane) {
     if ((plane < 0) || (plane >= PLANES)) return false;
     if (!maContext->Video.Data.PlaneLinesize[plane]) return false;
@@ -748,51 +1091,52 @@ bool cMarkAdLogo::SobelPlane(const int plane) {
         cutval /= 2;
         width /= 2;
     }
-    int SUM;
-    int sumX,sumY;
+    pthread_once(&sobelCPUChecked, SobelInitCPU);
     area.rPixel[plane] = 0;
     if (!plane) area.intensity = 0;
+    int linesize = maContext->Video.Data.PlaneLinesize[plane];
+    int lineStart = xstart + boundary;  // first pixel of line with convolution
+    int lineEnd = xend - boundary;      // last pixel of line with convolution
+
+    // with a black and white mask we count black pixel of result with bit maps, result pixel is black if mask and sobel pixel are black
+    const uint64_t *maskBlack = NULL;
+    int wordsPerLine = (xend - xstart + 63) / 64;
+    if (area.valid[plane]) maskBlack = GetMaskBlack(plane, xend - xstart, yend - ystart, width);
+    if (maskBlack && (static_cast<int>(sobelBlack.size()) < wordsPerLine)) sobelBlack.resize(wordsPerLine);
     for (int Y = ystart; Y <= yend - 1; Y++) {
-        for (int X = xstart; X <= xend - 1; X++) {
-            if (!plane) {
-                area.intensity += maContext->Video.Data.Plane[plane][X + (Y * maContext->Video.Data.PlaneLinesize[plane])];
-            }
-            sumX = 0;
-            sumY = 0;
-
-            // image boundaries
-            if (Y < (ystart + boundary) || Y > (yend - boundary)) SUM = 0;
-            else if (X < (xstart + boundary) || X > (xend - boundary)) SUM = 0;
-            // convolution starts here
-            else {
-                // X Gradient approximation
-                for (int I = -1; I <= 1; I++) {
-                    for (int J = -1; J <= 1; J++) {
-                        sumX = sumX + static_cast<int> ((*(maContext->Video.Data.Plane[plane] + X + I + (Y + J) * maContext->Video.Data.PlaneLinesize[plane])) * GX[I + 1][J + 1]);
-                    }
-                }
-
-                // Y Gradient approximation
-                for (int I = -1; I <= 1; I++) {
-                    for (int J = -1; J <= 1; J++) {
-                        sumY = sumY+ static_cast<int> ((*(maContext->Video.Data.Plane[plane] + X + I + (Y + J) * maContext->Video.Data.PlaneLinesize[plane])) * GY[I + 1][J + 1]);
-                    }
-                }
-
-                // Gradient Magnitude approximation
-                SUM = abs(sumX) + abs(sumY);
-            }
-
-            if (SUM >= cutval) SUM = 255;
-            if (SUM < cutval) SUM = 0;
-
-            int val = 255 - (uchar) SUM;
-
-            area.sobel[plane][(X-xstart)+(Y-ystart)*width] = val;
-
-            area.result[plane][(X-xstart)+(Y-ystart)*width] = (area.mask[plane][(X-xstart)+(Y-ystart)*width] + val) & 255;
+        const uchar *line = maContext->Video.Data.Plane[plane] + (Y * linesize);
+        uchar *sobelLine  = area.sobel[plane] + (Y - ystart) * width - xstart;
+        uchar *maskLine   = area.mask[plane] + (Y - ystart) * width - xstart;
+        uchar *resultLine = area.result[plane] + (Y - ystart) * width - xstart;
+        if (!plane) {
+            for (int X = xstart; X <= xend - 1; X++) area.intensity += line[X];
+        }
 
-            if (!area.result[plane][(X-xstart)+(Y-ystart)*width]) area.rPixel[plane]++;
+        // image boundaries
+        if (Y < (ystart + boundary) || Y > (yend - boundary) || (lineStart > lineEnd)) {
+            for (int X = xstart; X <= xend - 1; X++) sobelLine[X] = 255;
+        }
+        else {
+            for (int X = xstart; X < lineStart; X++) sobelLine[X] = 255;
+            // convolution starts here, SIMD version for as many pixel as possible, rest with scalar version
+            int X = lineStart;
+            if (sobelLineSIMD) X += sobelLineSIMD(line + X, linesize, lineEnd - X + 1, cutval, sobelLine + X);
+            if (X <= lineEnd) SobelLine(line, linesize, X, lineEnd, cutval, sobelLine);
+            for (X = lineEnd + 1; X <= xend - 1; X++) sobelLine[X] = 255;
+        }
+
+        bool counted = false;
+        if (maskBlack && PackBlackPixel(sobelLine + xstart, xend - xstart, sobelBlack.data())) {
+            const uint64_t *maskBlackLine = maskBlack + (Y - ystart) * wordsPerLine;
+            for (int word = 0; word < wordsPerLine; word++) area.rPixel[plane] += __builtin_popcountll(maskBlackLine[word] & sobelBlack[word]);
+            counted = true;
+        }
+#ifndef DEBUG_LOGO_DETECT_FRAME_CORNER
+        if (counted) continue;  // result plane is only needed to debug
+#endif
+        for (int X = xstart; X <= xend - 1; X++) {
+            resultLine[X] = (maskLine[X] + sobelLine[X]) & 255;
+            if (!counted && !resultLine[X]) area.rPixel[plane]++;
         }
     }
     if (!plane) area.intensity /= (logoHeight*width);
@@ -804,6 +1148,8 @@ bool cMarkAdLogo::SobelPlane(const int plane) {
 // we need this for channels with usually grey logos, but at start and end they can be red (DMAX)
 //
 void cMarkAdLogo::LogoGreyToColour() {
+    FreeMaskBlack(1);
+    FreeMaskBlack(2);
     for (int line = 0; line < logoHeight; line++) {
         for (int column = 0; column < logoWidth; column++) {
             if (area.mask[0][line * logoWidth + column] == 0 ){
@@ -1073,6 +1419,7 @@ int cMarkAdLogo::Detect(const int frameBefore, const int frameCurrent, int *logo
 
 
 int cMarkAdLogo::Process(const int iFrameBefore, const int iFrameCurrent, const int frameCurrent, int *logoFrameNumber) {
+    cPerfTimer perfTimer(PERF_LOGO);
     if (!maContext) return LOGO_ERROR;
     if (!maContext->Video.Data.valid) {
         area.status = LOGO_UNINITIALIZED;
@@ -1190,6 +1537,121 @@ int cMarkAdLogo::Process(const int iFrameBefore, const int iFrameCurrent, const
 }
 
 
+#define BLACKNESS 20  // maximum brightness to detect a blackscreen, +1 to detect end of blackscreen
+
+#define CHECKHEIGHT 5  // changed from 20 to 16 to 8 to 5
+#define BRIGHTNESS_H_SURE  22  // changed from 20 to 22
+#define BRIGHTNESS_H_MAYBE 39  // some channel have logo in border, so we will get a higher value, changed from 27 to 38 to 39
+#define VOFFSET 5
+
+#define CHECKWIDTH 32
+#define BRIGHTNESS_V_SURE  22  // changed from 20 to 21 to 22
+#define BRIGHTNESS_V_MAYBE 26  // some channel have logo in border, so we will get a higher value
+#define HOFFSET 50
+#define VOFFSET_ 120
+
+
+// sum of brightness of <count> pixel, SSE2 version adds 16 pixel at once with PSADBW
+//
+static int SumLine(const uchar *pixel, const int count) {
+    int sum = 0;
+    int i = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum16 = _mm_setzero_si128();
+    for (; i + 16 <= count; i += 16) {
+        sum16 = _mm_add_epi64(sum16, _mm_sad_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixel + i)), zero));
+    }
+    sum = _mm_cvtsi128_si32(sum16) + _mm_cvtsi128_si32(_mm_unpackhi_epi64(sum16, sum16));
+#endif
+    for (; i < count; i++) sum += pixel[i];
+    return sum;
+}
+
+
+// calculate brightness statistics of luma plane for blackscreen, horizontal and vertical border detection in one pass
+// stop to sum up a part as soon as it can no longer be a blackscreen or a vertical border
+// frame:   true to calculate brightness of frame for blackscreen detection
+// hBorder: true to calculate brightness of top and bottom border area
+// vBorder: true to calculate brightness of left and right border area
+// return:  true if statistics are valid, false otherwise
+//
+static bool GetLumaStats(const sMarkAdContext *maContext, const bool frame, const bool hBorder, const bool vBorder, sLumaStats *stats) {
+    cPerfTimer perfTimer(PERF_LUMA);
+    if (!maContext) return false;
+    if (!stats) return false;
+    *stats = sLumaStats();
+    if (!maContext->Video.Data.valid) return false;
+    if (!maContext->Video.Data.Plane[0]) return false;
+    int linesize = maContext->Video.Data.PlaneLinesize[0];
+    int height = maContext->Video.Info.height;
+    int width = maContext->Video.Info.width;
+    if ((linesize <= 0) || (height <= 0) || (width <= 0)) return false;
+
+    // frame brightness for blackscreen detection
+    bool frameRunning = frame;
+    stats->framePixel = static_cast<int64_t>(height) * width;
+    int64_t frameLimit = (BLACKNESS + 1) * stats->framePixel;
+
+    // top and bottom area for horizontal border detection
+    int topStart = VOFFSET;
+    int topEnd = VOFFSET + CHECKHEIGHT;
+    int bottomStart = height - VOFFSET - CHECKHEIGHT;
+    int bottomEnd = height - VOFFSET;
+    bool hRunning = hBorder && (bottomStart >= topEnd);
+    int64_t top = 0;
+    int64_t bottom = 0;
+
+    // left and right area for vertical border detection
+    int vStart = VOFFSET_;
+    int vEnd = height - VOFFSET_;
+    int rightStart = width - HOFFSET - CHECKWIDTH;
+    bool vRunning = vBorder && (vEnd > vStart) && (rightStart >= HOFFSET + CHECKWIDTH);
+    int64_t vPixel = vRunning ? static_cast<int64_t>(vEnd - vStart) * CHECKWIDTH : 0;
+    int64_t vLimit = (BRIGHTNESS_V_MAYBE + 1) * vPixel;  // average must be <= BRIGHTNESS_V_MAYBE
+    int64_t left = 0;
+    int64_t right = 0;
+    bool vBorderPossible = vRunning;
+
+    for (int line = 0; line < height; line++) {
+        if (hRunning && (line >= bottomEnd)) hRunning = false;
+        if (vRunning && (line >= vEnd)) vRunning = false;
+        if (!frameRunning && !hRunning && !vRunning) break;
+
+        const uchar *pixel = maContext->Video.Data.Plane[0] + line * linesize;
+        bool inTop = hRunning && (line >= topStart) && (line < topEnd);
+        bool inBottom = hRunning && (line >= bottomStart);
+        if (frameRunning || inTop || inBottom) {
+            int lineSum = SumLine(pixel, width);
+            if (inTop) top += lineSum;
+            if (inBottom) bottom += lineSum;
+            if (frameRunning) {
+                stats->frameSum += lineSum;
+                if (stats->frameSum > frameLimit) frameRunning = false;  // no blackscreen
+            }
+        }
+        if (vRunning && (line >= vStart)) {
+            left += SumLine(pixel + HOFFSET, CHECKWIDTH);
+            right += SumLine(pixel + rightStart, CHECKWIDTH);
+            if ((left >= vLimit) || (right >= vLimit)) {  // no vertical border
+                vRunning = false;
+                vBorderPossible = false;
+            }
+        }
+    }
+    if (hBorder && (bottomStart >= topEnd)) {
+        stats->top = top / (CHECKHEIGHT * width);
+        stats->bottom = bottom / (CHECKHEIGHT * width);
+    }
+    if (vBorderPossible) {
+        stats->left = left / vPixel;
+        stats->right = right / vPixel;
+    }
+    stats->valid = true;
+    return true;
+}
+
+
 // detect blackscreen
 //
 cMarkAdBlackScreen::cMarkAdBlackScreen(sMarkAdContext *maContextParam) {
@@ -1208,8 +1670,8 @@ void cMarkAdBlackScreen::Clear() {
 //          0 no status change
 //          1 blackscreen end (notice: this is a START mark)
 //
-int cMarkAdBlackScreen::Process(__attribute__((unused)) const int frameCurrent) {
-#define BLACKNESS 20  // maximum brightness to detect a blackscreen, +1 to detect end of blackscreen
+int cMarkAdBlackScreen::Process(__attribute__((unused)) const int frameCurrent, const sLumaStats *lumaStats) {
+    cPerfTimer perfTimer(PERF_BLACKSCREEN);
     if (!maContext) return 0;
     if (!maContext->Video.Data.valid) return 0;
     if (maContext->Video.Info.framesPerSecond == 0) return 0;
@@ -1225,30 +1687,33 @@ int cMarkAdBlackScreen::Process(__attribute__((unused)) const int frameCurrent)
         dsyslog("cMarkAdBlackScreen::Process() Video.Data.Plane[0] missing");
         return 0;
     }
-    int end = maContext->Video.Info.height * maContext->Video.Info.width;
-    int val = 0;
+    sLumaStats frameStats;
+    if (!lumaStats) {
+        GetLumaStats(maContext, true, false, false, &frameStats);
+        lumaStats = &frameStats;
+    }
+    if (!lumaStats->valid) return 0;
+
     // calulate limit with hysteresis
-    int maxBrightness;
-    if (blackScreenstatus == BLACKSCREEN_INVISIBLE) maxBrightness = BLACKNESS * end;
-    else maxBrightness = (BLACKNESS + 1) * end;
+    int64_t maxBrightness;
+    if (blackScreenstatus == BLACKSCREEN_INVISIBLE) maxBrightness = BLACKNESS * lumaStats->framePixel;
+    else maxBrightness = (BLACKNESS + 1) * lumaStats->framePixel;
 
 #ifdef DEBUG_BLACKSCREEN
     int debugVal = 0;
+    int end = maContext->Video.Info.height * maContext->Video.Info.width;
     for (int x = 0; x < end; x++) {
         debugVal += maContext->Video.Data.Plane[0][x];
     }
     debugVal /= end;
     dsyslog("cMarkAdBlackScreen::Process(): frame (%d) blackness %d (expect <%d for start, >%d for end)", frameCurrent, debugVal, BLACKNESS, BLACKNESS);
 #endif
-    for (int x = 0; x < end; x++) {
-        val += maContext->Video.Data.Plane[0][x];
-        if (val > maxBrightness) {
-            if (blackScreenstatus != BLACKSCREEN_INVISIBLE) {
-                blackScreenstatus = BLACKSCREEN_INVISIBLE;
-                return 1; // detected stop of black screen
-            }
-            return 0;
+    if (lumaStats->frameSum > maxBrightness) {
+        if (blackScreenstatus != BLACKSCREEN_INVISIBLE) {
+            blackScreenstatus = BLACKSCREEN_INVISIBLE;
+            return 1; // detected stop of black screen
         }
+        return 0;
     }
     if (blackScreenstatus == BLACKSCREEN_INVISIBLE) {
         blackScreenstatus = BLACKSCREEN_VISIBLE;
@@ -1276,11 +1741,8 @@ void cMarkAdBlackBordersHoriz::Clear() {
 }
 
 
-int cMarkAdBlackBordersHoriz::Process(const int FrameNumber, int *borderFrame) {
-#define CHECKHEIGHT 5  // changed from 20 to 16 to 8 to 5
-#define BRIGHTNESS_H_SURE  22  // changed from 20 to 22
-#define BRIGHTNESS_H_MAYBE 39  // some channel have logo in border, so we will get a higher value, changed from 27 to 38 to 39
-#define VOFFSET 5
+int cMarkAdBlackBordersHoriz::Process(const int FrameNumber, int *borderFrame, const sLumaStats *lumaStats) {
+    cPerfTimer perfTimer(PERF_HBORDER);
     if (!maContext) return HBORDER_ERROR;
     if (!maContext->Video.Data.valid) return HBORDER_ERROR;
     if (maContext->Video.Info.framesPerSecond == 0) return HBORDER_ERROR;
@@ -1289,45 +1751,20 @@ int cMarkAdBlackBordersHoriz::Process(const int FrameNumber, int *borderFrame) {
         dsyslog("cMarkAdBlackBordersHoriz::Process() video hight missing");
         return HBORDER_ERROR;
     }
-    int height = maContext->Video.Info.height - VOFFSET;
-
     if (!maContext->Video.Data.PlaneLinesize[0]) {
         dsyslog("cMarkAdBlackBordersHoriz::Process() Video.Data.PlaneLinesize[0] not initalized");
         return HBORDER_ERROR;
     }
-    int start = (height - CHECKHEIGHT) * maContext->Video.Data.PlaneLinesize[0];
-    int end = height * maContext->Video.Data.PlaneLinesize[0];
-    int valTop = 0;
-    int valBottom = 0;
-    int cnt = 0;
-    int xz = 0;
-
-    for (int x = start; x < end; x++) {
-        if (xz < maContext->Video.Info.width) {
-            valBottom += maContext->Video.Data.Plane[0][x];
-            cnt++;
-        }
-        xz++;
-        if (xz >= maContext->Video.Data.PlaneLinesize[0]) xz=0;
-    }
-    valBottom /= cnt;
-
-    if (valBottom <= BRIGHTNESS_H_MAYBE) { // we have a bottom border, test top border
-        start = VOFFSET * maContext->Video.Data.PlaneLinesize[0];
-        end = maContext->Video.Data.PlaneLinesize[0] * (CHECKHEIGHT+VOFFSET);
-        cnt = 0;
-        xz = 0;
-        for (int x = start; x < end; x++) {
-            if (xz < maContext->Video.Info.width) {
-                valTop += maContext->Video.Data.Plane[0][x];
-                cnt++;
-            }
-            xz++;
-            if (xz >= maContext->Video.Data.PlaneLinesize[0]) xz=0;
-        }
-        valTop /= cnt;
+    sLumaStats frameStats;
+    if (!lumaStats) {
+        GetLumaStats(maContext, false, true, false, &frameStats);
+        lumaStats = &frameStats;
     }
-    else valTop = INT_MAX;
+    if (!lumaStats->valid) return HBORDER_ERROR;
+
+    int valBottom = lumaStats->bottom;
+    int valTop = INT_MAX;
+    if (valBottom <= BRIGHTNESS_H_MAYBE) valTop = lumaStats->top;  // we have a bottom border, test top border
 
 #ifdef DEBUG_HBORDER
     dsyslog("cMarkAdBlackBordersHoriz::Process(): frame (%5d) hborder brightness top %3d bottom %3d (expect one <=%d and one <= %d)", FrameNumber, valTop, valBottom, BRIGHTNESS_H_SURE, BRIGHTNESS_H_MAYBE);
@@ -1380,12 +1817,8 @@ int cMarkAdBlackBordersVert::GetFirstBorderFrame() {
 }
 
 
-int cMarkAdBlackBordersVert::Process(int frameNumber, int *borderFrame) {
-#define CHECKWIDTH 32
-#define BRIGHTNESS_V_SURE  22  // changed from 20 to 21 to 22
-#define BRIGHTNESS_V_MAYBE 26  // some channel have logo in border, so we will get a higher value
-#define HOFFSET 50
-#define VOFFSET_ 120
+int cMarkAdBlackBordersVert::Process(int frameNumber, int *borderFrame, const sLumaStats *lumaStats) {
+    cPerfTimer perfTimer(PERF_VBORDER);
     if (!maContext) {
         dsyslog("cMarkAdBlackBordersVert::Process(): maContext not valid");
         return VBORDER_ERROR;
@@ -1397,42 +1830,19 @@ int cMarkAdBlackBordersVert::Process(int frameNumber, int *borderFrame) {
     }
     *borderFrame = -1;
 
-    int valLeft = 0;
-    int valRight = 0;
-    int cnt = 0;
-
     if(!maContext->Video.Data.PlaneLinesize[0]) {
         dsyslog("Video.Data.PlaneLinesize[0] missing");
         return VBORDER_ERROR;
     }
-
-    // check left border
-    int end = maContext->Video.Data.PlaneLinesize[0] * (maContext->Video.Info.height - VOFFSET_);
-    int i = VOFFSET_ * maContext->Video.Data.PlaneLinesize[0];
-    while (i < end) {
-        for (int x = 0; x < CHECKWIDTH; x++) {
-            valLeft += maContext->Video.Data.Plane[0][HOFFSET + x + i];
-            cnt++;
-        }
-        i += maContext->Video.Data.PlaneLinesize[0];
+    sLumaStats frameStats;
+    if (!lumaStats) {
+        GetLumaStats(maContext, false, false, true, &frameStats);
+        lumaStats = &frameStats;
     }
-    valLeft /= cnt;
+    if (!lumaStats->valid) return VBORDER_ERROR;
 
-    if (valLeft <= BRIGHTNESS_V_MAYBE) {
-        // check right border
-        cnt = 0;
-        i = VOFFSET_ * maContext->Video.Data.PlaneLinesize[0];
-        int w = maContext->Video.Info.width - HOFFSET - CHECKWIDTH;
-        while (i < end) {
-            for (int x = 0; x < CHECKWIDTH; x++) {
-                valRight += maContext->Video.Data.Plane[0][w+x+i];
-                cnt++;
-            }
-            i += maContext->Video.Data.PlaneLinesize[0];
-        }
-        valRight /= cnt;
-    }
-    else valLeft = INT_MAX;
+    int valLeft = lumaStats->left;
+    int valRight = lumaStats->right;
 
 #ifdef DEBUG_VBORDER
     dsyslog("cMarkAdBlackBordersVert(): frame (%5d) valLeft %d valRight %d", frameNumber, valLeft, valRight);
@@ -1507,26 +1917,82 @@ void cMarkAdOverlap::Clear() {
 }
 
 
-void cMarkAdOverlap::GetHistogram(simpleHistogram &dest) {
-    memset(dest, 0, sizeof(simpleHistogram));
-    for (int Y = 0; Y < maContext->Video.Info.height;Y++) {
-        for (int X = 0; X < maContext->Video.Info.width;X++) {
-            uchar val = maContext->Video.Data.Plane[0][X+(Y*maContext->Video.Data.PlaneLinesize[0])];
-            dest[val]++;
+// count the pixel of each brightness in 4 separate histograms and add them at the end,
+// so neighbour pixel with the same brightness do not wait for the increment of the same counter
+// with --fastoverlap only every second line and column is counted and the result is scaled to the full frame
+//
+void cMarkAdOverlap::GetHistogram(sHistBuffer &dest) {
+    uint32_t count[4][256];
+    memset(count, 0, sizeof(count));
+    const int width = maContext->Video.Info.width;
+    const int height = maContext->Video.Info.height;
+    const int lineSize = maContext->Video.Data.PlaneLinesize[0];
+    const bool subsample = maContext->Config->fastOverlap;
+    const int step = (subsample) ? 2 : 1;
+
+    for (int line = 0; line < height; line += step) {
+        const uchar *pixel = maContext->Video.Data.Plane[0] + line * lineSize;
+        int column = 0;
+        if (subsample) {
+            for (; column <= width - 8; column += 8) {
+                uint64_t eight;
+                memcpy(&eight, pixel + column, sizeof(eight));
+                count[0][eight & 0xFF]++;
+                count[1][(eight >> 16) & 0xFF]++;
+                count[2][(eight >> 32) & 0xFF]++;
+                count[3][(eight >> 48) & 0xFF]++;
+            }
         }
+        else {
+            for (; column <= width - 8; column += 8) {
+                uint64_t eight;
+                memcpy(&eight, pixel + column, sizeof(eight));
+                count[0][eight & 0xFF]++;
+                count[1][(eight >> 8) & 0xFF]++;
+                count[2][(eight >> 16) & 0xFF]++;
+                count[3][(eight >> 24) & 0xFF]++;
+                count[0][(eight >> 32) & 0xFF]++;
+                count[1][(eight >> 40) & 0xFF]++;
+                count[2][(eight >> 48) & 0xFF]++;
+                count[3][eight >> 56]++;
+            }
+        }
+        for (; column < width; column += step) count[0][pixel[column]]++;
+    }
+
+    const int scale = step * step;
+    memset(dest.coarse, 0, sizeof(dest.coarse));
+    for (int i = 0; i < 256; i++) {
+        dest.histogram[i] = (count[0][i] + count[1][i] + count[2][i] + count[3][i]) * scale;
+        dest.coarse[i / (256 / OVERLAP_COARSE_BINS)] += dest.histogram[i];
     }
 }
 
 
-int cMarkAdOverlap::AreSimilar(const simpleHistogram &hist1, const simpleHistogram &hist2) { // return > 0 if similar, else <= 0
+// compare two histograms, return > 0 if similar, else <= 0
+// the difference of the coarse histograms can not be greater than the difference of the full histograms,
+// so we can reject the pair if it already reaches the limit
+// the full compare stops as soon as the difference reaches the limit, only the sign of a not similar result is used
+//
+int cMarkAdOverlap::AreSimilar(const sHistBuffer &frame1, const sHistBuffer &frame2) {
+    compareCount++;
     int similar = 0;
-    for (int i = 0; i < 256; i++) {
-        similar += abs(hist1[i] - hist2[i]);  // calculte difference, smaller is more similar
+    for (int i = 0; i < OVERLAP_COARSE_BINS; i++) {
+        similar += abs(frame1.coarse[i] - frame2.coarse[i]);
+    }
+    if (similar >= similarCutOff) {
+        skipCount++;
+        return -similar;
     }
-    if (similar < similarCutOff) {
-       return similar;
+
+    similar = 0;
+    for (int block = 0; block < 256; block += 32) {
+        for (int i = block; i < block + 32; i++) {
+            similar += abs(frame1.histogram[i] - frame2.histogram[i]);  // calculte difference, smaller is more similar
+        }
+        if (similar >= similarCutOff) return -similar;
     }
-    return -similar;
+    return similar;
 }
 
 
@@ -1538,12 +2004,14 @@ sOverlapPos *cMarkAdOverlap::Detect() {
     int tmpindexBeforeStopMark = 0;
     Result.frameNumberBefore = -1;
     int firstSimilarBeforeStopMark = 0;
+    compareCount = 0;
+    skipCount = 0;
     for (int indexBeforeStopMark = 0; indexBeforeStopMark < histcnt[OV_BEFORE]; indexBeforeStopMark++) {
 #ifdef DEBUG_OVERLAP
         dsyslog("cMarkAdOverlap::Detect(): ------------------ testing frame (%5d) before stop mark, indexBeforeStopMark %d, against all frames after start mark", histbuf[OV_BEFORE][indexBeforeStopMark].frameNumber, indexBeforeStopMark);
 #endif
         for (int indexAfterStartMark = startAfterMark; indexAfterStartMark < histcnt[OV_AFTER]; indexAfterStartMark++) {
-            int simil = AreSimilar(histbuf[OV_BEFORE][indexBeforeStopMark].histogram, histbuf[OV_AFTER][indexAfterStartMark].histogram);
+            int simil = AreSimilar(histbuf[OV_BEFORE][indexBeforeStopMark], histbuf[OV_AFTER][indexAfterStartMark]);
 #ifdef DEBUG_OVERLAP
             if (simil > 0) dsyslog("cMarkAdOverlap::Detect(): compare frame  (%5d) (index %3d) and (%5d) (index %3d) -> simil %5d (max %d) simcnt %2i similarMaxCnt %2i)", histbuf[OV_BEFORE][indexBeforeStopMark].frameNumber, indexBeforeStopMark, histbuf[OV_AFTER][indexAfterStartMark].frameNumber, indexAfterStartMark, simil, similarCutOff, simcnt, similarMaxCnt);
 #endif
@@ -1577,6 +2045,7 @@ sOverlapPos *cMarkAdOverlap::Detect() {
             }
           }
     }
+    dsyslog("cMarkAdOverlap::Detect(): %d frame pairs compared, %d rejected by coarse histogram", compareCount, skipCount);
     if (Result.frameNumberBefore == -1) {
         if (simcnt > similarMaxCnt) {
             Result.frameNumberBefore = histbuf[OV_BEFORE][tmpindexBeforeStopMark].frameNumber;
@@ -1591,6 +2060,7 @@ sOverlapPos *cMarkAdOverlap::Detect() {
 
 
 sOverlapPos *cMarkAdOverlap::Process(const int frameNumber, const int frameCount, const bool beforeAd, const bool h264) {
+    cPerfTimer perfTimer(PERF_OVERLAP);
 #ifdef DEBUG_OVERLAP
     dsyslog("------------------------------------------------------------------------------------------------");
     dsyslog("cMarkAdVideo::ProcessOverlap(): frameNumber %d, frameCount %d, beforeAd %d, isH264 %d", frameNumber, frameCount, beforeAd, h264);
@@ -1610,7 +2080,7 @@ sOverlapPos *cMarkAdOverlap::Process(const int frameNumber, const int frameCount
             histbuf[OV_BEFORE] = new sHistBuffer[frameCount + 1];
             ALLOC(sizeof(*histbuf[OV_BEFORE]), "histbuf");
         }
-        GetHistogram(histbuf[OV_BEFORE][histcnt[OV_BEFORE]].histogram);
+        GetHistogram(histbuf[OV_BEFORE][histcnt[OV_BEFORE]]);
         histbuf[OV_BEFORE][histcnt[OV_BEFORE]].frameNumber = frameNumber;
         histcnt[OV_BEFORE]++;
     }
@@ -1631,7 +2101,7 @@ sOverlapPos *cMarkAdOverlap::Process(const int frameNumber, const int frameCount
 #endif
             return Detect();
         }
-        GetHistogram(histbuf[OV_AFTER][histcnt[OV_AFTER]].histogram);
+        GetHistogram(histbuf[OV_AFTER][histcnt[OV_AFTER]]);
         histbuf[OV_AFTER][histcnt[OV_AFTER]].frameNumber = frameNumber;
         histcnt[OV_AFTER]++;
     }
@@ -1716,6 +2186,7 @@ bool cMarkAdVideo::AddMark(int type, int position, sAspectRatio *before, sAspect
 
 
 bool cMarkAdVideo::AspectRatioChange(const sAspectRatio &AspectRatioA, const sAspectRatio &AspectRatioB, bool &start) {
+    cPerfTimer perfTimer(PERF_ASPECTRATIO);
     start = false;
     if ((AspectRatioA.num == 0) || (AspectRatioA.den == 0) || (AspectRatioB.num == 0) || (AspectRatioB.den == 0)) {
         if (((AspectRatioA.num == 4) || (AspectRatioB.num == 4)) && ((AspectRatioA.den == 3) || (AspectRatioB.den == 3))) {
@@ -1739,9 +2210,14 @@ sMarkAdMarks *cMarkAdVideo::Process(int iFrameBefore, const int iFrameCurrent, c
     else useFrame = iFrameCurrent;
     ResetMarks();
 
-    if ((frameCurrent > 0) && !maContext->Video.Options.ignoreBlackScreenDetection) { // first frame can be invalid result
+    // brightness of frame, top/bottom and left/right border area in one pass over the luma plane
+    bool checkBlackScreen = (frameCurrent > 0) && !maContext->Video.Options.ignoreBlackScreenDetection;  // first frame can be invalid result
+    sLumaStats lumaStats;
+    GetLumaStats(maContext, checkBlackScreen, !maContext->Video.Options.ignoreHborder, !maContext->Video.Options.ignoreVborder, &lumaStats);
+
+    if (checkBlackScreen) {
         int blackret;
-        blackret = blackScreen->Process(useFrame);
+        blackret = blackScreen->Process(useFrame, &lumaStats);
         if (blackret > 0) {
             if (maContext->Config->fullDecode) AddMark(MT_NOBLACKSTART, useFrame);  // first frame without blackscreen is start mark position
             else AddMark(MT_NOBLACKSTART, useFrame); // with iFrames only we must set mark on first frame after blackscreen to avoid start and stop on same iFrame
@@ -1755,7 +2231,7 @@ sMarkAdMarks *cMarkAdVideo::Process(int iFrameBefore, const int iFrameCurrent, c
     int hret = HBORDER_ERROR;
     if (!maContext->Video.Options.ignoreHborder) {
         int hborderframenumber;
-        hret = hborder->Process(useFrame, &hborderframenumber);  // we get start frame of hborder back
+        hret = hborder->Process(useFrame, &hborderframenumber, &lumaStats);  // we get start frame of hborder back
         if ((hret == HBORDER_VISIBLE) && (hborderframenumber >= 0)) {
             AddMark(MT_HBORDERSTART, hborderframenumber);
         }
@@ -1769,7 +2245,7 @@ sMarkAdMarks *cMarkAdVideo::Process(int iFrameBefore, const int iFrameCurrent, c
     int vret = VBORDER_ERROR;
     if (!maContext->Video.Options.ignoreVborder) {
         int vborderframenumber;
-        vret = vborder->Process(useFrame, &vborderframenumber);
+        vret = vborder->Process(useFrame, &vborderframenumber, &lumaStats);
         if ((vret == VBORDER_VISIBLE) && (vborderframenumber >= 0)) {
             if (hret == HBORDER_VISIBLE) dsyslog("cMarkAdVideo::Process(); hborder and vborder detected, ignore this, it is a very long black screen");
             else AddMark(MT_VBORDERSTART, vborderframenumber);
@@ -9,6 +9,10 @@
 #ifndef __video_h_
 #define __video_h_
 
+#include <stdio.h>
+#include <stdint.h>
+#include <climits>
+#include <vector>
 #include "global.h"
 #include "index.h"
 
@@ -26,6 +30,19 @@
 #define MIN_V_BORDER_SECS 70  //!< minimum lenght of horizontal border <br>
                               //!< keep it greater than MIN_H_BORDER_SECS for detecting long black screens
 
+#define OVERLAP_COARSE_BINS 16  //!< bins of the coarse histogram of overlap detection
+                                //!<
+
+
+/**
+ * implementation of the sobel line transformation
+ */
+enum eSobelVersion {
+    SOBEL_SCALAR = 0,
+    SOBEL_SSE2 = 1,
+    SOBEL_AVX2 = 2
+};
+
 
 /**
  * logo detection status
@@ -64,6 +81,27 @@ enum {
 };
 
 
+/**
+ * brightness statistics of luma plane for blackscreen and border detection, calculated in one pass over the plane
+ */
+struct sLumaStats {
+    bool valid = false;       //!< true if statistics are calculated from current frame
+                              //!<
+    int64_t frameSum = 0;     //!< sum of brightness of all pixel <br>
+                              //!< calculation stops if frame is too bright for a blackscreen, exact only up to (BLACKNESS + 1) * framePixel
+    int64_t framePixel = 0;   //!< count of pixel of frame
+                              //!<
+    int top = INT_MAX;        //!< average brightness of top border area, INT_MAX if not calculated
+                              //!<
+    int bottom = INT_MAX;     //!< average brightness of bottom border area, INT_MAX if not calculated
+                              //!<
+    int left = INT_MAX;       //!< average brightness of left border area, INT_MAX if not calculated or too bright for a vertical border
+                              //!<
+    int right = INT_MAX;      //!< average brightness of right border area, INT_MAX if not calculated or too bright for a vertical border
+                              //!<
+};
+
+
 
 /**
  * corner area after sobel transformation
@@ -106,6 +144,19 @@ typedef struct sAreaT {
                                      //!< <b>false:</b> logo mask is not valid
                                      //!<
 
+    uint64_t *maskBlack[PLANES] = {}; //!< black pixel of mask, 1 bit per pixel, each line starts at a new 64 bit word, NULL if mask is not black and white
+                                      //!<
+
+    int maskBlackSize[PLANES] = {};   //!< number of 64 bit words in maskBlack
+                                      //!<
+
+    bool maskBlackValid[PLANES] = {}; //!< <b>true:</b> maskBlack is calculated from current mask for corner maskBlackCorner <br>
+                                      //!< <b>false:</b> maskBlack has to be calculated
+                                      //!<
+
+    int maskBlackCorner[PLANES] = {}; //!< corner of the logo position maskBlack is calculated for
+                                      //!<
+
 } sAreaT;
 
 
@@ -176,18 +227,35 @@ class cMarkAdOverlap {
                                               //!<
 
 /**
- * check if two histogram are similar
- * @param hist1 histogram 1
- * @param hist2 histogram 2
+ * histogram buffer for overlap detection
+ */
+        typedef struct sHistBuffer {
+            int frameNumber;           //!< frame number
+                                       //!<
+
+            simpleHistogram histogram; //!< simple frame histogram
+                                       //!<
+
+            int coarse[OVERLAP_COARSE_BINS]; //!< histogram with 16 brightness values per bin, used as lower bound of the difference
+                                             //!<
+
+        } sHistBuffer;
+
+/**
+ * check if two histogram are similar <br>
+ * the difference of the coarse histograms is a lower bound of the difference of the full histograms,
+ * so most not similar pairs are rejected without compare the full histograms
+ * @param frame1 histogram buffer 1
+ * @param frame2 histogram buffer 2
  * @return different pixels if similar, <0 otherwise
  */
-        int AreSimilar(const simpleHistogram &hist1, const simpleHistogram &hist2);
+        int AreSimilar(const sHistBuffer &frame1, const sHistBuffer &frame2);
 
 /**
  * get a simple histogram of current frame
- * @param[in,out] dest histogram
+ * @param[in,out] dest histogram buffer
  */
-        void GetHistogram(simpleHistogram &dest);
+        void GetHistogram(sHistBuffer &dest);
 
 /**
  * detect overlaps before and after advertising
@@ -200,18 +268,6 @@ class cMarkAdOverlap {
  */
         void Clear();
 
-/**
- * histogram buffer for overlap detection
- */
-        typedef struct sHistBuffer {
-            int frameNumber;           //!< frame number
-                                       //!<
-
-            simpleHistogram histogram; //!< simple frame histogram
-                                       //!<
-
-        } sHistBuffer;
-
         sMarkAdContext *maContext = NULL;  //!< markad context
 
         sHistBuffer *histbuf[2];           //!< simple frame histogram with frame number
@@ -228,6 +284,10 @@ class cMarkAdOverlap {
                                            //!<
         int similarMaxCnt;                 //!< current maximum similar frames found before stop mark and after start mark
                                            //!<
+        int compareCount = 0;              //!< count of compared frame pairs in last Detect()
+                                           //!<
+        int skipCount = 0;                 //!< count of frame pairs rejected by coarse histogram in last Detect()
+                                           //!<
 };
 
 
@@ -307,8 +367,45 @@ class cMarkAdLogo : cLogoSize {
  */
         sAreaT *GetArea();
 
+/**
+ * pack black pixel of a black and white picture into a bit map
+ * @param[in]  pixel picture with pixel values 0 or 255
+ * @param[in]  count number of pixel
+ * @param[out] bits  bit map with (count + 63) / 64 words, bit is set if pixel is black, unused bits are cleared
+ * @return true if all pixel are 0 or 255, false otherwise
+ */
+        static bool PackBlackPixel(const uchar *pixel, const int count, uint64_t *bits);
+
+/**
+ * preload all logo files of a directory into memory <br>
+ * used by batch mode, the child processes of all recordings share the preloaded logos
+ * @param directory logo cache directory
+ * @return number of preloaded logo files
+ */
+        static int PreloadLogoFiles(const char *directory);
+
+/**
+ * sobel transform pixel xFrom to xTo of one line with a given implementation, used by markad-bench to verify the SIMD versions
+ * @param version   #eSobelVersion
+ * @param line      pointer to first pixel of the line in the plane
+ * @param linesize  line size of the plane
+ * @param xFrom     first pixel to transform
+ * @param xTo       last pixel to transform
+ * @param cutval    minimum gradient of an edge pixel
+ * @param sobelLine result line, index is pixel position in the plane line
+ * @return true if successful, false if the CPU does not support this implementation
+ */
+        bool SobelLineVersion(const int version, const uchar *line, const int linesize, const int xFrom, const int xTo, const int cutval, uchar *sobelLine);
+
     private:
 
+/**
+ * open logo file, use preloaded logo if available
+ * @param path full path of the logo file
+ * @return file stream of the logo, NULL if not found
+ */
+        static FILE *OpenLogoFile(const char *path);
+
 /**
  * enumeration for ReduceBrightness function return codes
  */
@@ -345,6 +442,33 @@ class cMarkAdLogo : cLogoSize {
  */
         bool SobelPlane(const int plane);
 
+/**
+ * get black pixel of logo mask as bit map, calculate it if mask or logo position has changed
+ * @param plane  plane number
+ * @param count  number of pixel in each line
+ * @param lines  number of lines
+ * @param stride distance of two lines in mask
+ * @return black pixel of mask, each line starts at a new 64 bit word, NULL if mask is not black and white
+ */
+        const uint64_t *GetMaskBlack(const int plane, const int count, const int lines, const int stride);
+
+/**
+ * free bit map of mask black pixel and mark it invalid
+ * @param plane plane number
+ */
+        void FreeMaskBlack(const int plane);
+
+/**
+ * sobel transform pixel xFrom to xTo of one line of a plane with #GX and #GY masks, scalar version
+ * @param line      pointer to first pixel of the line in the plane
+ * @param linesize  line size of the plane
+ * @param xFrom     first pixel to transform
+ * @param xTo       last pixel to transform
+ * @param cutval    minimum gradient of an edge pixel
+ * @param sobelLine result line, index is pixel position in the plane line
+ */
+        void SobelLine(const uchar *line, const int linesize, const int xFrom, const int xTo, const int cutval, uchar *sobelLine);
+
 /**
  * load logo from file in directory
  * @param directory source directory
@@ -403,6 +527,8 @@ class cMarkAdLogo : cLogoSize {
                                                   //!<
         bool isInitColourChange = false;          //!< true if trnasformation of grey logo to coloured logo is done
                                                   //!<
+        std::vector<uint64_t> sobelBlack;         //!< black pixel of current sobel line, 1 bit per pixel
+                                                  //!<
 };
 
 
@@ -421,12 +547,13 @@ class cMarkAdBlackScreen {
 /**
  * process black screen detection
  * @param frameCurrent current frame number
+ * @param lumaStats    brightness statistics of current frame, calculated if NULL
  * @return black screen status: <br>
  *         -1 blackscreen start (notice: this is a STOP mark) <br>
  *          0 no status change <br>
  *          1 blackscreen end (notice: this is a START mark)
  */
-        int Process(const int frameCurrent);
+        int Process(const int frameCurrent, const sLumaStats *lumaStats = NULL);
 
 /**
  * clear blackscreen detection status
@@ -463,9 +590,10 @@ class cMarkAdBlackBordersHoriz {
  * process horizontal border detection of current frame
  * @param frameNumber current frame number
  * @param borderFrame frame number of detected border
+ * @param lumaStats   brightness statistics of current frame, calculated if NULL
  * @return border detection status
  */
-        int Process(const int frameNumber, int *borderFrame);
+        int Process(const int frameNumber, int *borderFrame, const sLumaStats *lumaStats = NULL);
 
 /**
  * set horizontal border status to VBORDER_INVISIBLE
@@ -512,9 +640,10 @@ class cMarkAdBlackBordersVert {
  * process vertical border detection of current frame
  * @param frameNumber current frame number
  * @param borderFrame frame number of detected border
+ * @param lumaStats   brightness statistics of current frame, calculated if NULL
  * @return border detection status
  */
-        int Process(int frameNumber, int *borderFrame);
+        int Process(int frameNumber, int *borderFrame, const sLumaStats *lumaStats = NULL);
 
 /**
  * set vertical border status to VBORDER_INVISIBLE
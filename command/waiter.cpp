@@ -0,0 +1,136 @@
+/*
+ * waiter.cpp: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+
+#include "waiter.h"
+extern "C" {
+    #include "debug.h"
+}
+
+
+// global variables
+extern bool abortNow;
+
+
+cRecordingWaiter::cRecordingWaiter(const char *recDirParam) {
+    if (!recDirParam) return;
+    recDir = strdup(recDirParam);
+    ALLOC(strlen(recDir)+1, "recDir");
+    if (asprintf(&indexFile, "%s/index", recDir) == -1) indexFile = NULL;
+    else {
+        ALLOC(strlen(indexFile)+1, "indexFile");
+    }
+    indexSize = GetIndexSize();
+
+    inotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFD < 0) {
+        dsyslog("cRecordingWaiter::cRecordingWaiter(): inotify not available (errno %d), poll index file", errno);
+        return;
+    }
+    // watch the directory, not the files, VDR creates new ts files while recording
+    watchDescriptor = inotify_add_watch(inotifyFD, recDir, IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO);
+    if (watchDescriptor < 0) {
+        dsyslog("cRecordingWaiter::cRecordingWaiter(): inotify watch of %s failed (errno %d), poll index file", recDir, errno);
+        close(inotifyFD);
+        inotifyFD = -1;
+        return;
+    }
+    dsyslog("cRecordingWaiter::cRecordingWaiter(): watch %s with inotify", recDir);
+}
+
+
+cRecordingWaiter::~cRecordingWaiter() {
+    if (inotifyFD >= 0) {
+        if (watchDescriptor >= 0) inotify_rm_watch(inotifyFD, watchDescriptor);
+        close(inotifyFD);
+    }
+    if (indexFile) {
+        FREE(strlen(indexFile)+1, "indexFile");
+        free(indexFile);
+    }
+    if (recDir) {
+        FREE(strlen(recDir)+1, "recDir");
+        free(recDir);
+    }
+}
+
+
+off_t cRecordingWaiter::GetIndexSize() {
+    if (!indexFile) return -1;
+    struct stat indexStatus;
+    if (stat(indexFile, &indexStatus) == -1) return -1;
+    return indexStatus.st_size;
+}
+
+
+// only changes of the index and the ts files are new data, markad writes its own files to the same directory
+//
+bool cRecordingWaiter::ReadEvents() {
+    bool newData = false;
+    char buffer[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    while (true) {
+        ssize_t len = read(inotifyFD, buffer, sizeof(buffer));
+        if (len <= 0) break;  // EAGAIN: all events read
+        for (char *ptr = buffer; ptr < buffer + len; ptr += sizeof(struct inotify_event) + ((struct inotify_event *) ptr)->len) {
+            const struct inotify_event *event = (struct inotify_event *) ptr;
+            if (event->mask & IN_Q_OVERFLOW) {
+                newData = true;  // lost events, check the index
+                continue;
+            }
+            if (event->len == 0) continue;
+            if (strcmp(event->name, "index") == 0) newData = true;
+            else {
+                int nameLen = strlen(event->name);
+                if ((nameLen > 3) && (strcmp(event->name + nameLen - 3, ".ts") == 0)) newData = true;
+            }
+        }
+    }
+    return newData;
+}
+
+
+bool cRecordingWaiter::Wait(const int timeout_ms) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int waited_ms = 0;
+    while (!abortNow && (waited_ms < timeout_ms)) {
+        if (inotifyFD >= 0) {
+            struct pollfd inotifyPoll = {};
+            inotifyPoll.fd = inotifyFD;
+            inotifyPoll.events = POLLIN;
+            int ret = poll(&inotifyPoll, 1, timeout_ms - waited_ms);
+            if ((ret < 0) && (errno != EINTR)) {
+                esyslog("cRecordingWaiter::Wait(): poll failed with errno %d", errno);
+                return false;
+            }
+            if ((ret > 0) && ReadEvents()) return true;
+        }
+        else {
+            int sleep_ms = timeout_ms - waited_ms;
+            if (sleep_ms > WAITER_POLL_INTERVAL_MS) sleep_ms = WAITER_POLL_INTERVAL_MS;
+            usleep(sleep_ms * 1000);
+            off_t size = GetIndexSize();
+            if (size != indexSize) {
+                indexSize = size;
+                return true;
+            }
+        }
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        waited_ms = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+    }
+    return false;
+}
@@ -0,0 +1,97 @@
+/*
+ * waiter.h: A program for the Video Disk Recorder
+ *
+ * See the README file for copyright information and how to reach the author.
+ *
+ */
+
+#ifndef __waiter_h_
+#define __waiter_h_
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#define WAITER_POLL_INTERVAL_MS 1000  //!< check interval of the index file size if inotify is not available
+                                      //!<
+
+
+/**
+ * wait for new data of a running recording <br>
+ * uses inotify on the recording directory and wakes up if VDR writes to the index or to a ts file,
+ * falls back to polling the index file size if inotify is not available
+ */
+class cRecordingWaiter {
+    public:
+
+/**
+ * constructor of the recording waiter
+ * @param recDirParam recording directory
+ */
+        explicit cRecordingWaiter(const char *recDirParam);
+
+        ~cRecordingWaiter();
+
+/**
+ * copy constructor, not used, only for formal reason
+ */
+        cRecordingWaiter(const cRecordingWaiter &origin) {
+            recDir = NULL;
+            indexFile = NULL;
+            inotifyFD = -1;
+            watchDescriptor = -1;
+            indexSize = origin.indexSize;
+        };
+
+/**
+ * operator=, not used, only for formal reason
+ */
+        cRecordingWaiter &operator =(const cRecordingWaiter *origin) {
+            recDir = NULL;
+            indexFile = NULL;
+            inotifyFD = -1;
+            watchDescriptor = -1;
+            indexSize = origin->indexSize;
+            return *this;
+        }
+
+/**
+ * wait until VDR writes new data to the recording
+ * @param timeout_ms maximum time to wait in ms
+ * @return true if new data was written, false after timeout or abort
+ */
+        bool Wait(const int timeout_ms);
+
+/**
+ * check if inotify is used
+ * @return true if inotify is used, false if the index file is polled
+ */
+        bool UseInotify() {
+            return (watchDescriptor >= 0);
+        }
+
+    private:
+
+/**
+ * get size of the index file
+ * @return size of the index file, -1 if not found
+ */
+        off_t GetIndexSize();
+
+/**
+ * read all pending inotify events
+ * @return true if the index or a ts file was changed, false otherwise
+ */
+        bool ReadEvents();
+
+        char *recDir = NULL;        //!< recording directory
+                                    //!<
+        char *indexFile = NULL;     //!< file name of the index file
+                                    //!<
+        int inotifyFD = -1;         //!< inotify file descriptor, -1 if not available
+                                    //!<
+        int watchDescriptor = -1;   //!< inotify watch of the recording directory, -1 if not available
+                                    //!<
+        off_t indexSize = -1;       //!< last known size of the index file, used for polling
+                                    //!<
+};
+#endif
@@ -231,6 +231,10 @@ void cPluginMarkAd::MainThreadHook(void) {
         statusMonitor->Check();
         lastcheck = now;
     }
+    if (now != lastQueueCheck) {  // start queued jobs and detect finished markad processes once per second
+        statusMonitor->ProcessQueue();
+        lastQueueCheck = now;
+    }
 }
 
 
@@ -279,6 +283,7 @@ bool cPluginMarkAd::SetupParse(const char *Name, const char *Value) {
     else if (!strcasecmp(Name,"LogoOnly")) setup.LogoOnly = atoi(Value);
     else if (!strcasecmp(Name,"SaveInfo")) setup.SaveInfo = atoi(Value);
     else if (!strcasecmp(Name,"DeferredShutdown")) setup.DeferredShutdown = atoi(Value);
+    else if (!strcasecmp(Name,"MaxRunning")) setup.maxRunning = atoi(Value);
     else if (!strcasecmp(Name,"AutoLogoExtraction")) setup.autoLogoMenue = atoi(Value);
     else if (!strcasecmp(Name,"FullDecode")) setup.fulldecode = atoi(Value);
     else return false;
@@ -30,6 +30,7 @@ class cPluginMarkAd : public cPlugin {
         struct setup setup;
         char title[80];
         time_t lastcheck = 0;
+        time_t lastQueueCheck = 0;
         bool ReadTitle(const char *Directory);
     public:
         cPluginMarkAd(void);
@@ -26,6 +26,7 @@ cSetupMarkAd::cSetupMarkAd(struct setup *Setup) {
     logoonly = setup->LogoOnly;
     saveinfo = setup->SaveInfo;
     deferredshutdown = setup->DeferredShutdown;
+    maxrunning = setup->maxRunning;
     autologomenue = setup->autoLogoMenue;
     fulldecode = setup->fulldecode;
 
@@ -59,6 +60,7 @@ void cSetupMarkAd::write(void) {
         Add(new cMenuEditBoolItem(tr("scan only channels with logo"), &logoonly), true);
         lpos = Current();
         Add(new cMenuEditBoolItem(tr("deferred shutdown"), &deferredshutdown));
+        Add(new cMenuEditIntItem(tr("max. parallel markad processes"), &maxrunning, 0, 16, tr("unlimited")));
         Add(new cMenuEditBoolItem(tr("ignore timer margins"), &nomargins));
         Add(new cMenuEditBoolItem(tr("optimize marks (overlaps and logo marks adjustments"), &secondpass));
         Add(new cMenuEditBoolItem(tr("correct info file"), &saveinfo));
@@ -133,6 +135,7 @@ void cSetupMarkAd::Store(void) {
     SetupStore("LogoOnly", logoonly);
     SetupStore("SaveInfo", saveinfo);
     SetupStore("DeferredShutdown", deferredshutdown);
+    SetupStore("MaxRunning", maxrunning);
     SetupStore("AutoLogoExtraction", autologomenue);
     SetupStore("FullDecode", fulldecode);
 
@@ -148,6 +151,7 @@ void cSetupMarkAd::Store(void) {
     setup->NoMargins = static_cast<bool>(nomargins);
     setup->HideMainMenuEntry = static_cast<bool>(hidemainmenuentry);
     setup->DeferredShutdown = static_cast<bool>(deferredshutdown);
+    setup->maxRunning = static_cast<int>(maxrunning);
     setup->autoLogoMenue = static_cast<int>(autologomenue);
     setup->fulldecode = static_cast<bool>(fulldecode);
     setup->Log2Rec = log2rec;
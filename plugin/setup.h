@@ -32,6 +32,7 @@ struct setup {
     bool Log2Rec;
     bool LogoOnly;
     bool DeferredShutdown;
+    int maxRunning = 0;
     const char *LogoDir;
     char *LogLevel = NULL;
     char *aStopOffs = NULL;
@@ -67,6 +68,7 @@ class cSetupMarkAd : public cMenuSetupPage {
         int logoonly;
         int saveinfo;
         int deferredshutdown;
+        int maxrunning = 0;
         void write(void);
         int lpos;
     protected:
@@ -71,9 +71,12 @@
 
 
 #include <signal.h>
+#include <poll.h>
+#include <sys/syscall.h>
 #include "status.h"
 #include "setup.h"
 #include "debug.h"
+#include "../command/logodb.h"  // layout of the logo database of markad
 
 
 cEpgEventLog::cEpgEventLog(const char *recDir) {
@@ -600,29 +603,122 @@ bool cStatusMarkAd::Start(const char *FileName, const char *Name, const tEventID
     FREE(strlen(svdrPortOption)+1, "svdrPortOption");
     free(svdrPortOption);
 
-    usleep(1000000); // wait 1 second
-    if (SystemExec(cmd) != -1) {
-        dsyslog("markad: cStatusMarkAd::Start(): executing %s", *cmd);
-        usleep(200000);
-        int pos = Add(FileName, Name, eventID, timerStartTime, timerStopTime, timerVPS);
-        bool gotPID = getPid(pos); // will set recs[pos].Pid
-        dsyslog("markad: cStatusMarkAd::Start(): index %d, pid %d, filename %s: running markad stored in list", pos, recs[pos].Pid, FileName ? FileName : "<NULL>");
-        if (gotPID && getStatus(pos)) {
-            if (setup->ProcessDuring == PROCESS_AFTER) {
-                if (!direct) {
-                    if (!setup->whileRecording) Pause(NULL);
-                    else Pause(FileName);
-                }
-                else {
-                    if (!setup->whileRecording && RunningRecording()) Pause(FileName);
-                    if (!setup->whileReplaying && Replaying()) Pause(FileName);
+    // do not start markad here, add it to the job queue, ProcessQueue() starts it if the limit of running markad processes allows it
+    int pos = Add(FileName, Name, eventID, timerStartTime, timerStopTime, timerVPS);
+    if (pos < 0) {
+        esyslog("markad: cStatusMarkAd::Start(): no free entry in list for %s", FileName);
+        return false;
+    }
+    recs[pos].cmd = strdup(*cmd);
+    ALLOC(strlen(recs[pos].cmd)+1, "recs[pos].cmd");
+    recs[pos].direct = direct;
+    recs[pos].recordingDone = direct;  // direct start is only possible for a finished recording
+    recs[pos].readyTime = time(NULL);
+    dsyslog("markad: cStatusMarkAd::Start(): index %d, filename %s: markad job queued", pos, FileName);
+
+    if ((setup->ProcessDuring == PROCESS_AFTER) && !direct && !setup->whileRecording) Pause(NULL);  // pause all markad processes while recording
+    ProcessQueue();
+    return true;
+}
+
+
+// get next job from queue to start
+// first recordings that just finished, then running recordings (only with process during recording), then jobs from menu or SVDRP
+// return: index of the job, -1 if no job is ready to start
+//
+int cStatusMarkAd::NextJob() {
+    int next = -1;
+    int nextPriority = 0;
+    for (int pos = 0; pos <= max_recs; pos++) {
+        if (!recs[pos].cmd) continue;
+        if ((setup->ProcessDuring == PROCESS_AFTER) && !recs[pos].recordingDone) continue;  // wait for end of recording
+        int priority = 0;
+        if (recs[pos].direct) priority = 2;
+        else if (!recs[pos].recordingDone) priority = 1;
+        if ((next < 0) || (priority < nextPriority) || ((priority == nextPriority) && (recs[pos].readyTime < recs[next].readyTime))) {
+            next = pos;
+            nextPriority = priority;
+        }
+    }
+    return next;
+}
+
+
+bool cStatusMarkAd::Execute(int Position) {
+    if (Position < 0) return false;
+    if (!recs[Position].cmd) return false;
+    if (SystemExec(recs[Position].cmd, true) == -1) {  // detached, VDR does not wait for markad
+        esyslog("markad: cStatusMarkAd::Execute(): executing %s failed", recs[Position].cmd);
+        return false;
+    }
+    dsyslog("markad: cStatusMarkAd::Execute(): index %d: executing %s", Position, recs[Position].cmd);
+    FREE(strlen(recs[Position].cmd)+1, "recs[Position].cmd");
+    free(recs[Position].cmd);
+    recs[Position].cmd = NULL;
+    recs[Position].execTime = time(NULL);
+    return true;
+}
+
+
+// called after we got the pid of the started markad process
+//
+void cStatusMarkAd::StartTracking(int Position) {
+#ifdef SYS_pidfd_open
+    recs[Position].pidfd = syscall(SYS_pidfd_open, recs[Position].Pid, 0);
+#endif
+    dsyslog("markad: cStatusMarkAd::StartTracking(): index %d, pid %d, filename %s: running markad stored in list%s", Position, recs[Position].Pid, recs[Position].FileName, (recs[Position].pidfd >= 0) ? ", tracked by pidfd" : "");
+    if (setup->ProcessDuring == PROCESS_AFTER) {
+        if (!setup->whileRecording && RunningRecording()) Pause(recs[Position].FileName);
+        if (!setup->whileReplaying && Replaying()) Pause(recs[Position].FileName);
+    }
+}
+
+
+bool cStatusMarkAd::JobFinished(int Position) {
+    if (recs[Position].pidfd >= 0) {  // pidfd gets readable if the process has terminated
+        struct pollfd pidPoll = {};
+        pidPoll.fd = recs[Position].pidfd;
+        pidPoll.events = POLLIN;
+        return (poll(&pidPoll, 1, 0) > 0);
+    }
+    return ((kill(recs[Position].Pid, 0) == -1) && (errno == ESRCH));  // kernel without pidfd support
+}
+
+
+// never sleeps, it is called from VDR main thread
+//
+void cStatusMarkAd::ProcessQueue() {
+    time_t now = time(NULL);
+    int running = 0;
+    for (int pos = 0; pos <= max_recs; pos++) {
+        if (!recs[pos].FileName || !recs[pos].execTime) continue;
+        if (!recs[pos].Pid) {  // markad started, wait for its pid file
+            if (getPid(pos)) StartTracking(pos);
+            else {
+                if ((now - recs[pos].execTime) > PIDFILE_TIMEOUT) {
+                    esyslog("markad: got no pid file from markad for %s", recs[pos].FileName);
+                    Remove(pos);
                 }
+                else running++;
+                continue;
             }
         }
-        else isyslog("markad: cannot find running process");
-        return true;
+        if (JobFinished(pos)) {
+            dsyslog("markad: cStatusMarkAd::ProcessQueue(): index %d, pid %d, filename %s: markad finished", pos, recs[pos].Pid, recs[pos].FileName);
+            Remove(pos);
+            continue;
+        }
+        running++;
+    }
+    while ((setup->maxRunning <= 0) || (running < setup->maxRunning)) {
+        int pos = NextJob();
+        if (pos < 0) break;
+        if (!Execute(pos)) {
+            Remove(pos);
+            continue;
+        }
+        running++;
     }
-    return false;
 }
 
 
@@ -751,7 +847,13 @@ void cStatusMarkAd::Recording(const cDevice *Device, const char *Name, const cha
         int pos = Get(FileName, Name);
         if (pos >= 0) {
             dsyslog("markad: cStatusMarkAd::Recording(): index %d, pid %d, filename %s: recording stopped", pos, recs[pos].Pid, FileName);
-            if ((setup->ProcessDuring == PROCESS_DURING) || (setup->ProcessDuring == PROCESS_NEVER)) { // PROCESS_NEVER: recording maybe in list from vps detection
+            recs[pos].recordingDone = true;
+            recs[pos].readyTime = time(NULL);
+            if ((setup->ProcessDuring == PROCESS_DURING) && (recs[pos].cmd || recs[pos].execTime)) {  // keep job in list until markad has finished
+                if (recs[pos].runningStatus == 4) isyslog("markad: got no VPS stop event for %s", recs[pos].FileName);
+                recs[pos].runningStatus = -1;  // stop VPS detection
+            }
+            else if ((setup->ProcessDuring == PROCESS_DURING) || (setup->ProcessDuring == PROCESS_NEVER)) { // PROCESS_NEVER: recording maybe in list from vps detection
                 dsyslog("markad: cStatusMarkAd::Recording(): remove recording <%s> [%s] from list", Name, FileName);
                 Remove(pos, false);
             }
@@ -773,7 +875,49 @@ void cStatusMarkAd::Recording(const cDevice *Device, const char *Name, const cha
            }
         }
         else dsyslog("markad: cStatusMarkAd::Recording(): unknown recording %s stopped", FileName);
+        ProcessQueue();  // start markad for the finished recording
+    }
+}
+
+
+// check if logo database of markad in logo directory has a logo of the channel
+//
+static bool LogoDBExists(const char *logodir, const char *cname) {
+    char *dbname = NULL;
+    if (asprintf(&dbname, "%s/%s", logodir, LOGODB_FILENAME) == -1) return false;
+    ALLOC(strlen(dbname)+1, "dbname");
+    FILE *dbFile = fopen(dbname, "r");
+    FREE(strlen(dbname)+1, "dbname");
+    free(dbname);
+    if (!dbFile) return false;
+
+    sLogoDBHeader header;
+    if ((fread(&header, 1, sizeof(header), dbFile) != sizeof(header)) || (memcmp(header.magic, LOGODB_MAGIC, sizeof(header.magic)) != 0)) {
+        fclose(dbFile);
+        return false;
+    }
+    if (header.version != LOGODB_VERSION) {
+        esyslog("markad: logo database %s/%s has unknown version %u", logodir, LOGODB_FILENAME, header.version);
+        fclose(dbFile);
+        return false;
+    }
+
+    char logo16_9[LOGODB_NAME_SIZE];
+    char logo4_3[LOGODB_NAME_SIZE];
+    snprintf(logo16_9, sizeof(logo16_9), "%s-A16_9", cname);
+    snprintf(logo4_3, sizeof(logo4_3), "%s-A4_3", cname);
+    bool found = false;
+    sLogoDBEntry entry;
+    for (uint32_t i = 0; i < header.count; i++) {
+        if (fread(&entry, 1, sizeof(entry), dbFile) != sizeof(entry)) break;
+        entry.name[LOGODB_NAME_SIZE - 1] = 0;
+        if ((strcmp(entry.name, logo16_9) == 0) || (strcmp(entry.name, logo4_3) == 0)) {
+            found = true;
+            break;
+        }
     }
+    fclose(dbFile);
+    return found;
 }
 
 
@@ -845,12 +989,13 @@ bool cStatusMarkAd::LogoExists(const cDevice *Device, const char *FileName) {
         ALLOC(strlen(fname)+1, "fname");
 
         if (stat(fname,&statbuf) == -1) {
+            bool found = LogoDBExists(logodir, cname);  // no PGM files, try logo database
             FREE(strlen(cname)+1, "cname");
             free(cname);
 
             FREE(strlen(fname)+1, "fname");
             free(fname);
-            return false;
+            return found;
         }
     }
     FREE(strlen(cname)+1, "cname");
@@ -897,8 +1042,7 @@ bool cStatusMarkAd::getPid(int Position) {
     if (asprintf(&buf, "%s/markad.pid", recs[Position].FileName) == -1) return false;
     ALLOC(strlen(buf)+1, "buf");
 
-    usleep(500*1000);   // wait 500ms to give markad time to create pid file
-    FILE *fpid = fopen(buf,"r");
+    FILE *fpid = fopen(buf,"r");  // called periodically from ProcessQueue() until markad has created the pid file
     if (fpid) {
         FREE(strlen(buf)+1, "buf");
         free(buf);
@@ -908,12 +1052,7 @@ bool cStatusMarkAd::getPid(int Position) {
         fclose(fpid);
     }
     else {
-        esyslog("markad: failed to open pid file %s with errno %i", buf, errno);
-        if (errno == ENOENT) {
-            // no such file or directory -> markad done or crashed
-            // remove entry from list
-            Remove(Position);
-        }
+        if (errno != ENOENT) esyslog("markad: failed to open pid file %s with errno %i", buf, errno);  // ENOENT: markad has not yet created the pid file
         FREE(strlen(buf)+1, "buf");
         free(buf);
     }
@@ -963,6 +1102,12 @@ bool cStatusMarkAd::MarkAdRunning() {
         else dsyslog("markad: markad is running for unknown recording, defere shutdown");
         running = true;
     }
+    for (int pos = 0; pos <= max_recs; pos++) {
+        if (recs[pos].cmd) {
+            dsyslog("markad: markad is queued for recording %s, defere shutdown", recs[pos].FileName);
+            running = true;
+        }
+    }
     return (running);
 }
 
@@ -1025,6 +1170,19 @@ void cStatusMarkAd::Remove(int pos, bool Kill) {
     recs[pos].vpsPauseStartTime = 0;
     recs[pos].vpsPauseStopTime = 0;
     recs[pos].timerVPS = false;
+    if (recs[pos].cmd) {
+        FREE(strlen(recs[pos].cmd)+1, "recs[pos].cmd");
+        free(recs[pos].cmd);
+        recs[pos].cmd = NULL;
+    }
+    recs[pos].direct = false;
+    recs[pos].recordingDone = false;
+    recs[pos].readyTime = 0;
+    recs[pos].execTime = 0;
+    if (recs[pos].pidfd >= 0) {
+        close(recs[pos].pidfd);
+        recs[pos].pidfd = -1;
+    }
     if (recs[pos].epgEventLog) {
         FREE(sizeof(*(recs[pos].epgEventLog)), "recs[pos].epgEventLog");
         delete recs[pos].epgEventLog;
@@ -1047,7 +1205,7 @@ char *cStatusMarkAd::GetStatus() {
         dsyslog("markad: cStatusMarkAd::GetStatus(): active recording with markad running: %s",recs[pos].FileName);
         char *line = NULL;
         char *tmp = NULL;
-        if (asprintf(&line, "markad: running for %s\n", recs[pos].FileName) != -1) {
+        if (asprintf(&line, "markad: %s for %s\n", (recs[pos].cmd) ? "queued" : "running", recs[pos].FileName) != -1) {
             if (asprintf(&tmp, "%s%s", (status) ? status : "", line) != -1) {
                 free(status);
                 free(line);
@@ -11,6 +11,8 @@
 // #include <chrono>
 #include "setup.h"
 
+#define PIDFILE_TIMEOUT 30  // seconds to wait for the pid file of a started markad process
+
 #if __GNUC__ > 3
 #define UNUSED(v) UNUSED_ ## v __attribute__((unused))
 #else
@@ -55,6 +57,12 @@ struct recs {
     time_t vpsPauseStartTime = 0;
     time_t vpsPauseStopTime = 0;
     cEpgEventLog *epgEventLog;
+    char *cmd = NULL;            // markad command line of a queued job
+    bool direct = false;         // job started from menu or SVDRP for a finished recording
+    bool recordingDone = false;  // recording has stopped, job gets priority in the queue
+    time_t readyTime = 0;        // time the job was queued or its recording has stopped
+    time_t execTime = 0;         // time markad was executed, 0 while the job is queued
+    int pidfd = -1;              // pidfd of the running markad process, -1 if not available
 };
 
 
@@ -85,6 +93,10 @@ class cStatusMarkAd : public cStatus {
         void SaveVPSTimer(const char *FileName, const bool timerVPS);
         void SaveVPSEvents(const int index);
         bool StoreVPSStatus(const char *status, const int index);
+        int NextJob();
+        bool Execute(int Position);
+        void StartTracking(int Position);
+        bool JobFinished(int Position);
         cEpgHandlerMarkad *epgHandlerMarkad = NULL;
     protected:
         virtual void Recording(const cDevice *Device, const char *Name, const char *FileName, bool On);
@@ -99,6 +111,7 @@ class cStatusMarkAd : public cStatus {
         }
         char *GetStatus();
         void Check(void);
+        void ProcessQueue(void);
         bool GetNextActive(struct recs **RecEntry);
         bool Start(const char *FileName, const char *Name, const tEventID eventID, const time_t timerStartTime, const time_t timerStopTime, const bool timerVPS, const bool Direct);
         void SetVPSStatus(const cSchedule *Schedule, const SI::EIT::Event *EitEvent);